@@ -11,6 +11,7 @@ extensions of the paths.
 """
 import argparse
 import logging
+import math
 import os
 import struct
 import wave
@@ -459,6 +460,353 @@ def convert_to_ast(src_filepath: str,
         f.write(block_data)
 
 
+def _pack_sample_format(bit_depth: int) -> str:
+    if bit_depth == 8:
+        return 'b'
+    if bit_depth == 16:
+        return 'h'
+    if bit_depth == 32:
+        return 'i'
+    raise ValueError(f'Unsupported bit depth: {bit_depth}')
+
+
+def _sample_limits(bit_depth: int) -> 'tuple[int, int]':
+    return -(1 << (bit_depth - 1)), (1 << (bit_depth - 1)) - 1
+
+
+def _decode_block_naive(data: memoryview, channel_count: int, bit_depth: int) -> 'list[list[int]]':
+    bytes_per_sample = bit_depth // 8
+    bytes_per_channel = len(data) // channel_count
+    sample_count = bytes_per_channel // bytes_per_sample
+    fmt = f'>{sample_count}{_pack_sample_format(bit_depth)}'
+
+    return [
+        list(struct.unpack(fmt, data[i * bytes_per_channel:i * bytes_per_channel +
+                                     sample_count * bytes_per_sample]))
+        for i in range(channel_count)
+    ]
+
+
+def _decode_block_numpy(data: memoryview, channel_count: int, bit_depth: int) -> 'numpy.ndarray':
+    bytes_per_sample = bit_depth // 8
+    bytes_per_channel = len(data) // channel_count
+    sample_count = bytes_per_channel // bytes_per_sample
+    dtype = numpy.dtype(f'>i{bytes_per_sample}')
+
+    channels = numpy.empty((channel_count, sample_count), dtype=numpy.int64)
+    for i in range(channel_count):
+        channels[i] = numpy.frombuffer(data, dtype=dtype, count=sample_count,
+                                       offset=i * bytes_per_channel)
+    return channels
+
+
+def _encode_block_naive(channels: 'list[list[int]]', bit_depth: int) -> 'list[bytes]':
+    sample_format = _pack_sample_format(bit_depth)
+    return [struct.pack(f'>{len(samples)}{sample_format}', *samples) for samples in channels]
+
+
+def _encode_block_numpy(channels: 'numpy.ndarray', bit_depth: int) -> 'list[bytes]':
+    dtype = numpy.dtype(f'>i{bit_depth // 8}')
+    return [samples.astype(dtype).tobytes() for samples in channels]
+
+
+def _mix_to_mono_naive(channels: 'list[list[int]]', bit_depth: int) -> 'list[list[int]]':
+    min_value, max_value = _sample_limits(bit_depth)
+
+    # Channels are mixed in pairs, and clipped after every step, the same way
+    # `audioop.tomono(data, width, 1.0, 1.0)` would do it with interleaved samples.
+    while len(channels) > 1:
+        channels = [[
+            min(max(a + b, min_value), max_value) for a, b in zip(channels[i], channels[i + 1])
+        ] for i in range(0, len(channels), 2)]
+    return channels
+
+
+def _mix_to_mono_numpy(channels: 'numpy.ndarray', bit_depth: int) -> 'numpy.ndarray':
+    min_value, max_value = _sample_limits(bit_depth)
+
+    while len(channels) > 1:
+        channels = numpy.clip(channels[0::2] + channels[1::2], min_value, max_value)
+    return channels
+
+
+class _PolyphaseResampler():
+    """
+    Streaming resampler that applies a windowed-sinc low-pass filter in polyphase form. Samples are
+    fed in chunks of arbitrary size; only the samples that are still needed for the outputs that
+    are yet to be computed are retained between chunks.
+
+    The filter is centered on every output sample (i.e. there is no delay), and its coefficients are
+    stored in fixed point, so that the naive implementation and the NumPy implementation produce the
+    exact same output.
+    """
+
+    COEFFICIENT_SHIFT = 16
+    HALF_LENGTH_FACTOR = 16
+
+    def __init__(self, src_sample_rate: int, dst_sample_rate: int, channel_count: int,
+                 bit_depth: int):
+        divisor = math.gcd(src_sample_rate, dst_sample_rate)
+        self._up = dst_sample_rate // divisor
+        self._down = src_sample_rate // divisor
+        self._channel_count = channel_count
+        self._min_value, self._max_value = _sample_limits(bit_depth)
+        self._use_numpy = _NUMPY_AVAILABLE
+
+        up, down = self._up, self._down
+
+        # Filter coefficients on the upsampled grid, for offsets in the range [-half, half]. The
+        # cut-off frequency is the Nyquist frequency of the lowest of the two sample rates.
+        half_length = self.HALF_LENGTH_FACTOR * max(up, down)
+        cutoff = 1.0 / max(up, down)
+
+        def coefficient(offset: int) -> int:
+            if abs(offset) > half_length:
+                return 0
+            x = cutoff * offset
+            sinc = math.sin(math.pi * x) / (math.pi * x) if offset else 1.0
+            # Blackman window.
+            w = math.pi * offset / half_length
+            window = 0.42 + 0.5 * math.cos(w) + 0.08 * math.cos(2.0 * w)
+            return round(up * cutoff * sinc * window * (1 << self.COEFFICIENT_SHIFT))
+
+        # An output sample whose position in the upsampled grid is `q * up + phase` is the sum of
+        # the input samples `q + d` (with `d` in `[min_delta, max_delta]`) weighted by the
+        # coefficients for `phase - d * up`.
+        self._min_delta = -(half_length // up)
+        self._max_delta = (up - 1 + half_length) // up
+        self._tap_count = self._max_delta - self._min_delta + 1
+        self._taps = [[
+            coefficient(phase - (self._min_delta + t) * up) for t in range(self._tap_count)
+        ] for phase in range(up)]
+
+        # The buffer starts with zeros in place of the samples that precede the first sample.
+        self._buffer_start = self._min_delta
+        self._input_count = 0
+        self._output_count = 0
+        if self._use_numpy:
+            self._taps = numpy.array(self._taps, dtype=numpy.int64)
+            self._buffer = numpy.zeros((channel_count, -self._min_delta), dtype=numpy.int64)
+        else:
+            self._buffer = [[0] * -self._min_delta for _ in range(channel_count)]
+
+    def process(self, channels) -> 'list[list[int]] | numpy.ndarray':
+        self._input_count += len(channels[0])
+        self._append(channels)
+
+        # Outputs can be computed as long as all their input samples are in the buffer; i.e. output
+        # `n` is available if `n * down // up + max_delta` is lower than the end of the buffer.
+        buffer_end = self._buffer_start + len(self._buffer[0])
+        last_input = buffer_end - 1 - self._max_delta
+        end = ((last_input + 1) * self._up + self._down - 1) // self._down
+        return self._resample(max(self._output_count, end))
+
+    def flush(self) -> 'list[list[int]] | numpy.ndarray':
+        # The samples that follow the last sample are zeros.
+        if self._use_numpy:
+            self._append(numpy.zeros((self._channel_count, self._max_delta + 1),
+                                     dtype=numpy.int64))
+        else:
+            self._append([[0] * (self._max_delta + 1) for _ in range(self._channel_count)])
+
+        end = (self._input_count * self._up + self._down - 1) // self._down
+        return self._resample(end)
+
+    def _append(self, channels):
+        if self._use_numpy:
+            self._buffer = numpy.concatenate((self._buffer, channels), axis=1)
+        else:
+            for samples, new_samples in zip(self._buffer, channels):
+                samples.extend(new_samples)
+
+    def _resample(self, end: int) -> 'list[list[int]] | numpy.ndarray':
+        start = self._output_count
+        self._output_count = end
+
+        rounding = 1 << (self.COEFFICIENT_SHIFT - 1)
+        base = self._min_delta - self._buffer_start
+
+        if self._use_numpy:
+            positions = numpy.arange(start, end, dtype=numpy.int64) * self._down
+            indexes = ((positions // self._up + base)[:, numpy.newaxis] +
+                       numpy.arange(self._tap_count, dtype=numpy.int64))
+            taps = self._taps[positions % self._up]
+            values = (self._buffer[:, indexes] * taps).sum(axis=2)
+            result = numpy.clip((values + rounding) >> self.COEFFICIENT_SHIFT, self._min_value,
+                                self._max_value)
+        else:
+            result = [[] for _ in range(self._channel_count)]
+            for n in range(start, end):
+                q, phase = divmod(n * self._down, self._up)
+                index = q + base
+                taps = self._taps[phase]
+                for samples, result_samples in zip(self._buffer, result):
+                    value = sum(t * s for t, s in zip(taps, samples[index:index + self._tap_count]))
+                    value = (value + rounding) >> self.COEFFICIENT_SHIFT
+                    result_samples.append(min(max(value, self._min_value), self._max_value))
+
+        # Drop the samples that are no longer needed.
+        drop_count = (end * self._down) // self._up + base
+        if drop_count > 0:
+            self._buffer_start += drop_count
+            if self._use_numpy:
+                self._buffer = self._buffer[:, drop_count:]
+            else:
+                for samples in self._buffer:
+                    del samples[:drop_count]
+
+        return result
+
+
+def is_fast_conforming_supported() -> bool:
+    """
+    Whether `conform()` can run with the vectorized kernels. The naive kernels produce the exact same
+    output, but they are orders of magnitude slower.
+    """
+    return _NUMPY_AVAILABLE
+
+
+def conform(src_filepath: str, dst_filepath: str, mix_to_mono: bool, sample_rate: int = None):
+    """
+    Mixes the channels of the given AST file down to a single channel, and/or resamples the audio
+    to the given sample rate, and writes the result to a new AST file.
+
+    The file is processed one block at a time: peak memory usage does not depend on the length of
+    the audio track.
+
+    While the mono mixdown is equivalent to `audioop.tomono()`, resampling is performed with a
+    polyphase windowed-sinc filter.
+    """
+    assert os.path.normcase(os.path.abspath(src_filepath)) != os.path.normcase(
+        os.path.abspath(dst_filepath))
+
+    ast_info = get_ast_info(src_filepath)
+
+    bit_depth = ast_info['bit_depth']
+    channel_count = ast_info['channel_count']
+    src_sample_rate = ast_info['sample_rate']
+
+    if _NUMPY_AVAILABLE:
+        decode_block = _decode_block_numpy
+        encode_block = _encode_block_numpy
+        mix = _mix_to_mono_numpy
+    else:
+        decode_block = _decode_block_naive
+        encode_block = _encode_block_naive
+        mix = _mix_to_mono_naive
+
+    dst_channel_count = 1 if mix_to_mono else channel_count
+    dst_sample_rate = sample_rate or src_sample_rate
+    resampler = None
+    if dst_sample_rate != src_sample_rate:
+        resampler = _PolyphaseResampler(src_sample_rate, dst_sample_rate, dst_channel_count,
+                                        bit_depth)
+
+    # If the audio is resampled, the size of the last block is determined automatically, in the same
+    # way `convert_to_ast()` does it.
+    last_block_size = ast_info['last_block_size'] if resampler is None else None
+
+    if os.path.splitdrive(os.path.dirname(dst_filepath))[1]:
+        os.makedirs(os.path.dirname(dst_filepath), exist_ok=True)
+
+    with open(src_filepath, 'rb') as src_file, open(dst_filepath, 'wb') as dst_file:
+        src_file.seek(_HEADER_SIZE)
+        dst_file.write(b'\x00' * _HEADER_SIZE)  # Header is written last.
+
+        # Output samples are accumulated (per channel) until a block can be written. A block is not
+        # written until it is known whether it is the last one.
+        pending_data = [bytearray() for _ in range(dst_channel_count)]
+        real_sample_count = 0
+
+        def write_block(size: int, last: bool):
+            if last and last_block_size is not None:
+                header_block_size = last_block_size
+                padding = 0
+            else:
+                header_block_size = (size | _ALIGNMENT - 1) + 1 if size % _ALIGNMENT else size
+                padding = header_block_size - size
+
+            dst_file.write(struct.pack('>LLQQQ', _BLOCK_MAGIC, header_block_size, 0, 0, 0))
+            for data in pending_data:
+                dst_file.write(data[:size])
+                if padding:
+                    dst_file.write(b'\x00' * padding)
+                del data[:size]
+
+        def write_channels(channels):
+            nonlocal real_sample_count
+            real_sample_count += len(channels[0])
+
+            for data, channel_data in zip(pending_data, encode_block(channels, bit_depth)):
+                data.extend(channel_data)
+            while len(pending_data[0]) > _BLOCK_SIZE:
+                write_block(_BLOCK_SIZE, False)
+
+        while True:
+            block_header = src_file.read(_BLOCK_HEADER_SIZE)
+            if not block_header:
+                break
+
+            (
+                block_magic_bytes,
+                block_size,
+                padding0,
+                padding1,
+                padding2,
+            ) = struct.unpack('>LLQQQ', block_header)
+
+            assert block_magic_bytes == _BLOCK_MAGIC
+            assert not (padding0 or padding1 or padding2)
+
+            payload_data = memoryview(src_file.read(block_size * channel_count))
+            assert len(payload_data) % channel_count == 0
+
+            channels = decode_block(payload_data, channel_count, bit_depth)
+            if mix_to_mono:
+                channels = mix(channels, bit_depth)
+            if resampler is not None:
+                channels = resampler.process(channels)
+            write_channels(channels)
+
+        if resampler is not None:
+            write_channels(resampler.flush())
+        if pending_data[0]:
+            write_block(len(pending_data[0]), True)
+
+        block_data_size = dst_file.tell() - _HEADER_SIZE
+
+        # The sample count and the loop points are scaled to the new sample rate. Padding that may
+        # have been added to the last block is not taken into account.
+        ratio = dst_sample_rate / src_sample_rate
+        sample_count = min(real_sample_count, round(ratio * ast_info['sample_count']))
+        loop_start = min(real_sample_count, round(ratio * ast_info['loop_start']))
+        loop_end = min(real_sample_count, round(ratio * ast_info['loop_end']))
+
+        dst_file.seek(0)
+        dst_file.write(
+            struct.pack(
+                '>LLHHHHLLLLLLbBHLQQ',
+                _MAGIC,
+                block_data_size,
+                _PCM_FORMAT,
+                bit_depth,
+                dst_channel_count,
+                ast_info['looped'],
+                dst_sample_rate,
+                sample_count,
+                loop_start,
+                loop_end,
+                _BLOCK_SIZE,
+                0x00000000,
+                ast_info['volume'],
+                0x00,
+                0x0000,
+                0x00000000,
+                0x0000000000000000,
+                0x0000000000000000,
+            ))
+
+
 def main():
     logging.basicConfig(format='%(asctime)s %(levelname)-8s %(message)s',
                         level=logging.INFO,
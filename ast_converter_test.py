@@ -5,9 +5,13 @@ Unit tests for the `ast_converter` module.
 # pylint: disable=protected-access
 
 import filecmp
+import math
 import os
+import random
+import struct
 import sys
 import tempfile
+import wave
 
 import pytest
 
@@ -104,5 +108,110 @@ def test_stock_data_set_numpy_naive():
         ast_converter._NUMPY_AVAILABLE = previous_value
 
 
+def _write_ast(filepath: str, channels: 'list[list[int]]', sample_rate: int = 32000):
+    wav_filepath = os.path.splitext(filepath)[0] + '.wav'
+    with wave.open(wav_filepath, 'wb') as f:
+        f: wave.Wave_write
+        f.setsampwidth(2)
+        f.setnchannels(len(channels))
+        f.setframerate(sample_rate)
+        f.writeframes(struct.pack(f'<{len(channels) * len(channels[0])}h',
+                                  *(s for frame in zip(*channels) for s in frame)))
+    ast_converter.convert_to_ast(wav_filepath, filepath, loop_start=len(channels[0]) // 3)
+
+
+def _read_ast(filepath: str) -> 'list[list[int]]':
+    wav_filepath = os.path.splitext(filepath)[0] + '.wav'
+    ast_converter.convert_to_wav(filepath, wav_filepath)
+    with wave.open(wav_filepath, 'rb') as f:
+        channel_count = f.getnchannels()
+        samples = struct.unpack(f'<{f.getnframes() * channel_count}h', f.readframes(f.getnframes()))
+    return [list(samples[i::channel_count]) for i in range(channel_count)]
+
+
+def _conform(src_filepath: str, dst_filepath: str, mix_to_mono: bool, sample_rate: int,
+             use_numpy: bool):
+    previous_value = ast_converter._NUMPY_AVAILABLE
+    try:
+        ast_converter._NUMPY_AVAILABLE = use_numpy
+        ast_converter.conform(src_filepath, dst_filepath, mix_to_mono, sample_rate)
+    finally:
+        ast_converter._NUMPY_AVAILABLE = previous_value
+
+
+def test_conform_mix_to_mono():
+    rng = random.Random(0)
+    for channel_count in (2, 4):
+        # Sample counts around the block size, which is 5040 samples per channel.
+        for sample_count in (1, 5039, 5040, 5041, 12345):
+            channels = [[rng.randint(-32768, 32767) for _ in range(sample_count)]
+                        for _ in range(channel_count)]
+
+            with tempfile.TemporaryDirectory() as tmp_dir:
+                src_filepath = os.path.join(tmp_dir, 'src.ast')
+                dst_filepath = os.path.join(tmp_dir, 'dst.ast')
+                _write_ast(src_filepath, channels)
+                _conform(src_filepath, dst_filepath, True, None, False)
+
+                src_info = ast_converter.get_ast_info(src_filepath)
+                dst_info = ast_converter.get_ast_info(dst_filepath)
+                assert dst_info['channel_count'] == 1
+                for key in ('sample_rate', 'sample_count', 'loop_start', 'loop_end',
+                            'last_block_size'):
+                    assert dst_info[key] == src_info[key]
+
+                # Channels are mixed in pairs, and clipped after every step.
+                while len(channels) > 1:
+                    channels = [[max(-32768, min(32767, a + b))
+                                 for a, b in zip(channels[i], channels[i + 1])]
+                                for i in range(0, len(channels), 2)]
+                (samples, ) = _read_ast(dst_filepath)
+                assert samples[:sample_count] == channels[0]
+
+
+def test_conform_resample():
+    sample_count = 16000
+    frequency = 1000
+    amplitude = 10000
+    channels = [[round(amplitude * math.sin(2 * math.pi * frequency * i / 32000))
+                 for i in range(sample_count)]] * 2
+
+    for sample_rate in (16000, 22050, 24000):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            src_filepath = os.path.join(tmp_dir, 'src.ast')
+            dst_filepath = os.path.join(tmp_dir, 'dst.ast')
+            _write_ast(src_filepath, channels)
+            _conform(src_filepath, dst_filepath, False, sample_rate, False)
+
+            dst_info = ast_converter.get_ast_info(dst_filepath)
+            expected_sample_count = math.ceil(sample_count * sample_rate / 32000)
+            assert dst_info['sample_rate'] == sample_rate
+            assert dst_info['sample_count'] == expected_sample_count
+            assert dst_info['loop_start'] == round(sample_count // 3 * sample_rate / 32000)
+
+            # Away from the edges, the resampled audio must closely match the original wave.
+            omega = 2 * math.pi * frequency / sample_rate
+            for samples in _read_ast(dst_filepath):
+                for i in range(100, expected_sample_count - 100):
+                    expected_sample = amplitude * math.sin(omega * i)
+                    assert abs(samples[i] - expected_sample) < 8
+
+
+@pytest.mark.parametrize('mix_to_mono, sample_rate', ((True, None), (False, 22050), (True, 24000)))
+def test_conform_numpy_matches_naive(mix_to_mono: bool, sample_rate: int):
+    rng = random.Random(0)
+    channels = [[rng.randint(-32768, 32767) for _ in range(12345)] for _ in range(4)]
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        src_filepath = os.path.join(tmp_dir, 'src.ast')
+        naive_filepath = os.path.join(tmp_dir, 'naive.ast')
+        numpy_filepath = os.path.join(tmp_dir, 'numpy.ast')
+        _write_ast(src_filepath, channels)
+        _conform(src_filepath, naive_filepath, mix_to_mono, sample_rate, False)
+        _conform(src_filepath, numpy_filepath, mix_to_mono, sample_rate, True)
+
+        assert filecmp.cmp(naive_filepath, numpy_filepath, shallow=False)
+
+
 if __name__ == '__main__':
     sys.exit(pytest.main(sys.argv))
@@ -4,6 +4,7 @@ GameCube games such as Mario Kart: Double Dash!!. Also support for BSFT and BAAC
 
 BAA format specification was extracted from Jampacked by Xayr (https://github.com/XAYRGA/jampacked).
 """
+import io
 import json
 import os
 import struct
@@ -115,6 +116,17 @@ def _parse_baa_header(f) -> list[dict]:
     return sections
 
 
+def _write_baa_header(f, sections: list[dict]):
+    # Fields are written in the same order in which they are read in `_parse_baa_header()`.
+    _write_uint32(f, _BAA_MAGIC)
+    for section in sections:
+        _write_uint32(f, section['type'])
+        for key in ('number', 'start', 'end', 'flags'):
+            if key in section:
+                _write_uint32(f, section[key])
+    _write_uint32(f, _BAA_FOOTER)
+
+
 def _get_baa_section_size(section: dict, f) -> int:
     section_type = section['type']
     section_start = section['start']
@@ -334,25 +346,53 @@ def pack_baac(src_filepaths: list[str], dst_filepath: str):
             _write_uint32(output_file, offset)
 
 
+def _parse_bsft(f) -> list[tuple[int, str]]:
+    # String offsets are relative to the start of the BSFT data (which can be embedded in a BAA).
+    section_start = f.tell()
+
+    magic = f.read(4)
+    assert magic == b'bsft'
+    string_count = _read_uint32(f)
+    string_offsets = tuple(_read_uint32(f) for _ in range(string_count))
+
+    offsets_and_strings = []
+    for string_offset in string_offsets:
+        f.seek(section_start + string_offset)
+        string = bytearray()
+        while (value := f.read(1)) != b'\0':
+            string += value
+        offsets_and_strings.append((string_offset, bytes(string).decode(encoding='ascii')))
+
+    return offsets_and_strings
+
+
+def _build_bsft(strings: list[str]) -> bytes:
+    f = io.BytesIO()
+    f.write(b'bsft')
+    _write_uint32(f, len(strings))
+
+    for _ in range(len(strings)):
+        _write_uint32(f, 0)  # Offset placeholder; it will be updated.
+
+    string_offsets = []
+    for string in strings:
+        string_offsets.append(f.tell())
+        f.write(bytes(string, encoding='ascii'))
+        f.write(b'\x00')  # Null character.
+
+    f.seek(4 + 4)  # After file magic and string count.
+    for string_offset in string_offsets:
+        _write_uint32(f, string_offset)
+
+    return f.getvalue()
+
+
 def read_bsft(src_filepath: str) -> list[tuple[int, str]]:
     if not src_filepath.endswith('.bsft'):
         raise ValueError(f'Input filepath "{src_filepath}" should use the ".bsft" extension.')
 
     with open(src_filepath, 'rb') as f:
-        magic = f.read(4)
-        assert magic == b'bsft'
-        string_count = _read_uint32(f)
-        string_offsets = tuple(_read_uint32(f) for _ in range(string_count))
-
-        offsets_and_strings = []
-        for string_offset in string_offsets:
-            f.seek(string_offset)
-            string = bytearray()
-            while (value := f.read(1)) != b'\0':
-                string += value
-            offsets_and_strings.append((string_offset, bytes(string).decode(encoding='ascii')))
-
-    return offsets_and_strings
+        return _parse_bsft(f)
 
 
 def write_bsft(strings: list[str], dst_filepath: str):
@@ -360,18 +400,68 @@ def write_bsft(strings: list[str], dst_filepath: str):
         raise ValueError(f'Destination filepath "{dst_filepath}" should use the ".bsft" extension.')
 
     with open(dst_filepath, 'wb') as f:
-        f.write(b'bsft')
-        _write_uint32(f, len(strings))
+        f.write(_build_bsft(strings))
 
-        for _ in range(len(strings)):
-            _write_uint32(f, 0)  # Offset placeholder; it will be updated.
 
-        string_offsets = []
-        for string in strings:
-            string_offsets.append(f.tell())
-            f.write(bytes(string, encoding='ascii'))
-            f.write(b'\x00')  # Null character.
+def _find_bsft_section(sections: list[dict], filepath: str) -> dict:
+    for section in sections:
+        if section['type'] == _SectionType.BSFT:
+            return section
+    raise RuntimeError(f'Unable to locate BSFT section in "{filepath}".')
 
-        f.seek(4 + 4)  # After file magic and string count.
-        for string_offset in string_offsets:
-            _write_uint32(f, string_offset)
+
+def read_baa_bsft(src_filepath: str) -> list[tuple[int, str]]:
+    """
+    Reads the strings of the BSFT section that is embedded in the given BAA file.
+    """
+    if not src_filepath.endswith('.baa'):
+        raise ValueError(f'Input filepath "{src_filepath}" should use the ".baa" extension.')
+
+    with open(src_filepath, 'rb') as f:
+        section = _find_bsft_section(_parse_baa_header(f), src_filepath)
+        f.seek(section['start'])
+        return _parse_bsft(f)
+
+
+def patch_baa_bsft(filepath: str, strings: list[str]):
+    """
+    Replaces the strings of the BSFT section that is embedded in the given BAA file, without
+    unpacking the rest of the sections.
+
+    If the new BSFT data does not fit in the space of the current section, the sections that follow
+    are shifted (and their offsets in the header updated). The shift is a multiple of 32 bytes, so
+    that the alignment of the BNK and WSYS sections is preserved; the section is padded with zeros
+    when needed.
+    """
+    if not filepath.endswith('.baa'):
+        raise ValueError(f'Filepath "{filepath}" should use the ".baa" extension.')
+
+    with open(filepath, 'rb') as f:
+        data = f.read()
+
+    f = io.BytesIO(data)
+    sections = _parse_baa_header(f)
+    header_size = f.tell()
+    bsft_section = _find_bsft_section(sections, filepath)
+    bsft_start = bsft_section['start']
+    bsft_size = _get_baa_section_size(bsft_section, f)
+
+    bsft_data = _build_bsft(strings)
+    shift = -((bsft_size - len(bsft_data)) // 32 * 32)
+    bsft_data += b'\x00' * (bsft_size + shift - len(bsft_data))
+
+    for section in sections:
+        for key in ('start', 'end'):
+            if key in section and section[key] > bsft_start:
+                section[key] += shift
+
+    f = io.BytesIO()
+    f.write(data[:bsft_start])
+    f.write(bsft_data)
+    f.write(data[bsft_start + bsft_size:])
+    f.seek(0)
+    _write_baa_header(f, sections)
+    assert f.tell() == header_size
+
+    with open(filepath, 'wb') as output_file:
+        output_file.write(f.getvalue())
@@ -2,7 +2,11 @@
 """
 Unit tests for the `baa` module.
 """
+# pylint: disable=protected-access
+
+import json
 import os
+import struct
 import sys
 import tempfile
 
@@ -54,5 +58,79 @@ def test_stock_data_set():
         assert ref_data == data or ref_data.rstrip(b'\x00') == data.rstrip(b'\x00')
 
 
+def _pack_synthetic_baa(dirpath: str, bsft_strings: 'list[str]') -> str:
+    bnk_data = b'IBNK' + struct.pack('>I', 40) + bytes(range(32))
+    wsys_data = b'WSYS' + struct.pack('>I', 72) + bytes(range(64))
+    bst_data = bytes(range(100, 124))
+
+    sections = [
+        {'type': baa._SectionType.BST, 'start': 0, 'end': 0},
+        {'type': baa._SectionType.BSFT, 'start': 1},
+        {'type': baa._SectionType.BNK, 'number': 7, 'start': 2},
+        {'type': baa._SectionType.WSYS, 'number': 3, 'start': 3, 'flags': 5},
+    ]
+    for i, data in enumerate((bst_data, baa._build_bsft(bsft_strings), bnk_data, wsys_data)):
+        extension = baa._FILE_EXTENSIONS[sections[i]['type']]
+        with open(os.path.join(dirpath, f'{i}{extension}'), 'wb') as f:
+            f.write(data)
+    with open(os.path.join(dirpath, 'test.baa_info.json'), 'w', encoding='utf-8') as f:
+        json.dump(sections, f)
+
+    baa_filepath = os.path.join(dirpath, 'test.baa')
+    baa.pack_baa(dirpath, baa_filepath)
+    return baa_filepath
+
+
+def _read_sections(baa_filepath: str, dirpath: str) -> 'list[tuple[dict, bytes]]':
+    baa.unpack_baa(baa_filepath, dirpath)
+    with open(os.path.join(dirpath, 'test.baa_info.json'), 'r', encoding='utf-8') as f:
+        sections = json.load(f)
+    sections_and_data = []
+    for i, section in enumerate(sections):
+        extension = baa._FILE_EXTENSIONS[section['type']]
+        with open(os.path.join(dirpath, f'{i}{extension}'), 'rb') as f:
+            sections_and_data.append((section, f.read()))
+    return sections_and_data
+
+
+@pytest.mark.parametrize('new_strings', (
+    ['a', 'b', 'c'],
+    ['Stream/COURSE_CIRCUIT_0.x.32.c4.ast', 'Stream/COURSE_YCIRCUIT_0.x.32.c4.ast'],
+    [f'files/AudioRes/Stream/X_COURSE_{i:03}.ast' for i in range(32)],
+    [],
+))
+def test_patch_baa_bsft(new_strings: 'list[str]'):
+    """
+    Verifies that the BSFT section embedded in a BAA file can be patched in place, and that the
+    rest of the sections are preserved (and remain aligned) when the section grows or shrinks.
+    """
+    strings = [f'Stream/COURSE_{i}.ast' for i in range(8)]
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        pack_dirpath = os.path.join(tmp_dir, 'pack')
+        os.mkdir(pack_dirpath)
+        baa_filepath = _pack_synthetic_baa(pack_dirpath, strings)
+        assert [string for _offset, string in baa.read_baa_bsft(baa_filepath)] == strings
+
+        original_sections = _read_sections(baa_filepath, os.path.join(tmp_dir, 'original'))
+
+        baa.patch_baa_bsft(baa_filepath, new_strings)
+        assert [string for _offset, string in baa.read_baa_bsft(baa_filepath)] == new_strings
+
+        patched_sections = _read_sections(baa_filepath, os.path.join(tmp_dir, 'patched'))
+
+    assert len(original_sections) == len(patched_sections)
+    for (original_section, original_data), (section, data) in zip(original_sections,
+                                                                  patched_sections):
+        assert original_section['type'] == section['type']
+        assert original_section.get('number') == section.get('number')
+        assert original_section.get('flags') == section.get('flags')
+        if section['type'] == baa._SectionType.BSFT:
+            assert data == baa._build_bsft(new_strings)
+            continue
+        assert original_data == data
+        assert (section['start'] - original_section['start']) % 32 == 0
+
+
 if __name__ == '__main__':
     sys.exit(pytest.main(sys.argv))
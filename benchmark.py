@@ -0,0 +1,598 @@
+#!/usr/bin/env python3
+"""
+Benchmark suite for the hot paths of the build pipeline and of the file format codecs.
+
+Each benchmark times an operation (e.g. Yaz0 decompression, RARC extraction, AST conversion, BTI
+encoding, ISO export, or the compilation of the injected code) on synthetic inputs that are shaped
+after the files in a stock ISO image. Inputs are generated from a fixed seed, so that results are
+comparable across runs. Where the modules provide both a naive and a vectorized implementation,
+the two variants are timed separately.
+
+Results can be saved to a baseline file, and later runs compared against it; a benchmark whose
+median time exceeds the baseline by more than the given threshold is reported as a regression, and
+the program exits with a non-zero status code. Baselines are only meaningful on the machine (and
+with the Python environment) where they were recorded.
+
+Example:
+
+    python3 benchmark.py --save-baseline baseline.json
+    python3 benchmark.py --baseline baseline.json --filter rarc
+"""
+# pylint: disable=protected-access
+
+import argparse
+import gc
+import io
+import json
+import logging
+import math
+import os
+import platform
+import random
+import re
+import shutil
+import struct
+import sys
+import tempfile
+import time
+import wave
+
+from PIL import Image
+
+import ast_converter
+import code_patcher
+import gcm_builder
+import mkdd_extender
+import rarc
+from tools import bti, gcm
+
+log = logging.getLogger('benchmark')
+
+BASELINE_VERSION = 1
+
+BENCHMARKS = {}
+"""
+Registered benchmarks, keyed by name. Each benchmark is a function that receives a temporary
+directory and prepares the inputs, and that returns the function that is timed.
+"""
+
+
+def benchmark(name: str):
+
+    def decorator(func: callable) -> callable:
+        assert name not in BENCHMARKS
+        BENCHMARKS[name] = func
+        return func
+
+    return decorator
+
+
+class _NumpyAvailability():
+    """
+    Context manager that enables or disables the vectorized code paths in the given modules.
+    """
+
+    def __init__(self, modules: tuple, use_numpy: bool):
+        self._modules = modules
+        self._use_numpy = use_numpy
+        self._previous_values = None
+
+    def __enter__(self):
+        self._previous_values = tuple(module._NUMPY_AVAILABLE for module in self._modules)
+        for module in self._modules:
+            module._NUMPY_AVAILABLE = self._use_numpy
+
+    def __exit__(self, *_args):
+        for module, previous_value in zip(self._modules, self._previous_values):
+            module._NUMPY_AVAILABLE = previous_value
+
+
+def _generate_file_data(rng: random.Random, size: int) -> bytes:
+    """
+    Generates data that compresses in a similar ratio to the files in course archives: a mix of
+    short random runs and repeated chunks.
+    """
+    data = bytearray()
+    while len(data) < size:
+        if data and rng.random() < 0.6:
+            offset = rng.randrange(max(0, len(data) - 0x1000), len(data))
+            length = rng.randint(3, 0x40)
+            data += (data[offset:] * length)[:length]
+        else:
+            data += rng.randbytes(rng.randint(1, 0x20))
+    return bytes(data[:size])
+
+
+def _write_archive_tree(dirpath: str, rng: random.Random, file_sizes: 'tuple[int]'):
+    os.makedirs(os.path.join(dirpath, 'timg'))
+    for i, size in enumerate(file_sizes):
+        subdirname = 'timg' if i % 2 else ''
+        with open(os.path.join(dirpath, subdirname, f'file{i}.bin'), 'wb') as f:
+            f.write(_generate_file_data(rng, size))
+
+
+# Files in a course archive (BMD, BCO, BOL, BTK, etc.), in bytes.
+COURSE_ARCHIVE_FILE_SIZES = (900000, 250000, 40000, 30000, 12000, 8000, 4000, 2000)
+
+# Files in a menu archive (e.g. `courseselect.arc`), mostly BTI images and BLO/BCK files, in bytes.
+MENU_ARCHIVE_FILE_SIZES = tuple(
+    random.Random(0).choice((544, 2080, 8224, 16416, 32800)) for _i in range(400))
+
+
+@benchmark('rarc.compress')
+def _rarc_compress(_tmp_dir: str) -> callable:
+    data = _generate_file_data(random.Random(0), 256 * 1024)
+    return lambda: rarc._compress(data)
+
+
+@benchmark('rarc.decompress')
+def _rarc_decompress(_tmp_dir: str) -> callable:
+    data = memoryview(rarc._compress(_generate_file_data(random.Random(0), 2 * 1024 * 1024)))
+    return lambda: rarc._decompress(data)
+
+
+@benchmark('rarc.extract')
+def _rarc_extract(tmp_dir: str) -> callable:
+    src_dirpath = os.path.join(tmp_dir, 'courseselect')
+    _write_archive_tree(src_dirpath, random.Random(0), MENU_ARCHIVE_FILE_SIZES)
+    filepath = os.path.join(tmp_dir, 'courseselect.arc')
+    rarc.pack(src_dirpath, filepath)
+    shutil.rmtree(src_dirpath)
+
+    def run():
+        rarc.extract(filepath, tmp_dir)
+        shutil.rmtree(src_dirpath)
+
+    return run
+
+
+@benchmark('rarc.extract.compressed')
+def _rarc_extract_compressed(tmp_dir: str) -> callable:
+    src_dirpath = os.path.join(tmp_dir, 'track')
+    _write_archive_tree(src_dirpath, random.Random(0), COURSE_ARCHIVE_FILE_SIZES)
+    filepath = os.path.join(tmp_dir, 'track.arc')
+    rarc.pack(src_dirpath, filepath, compress=True)
+    shutil.rmtree(src_dirpath)
+
+    def run():
+        rarc.extract(filepath, tmp_dir)
+        shutil.rmtree(src_dirpath)
+
+    return run
+
+
+@benchmark('rarc.pack')
+def _rarc_pack(tmp_dir: str) -> callable:
+    src_dirpath = os.path.join(tmp_dir, 'courseselect')
+    _write_archive_tree(src_dirpath, random.Random(0), MENU_ARCHIVE_FILE_SIZES)
+    filepath = os.path.join(tmp_dir, 'courseselect.arc')
+    return lambda: rarc.pack(src_dirpath, filepath)
+
+
+def _write_wav(filepath: str, seconds: int, channel_count: int, sample_rate: int):
+    # A sine sweep with some noise, which is closer to music than white noise.
+    rng = random.Random(0)
+    sample_count = seconds * sample_rate
+    samples = []
+    for i in range(sample_count):
+        value = int(math.sin(i * (1 + i / sample_count) * 0.05) * 20000)
+        samples.extend(value + rng.randint(-500, 500) for _channel_index in range(channel_count))
+    with wave.open(filepath, 'wb') as f:
+        f.setnchannels(channel_count)
+        f.setsampwidth(2)
+        f.setframerate(sample_rate)
+        f.writeframes(struct.pack(f'<{len(samples)}h', *samples))
+
+
+def _numpy_variants(module) -> 'tuple[bool]':
+    # Vectorized variants are not registered when NumPy is not available.
+    return (False, True) if module._NUMPY_AVAILABLE else (False, )
+
+
+def _register_ast_converter_benchmarks():
+    for use_numpy in _numpy_variants(ast_converter):
+        variant = 'numpy' if use_numpy else 'naive'
+
+        @benchmark(f'ast_converter.convert_to_ast.{variant}')
+        def _convert_to_ast(tmp_dir: str, use_numpy: bool = use_numpy) -> callable:
+            wav_filepath = os.path.join(tmp_dir, 'track.wav')
+            ast_filepath = os.path.join(tmp_dir, 'track.ast')
+            _write_wav(wav_filepath, 10, 2, 32000)
+
+            def run():
+                with _NumpyAvailability((ast_converter, ), use_numpy):
+                    ast_converter.convert_to_ast(wav_filepath, ast_filepath)
+
+            return run
+
+        @benchmark(f'ast_converter.convert_to_wav.{variant}')
+        def _convert_to_wav(tmp_dir: str, use_numpy: bool = use_numpy) -> callable:
+            wav_filepath = os.path.join(tmp_dir, 'track.wav')
+            ast_filepath = os.path.join(tmp_dir, 'track.ast')
+            _write_wav(wav_filepath, 10, 2, 32000)
+            ast_converter.convert_to_ast(wav_filepath, ast_filepath)
+
+            def run():
+                with _NumpyAvailability((ast_converter, ), use_numpy):
+                    ast_converter.convert_to_wav(ast_filepath, wav_filepath)
+
+            return run
+
+        @benchmark(f'ast_converter.conform.{variant}')
+        def _conform(tmp_dir: str, use_numpy: bool = use_numpy) -> callable:
+            wav_filepath = os.path.join(tmp_dir, 'track.wav')
+            src_ast_filepath = os.path.join(tmp_dir, 'src.ast')
+            dst_ast_filepath = os.path.join(tmp_dir, 'dst.ast')
+            _write_wav(wav_filepath, 10, 2, 48000)
+            ast_converter.convert_to_ast(wav_filepath, src_ast_filepath)
+
+            def run():
+                with _NumpyAvailability((ast_converter, ), use_numpy):
+                    ast_converter.conform(src_ast_filepath, dst_ast_filepath, True, 32000)
+
+            return run
+
+
+def _generate_image(width: int, height: int) -> Image.Image:
+    # Smooth gradients with some noise, like the preview images of the courses.
+    rng = random.Random(0)
+    data = bytearray()
+    for y in range(height):
+        for x in range(width):
+            data.extend((
+                max(0, min(255, x * 255 // width + rng.randint(-8, 8))),
+                max(0, min(255, y * 255 // height + rng.randint(-8, 8))),
+                (x + y) * 255 // (width + height),
+                0x00 if (x // 5 + y // 3) % 7 == 0 else 0xFF,
+            ))
+    return Image.frombytes('RGBA', (width, height), bytes(data))
+
+
+def _register_bti_benchmarks():
+    # Size of the preview images in the course selection screen.
+    width, height = 256, 184
+
+    for image_format in bti.NUMPY_IMAGE_FORMATS:
+        for use_numpy in _numpy_variants(bti):
+            variant = 'numpy' if use_numpy else 'naive'
+
+            @benchmark(f'bti.encode.{image_format.name}.{variant}')
+            def _encode(_tmp_dir: str,
+                        image_format: bti.ImageFormat = image_format,
+                        use_numpy: bool = use_numpy) -> callable:
+                image = _generate_image(width, height)
+
+                def run():
+                    with _NumpyAvailability((bti, ), use_numpy):
+                        bti.encode_image(image, image_format, bti.PaletteFormat.RGB5A3)
+
+                return run
+
+            @benchmark(f'bti.decode.{image_format.name}.{variant}')
+            def _decode(_tmp_dir: str,
+                        image_format: bti.ImageFormat = image_format,
+                        use_numpy: bool = use_numpy) -> callable:
+                image = _generate_image(width, height)
+                image_data, _palette_data, _encoded_colors = bti.encode_image(
+                    image, image_format, bti.PaletteFormat.RGB5A3)
+                image_data = bti.read_all_bytes(image_data)
+
+                def run():
+                    with _NumpyAvailability((bti, ), use_numpy):
+                        bti.decode_image(io.BytesIO(image_data), io.BytesIO(), image_format,
+                                         bti.PaletteFormat.RGB5A3, 0, width, height)
+
+                return run
+
+
+def _build_stock_shaped_iso(iso_filepath: str):
+    rng = random.Random(0)
+    files = {}
+    for course in code_patcher.COURSES:
+        files[f'Course/{course}.arc'] = rng.randbytes(512 * 1024)
+        files[f'StaffGhosts/{course}.ght'] = rng.randbytes(16 * 1024)
+    for i in range(40):
+        files[f'AudioRes/Stream/X_COURSE_{i:02}.x.32.c4.ast'] = rng.randbytes(1024 * 1024)
+    for language in mkdd_extender.LANGUAGES:
+        for filename in ('courseselect.arc', 'LANPlay.arc', 'mapselect.arc', 'titleline.arc'):
+            files[f'SceneData/{language}/{filename}'] = rng.randbytes(256 * 1024)
+    # A stock image contains a couple of thousand files, most of them small.
+    for i in range(1500):
+        files[f'Objects/object{i:04}.arc'] = rng.randbytes(rng.randint(1, 16) * 1024)
+    gcm_builder.build_iso(iso_filepath, files)
+
+
+@benchmark('gcm.read_entire_disc')
+def _gcm_read_entire_disc(tmp_dir: str) -> callable:
+    iso_filepath = os.path.join(tmp_dir, 'input.iso')
+    _build_stock_shaped_iso(iso_filepath)
+    return lambda: gcm.GCM(iso_filepath).read_entire_disc()
+
+
+@benchmark('gcm.export_disc_to_folder')
+def _gcm_export_disc_to_folder(tmp_dir: str) -> callable:
+    iso_filepath = os.path.join(tmp_dir, 'input.iso')
+    _build_stock_shaped_iso(iso_filepath)
+    dst_dirpath = os.path.join(tmp_dir, 'output')
+
+    def run():
+        gcm_file = gcm.GCM(iso_filepath)
+        gcm_file.read_entire_disc()
+        for _filepath, _files_done in gcm_file.export_disc_to_folder_with_changed_files(
+                dst_dirpath):
+            pass
+        shutil.rmtree(dst_dirpath)
+
+    return run
+
+
+@benchmark('gcm.export_disc_to_iso')
+def _gcm_export_disc_to_iso(tmp_dir: str) -> callable:
+    iso_filepath = os.path.join(tmp_dir, 'input.iso')
+    _build_stock_shaped_iso(iso_filepath)
+    output_filepath = os.path.join(tmp_dir, 'output.iso')
+    gcm_file = gcm.GCM(iso_filepath)
+    gcm_file.read_entire_disc()
+
+    def run():
+        for _filepath, _files_done in gcm_file.export_disc_to_iso_with_changed_files(
+                output_filepath):
+            pass
+
+    return run
+
+
+@benchmark('gcm.export_disc_to_delta')
+def _gcm_export_disc_to_delta(tmp_dir: str) -> callable:
+    iso_filepath = os.path.join(tmp_dir, 'input.iso')
+    _build_stock_shaped_iso(iso_filepath)
+    output_filepath = os.path.join(tmp_dir, 'output.patch')
+    gcm_file = gcm.GCM(iso_filepath)
+    gcm_file.read_entire_disc()
+
+    def run():
+        for _filepath, _files_done in gcm_file.export_disc_to_iso_with_changed_files(
+                output_filepath, delta=True):
+            pass
+
+    return run
+
+
+@benchmark('gcm.apply_delta_patch')
+def _gcm_apply_delta_patch(tmp_dir: str) -> callable:
+    iso_filepath = os.path.join(tmp_dir, 'input.iso')
+    _build_stock_shaped_iso(iso_filepath)
+    patch_filepath = os.path.join(tmp_dir, 'output.patch')
+    output_filepath = os.path.join(tmp_dir, 'output.iso')
+    gcm_file = gcm.GCM(iso_filepath)
+    gcm_file.read_entire_disc()
+    for _filepath, _files_done in gcm_file.export_disc_to_iso_with_changed_files(
+            patch_filepath, delta=True):
+        pass
+
+    return lambda: gcm.apply_delta_patch(iso_filepath, patch_filepath, output_filepath)
+
+
+def _write_stock_shaped_dol(dol_filepath: str, game_id: str):
+    """
+    Writes a DOL file with a single text section that spans up to the arena, which contains the
+    values that the code patcher expects to find in a retail DOL file.
+    """
+    start_address = 0x80003100
+    end_address = code_patcher.OSARENALO_ADDRESSES[game_id]
+    header = bytearray(0x100)
+    struct.pack_into('>I', header, 0x00, len(header))
+    struct.pack_into('>I', header, 0x48, start_address)
+    struct.pack_into('>I', header, 0x90, end_address - start_address)
+    struct.pack_into('>I', header, 0xD8, end_address)
+    body = bytearray(end_address - start_address)
+
+    def write(address: int, data: bytes):
+        body[address - start_address:address - start_address + len(data)] = data
+
+    # `lis r3, hi; addi r3, r3, lo; addi r0, r3, 31; rlwinm r3, r0, 0, 0, 26`
+    hi, lo = end_address >> 16, (end_address & 0xFFFF) - 31
+    if lo >= 0x8000:
+        hi, lo = hi + 1, lo - 0x10000
+    write(code_patcher.OSARENALO_INSTRUCTIONS_ADDRESSES[game_id],
+          struct.pack('>HHHhII', 0x3C60, hi, 0x3863, lo, 0x3803001F, 0x54030034))
+    for course, addresses in code_patcher.COURSE_TO_MINIMAP_ADDRESSES[game_id].items():
+        values = code_patcher.COURSE_TO_MINIMAP_VALUES[course]
+        for address, value in zip(addresses[:4], values[:4]):
+            write(address, struct.pack('>f', value))
+        write(addresses[4], struct.pack('>I', 0x38E00000 | values[4]))  # `li r7, orientation`
+    for string, address in code_patcher.STRING_ADDRESSES[game_id].items():
+        write(address, string.encode('ascii'))
+
+    with open(dol_filepath, 'wb') as f:
+        f.write(header + body)
+
+
+def _register_code_patcher_benchmarks():
+    for page_count in (3, 10, 27):
+
+        @benchmark(f'code_patcher.patch_dol_file.{page_count}_pages')
+        def _patch_dol_file(tmp_dir: str, page_count: int = page_count) -> callable:
+            game_id = 'GM4E01'
+            dol_filepath = os.path.join(tmp_dir, 'main.dol')
+            src_dol_filepath = os.path.join(tmp_dir, 'stock.dol')
+            _write_stock_shaped_dol(src_dol_filepath, game_id)
+
+            replaces_data = {}
+            minimap_data = {}
+            tilt_setting_data = {}
+            section_count_data = {}
+            for page_index in range(1, page_count):
+                for track_index in range(mkdd_extender.RACE_AND_BATTLE_COURSE_COUNT):
+                    course = code_patcher.COURSES[track_index]
+                    replaces_data[(page_index, track_index)] = course
+                    minimap_data[(page_index, track_index)] = (
+                        code_patcher.COURSE_TO_MINIMAP_VALUES[course])
+                    tilt_setting_data[(page_index, track_index)] = 0
+                    section_count_data[(page_index, track_index)] = 0
+            audio_track_data = tuple(
+                tuple(14 + (track_index + page_index) % 20 for track_index in range(32))
+                for page_index in range(page_count))
+
+            args = mkdd_extender.create_args_parser().parse_args(['input', 'tracks', 'output'])
+            quiet_log = logging.getLogger('benchmark.code_patcher')
+            quiet_log.setLevel(logging.WARNING)
+
+            def run():
+                shutil.copyfile(src_dol_filepath, dol_filepath)
+                code_patcher.patch_dol_file(tmp_dir, game_id, args, 1, False, replaces_data,
+                                            minimap_data, tilt_setting_data,
+                                            section_count_data, audio_track_data, (), True, True,
+                                            True, True, True, True, dol_filepath, quiet_log, False)
+
+            return run
+
+
+_register_ast_converter_benchmarks()
+_register_bti_benchmarks()
+_register_code_patcher_benchmarks()
+
+
+def run_benchmark(name: str, repeat: int) -> 'dict[str, float]':
+    with tempfile.TemporaryDirectory(prefix='mkddext_benchmark_') as tmp_dir:
+        func = BENCHMARKS[name](tmp_dir)
+
+        # Warm-up run, which also populates the page cache.
+        func()
+
+        timings = []
+        gc_was_enabled = gc.isenabled()
+        gc.disable()
+        try:
+            for _i in range(repeat):
+                start_time = time.perf_counter()
+                func()
+                timings.append(time.perf_counter() - start_time)
+        finally:
+            if gc_was_enabled:
+                gc.enable()
+
+    timings.sort()
+    return {
+        'median': timings[len(timings) // 2],
+        'min': timings[0],
+        'max': timings[-1],
+        'repeat': repeat,
+    }
+
+
+def get_environment() -> 'dict[str, str]':
+    return {
+        'python': platform.python_version(),
+        'platform': platform.platform(),
+        'machine': platform.machine(),
+        'processor': platform.processor(),
+        'cpu_count': os.cpu_count(),
+        'numpy': ast_converter._NUMPY_AVAILABLE and bti._NUMPY_AVAILABLE,
+    }
+
+
+def main() -> int:
+    logging.basicConfig(format='%(asctime)s %(levelname)-8s %(message)s',
+                        level=logging.INFO,
+                        datefmt='%Y-%m-%d %H:%M:%S')
+
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--filter',
+                        type=str,
+                        help='Regular expression that the names of the benchmarks that are to be '
+                        'run need to match.')
+    parser.add_argument('--list', action='store_true', help='If specified, lists the benchmarks.')
+    parser.add_argument('--repeat',
+                        type=int,
+                        default=5,
+                        help='Number of timed runs of each benchmark. The median is compared.')
+    parser.add_argument('--baseline',
+                        type=str,
+                        help='Path to a baseline file that the results are compared against.')
+    parser.add_argument('--save-baseline',
+                        type=str,
+                        help='Path where the results will be saved as a baseline file. Results of '
+                        'the benchmarks that are not run are preserved if the file already exists.')
+    parser.add_argument('--threshold',
+                        type=float,
+                        default=0.10,
+                        help='Relative slowdown (over the median in the baseline) from which a '
+                        'benchmark is reported as a regression. Default is `0.10` (10%%).')
+    args = parser.parse_args()
+
+    names = [name for name in BENCHMARKS if not args.filter or re.search(args.filter, name)]
+    if args.list:
+        print('\n'.join(names))
+        return 0
+    if not names:
+        log.error('No benchmark matches the given filter.')
+        return 1
+
+    # The build cache would turn the compilation benchmarks into a file copy.
+    code_patcher.BUILD_CACHE_DIR = None
+
+    baseline_results = {}
+    if args.baseline:
+        with open(args.baseline, 'r', encoding='utf-8') as f:
+            baseline = json.load(f)
+        if baseline.get('version') != BASELINE_VERSION:
+            log.error(f'Unsupported baseline version in "{args.baseline}".')
+            return 1
+        if baseline['environment'] != get_environment():
+            log.warning('The baseline has been recorded in a different environment; results may '
+                        'not be comparable.')
+        baseline_results = baseline['results']
+
+    results = {}
+    regressions = []
+    failures = []
+    name_width = max(len(name) for name in names)
+    print(f'{"Benchmark":<{name_width}}  {"Median":>10}  {"Min":>10}  {"Baseline":>10}  Change')
+    for name in names:
+        try:
+            result = run_benchmark(name, max(1, args.repeat))
+        except Exception as e:
+            log.error(f'Benchmark "{name}" failed: {str(e)}')
+            failures.append(name)
+            continue
+        results[name] = result
+
+        line = f'{name:<{name_width}}  {result["median"]:>10.4f}  {result["min"]:>10.4f}'
+        baseline_result = baseline_results.get(name)
+        if baseline_result is not None:
+            change = result['median'] / baseline_result['median'] - 1.0
+            line += f'  {baseline_result["median"]:>10.4f}  {change:+.1%}'
+            if change > args.threshold:
+                line += '  REGRESSION'
+                regressions.append(name)
+        print(line, flush=True)
+
+    if args.save_baseline:
+        saved_results = {}
+        if os.path.isfile(args.save_baseline):
+            with open(args.save_baseline, 'r', encoding='utf-8') as f:
+                saved_results = json.load(f).get('results', {})
+        saved_results.update(results)
+        with open(args.save_baseline, 'w', encoding='utf-8') as f:
+            json.dump(
+                {
+                    'version': BASELINE_VERSION,
+                    'environment': get_environment(),
+                    'results': dict(sorted(saved_results.items())),
+                },
+                f,
+                indent=4)
+        log.info(f'Baseline saved to "{args.save_baseline}".')
+
+    if regressions:
+        log.error(f'{len(regressions)} benchmarks have regressed: {", ".join(regressions)}.')
+    if failures:
+        log.error(f'{len(failures)} benchmarks have failed: {", ".join(failures)}.')
+
+    return 1 if regressions or failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
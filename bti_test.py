@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the `bti` module.
+"""
+# pylint: disable=protected-access
+
+import io
+import random
+import sys
+
+import pytest
+from PIL import Image
+
+from tools import bti
+
+IMAGE_SIZES = ((1, 1), (3, 7), (8, 4), (8, 8), (13, 9), (64, 32), (100, 37))
+
+# The vectorized CMPR encoder chooses the key colors differently; it is not expected to produce the
+# same output as the naive implementation.
+LOSSLESS_NUMPY_IMAGE_FORMATS = [f for f in bti.NUMPY_IMAGE_FORMATS if f != bti.ImageFormat.CMPR]
+
+
+def _generate_image(width: int, height: int, seed: int) -> Image.Image:
+    rng = random.Random(seed)
+    data = bytearray(rng.randbytes(width * height * 4))
+    # Make a fair amount of the pixels fully opaque, or fully transparent, as encoders tend to treat
+    # these values differently.
+    for i in range(3, len(data), 4):
+        if i % 3 == 0:
+            data[i] = 0xFF
+        elif i % 5 == 0:
+            data[i] = 0x00
+    return Image.frombytes('RGBA', (width, height), bytes(data))
+
+
+def _generate_smooth_image(width: int, height: int, seed: int) -> Image.Image:
+    rng = random.Random(seed)
+    data = bytearray()
+    for y in range(height):
+        for x in range(width):
+            r = x * 255 // width
+            g = y * 255 // height
+            b = (x + y) * 255 // (width + height)
+            r, g, b = (max(0, min(255, c + rng.randint(-8, 8))) for c in (r, g, b))
+            a = 0x00 if (x // 5 + y // 3) % 7 == 0 else 0xFF
+            data.extend((r, g, b, a))
+    return Image.frombytes('RGBA', (width, height), bytes(data))
+
+
+def _encode(image: Image.Image, image_format: bti.ImageFormat, use_numpy: bool) -> bytes:
+    previous_value = bti._NUMPY_AVAILABLE
+    try:
+        bti._NUMPY_AVAILABLE = use_numpy
+        image_data, _palette_data, _encoded_colors = bti.encode_image(image, image_format,
+                                                                      bti.PaletteFormat.RGB5A3)
+        return bti.read_all_bytes(image_data)
+    finally:
+        bti._NUMPY_AVAILABLE = previous_value
+
+
+def _decode(image_data: bytes, image_format: bti.ImageFormat, width: int, height: int,
+            use_numpy: bool) -> bytes:
+    previous_value = bti._NUMPY_AVAILABLE
+    try:
+        bti._NUMPY_AVAILABLE = use_numpy
+        image = bti.decode_image(io.BytesIO(image_data), io.BytesIO(), image_format,
+                                 bti.PaletteFormat.RGB5A3, 0, width, height)
+        return image.tobytes()
+    finally:
+        bti._NUMPY_AVAILABLE = previous_value
+
+
+def test_numpy_is_available():
+    assert bti._NUMPY_AVAILABLE
+
+
+@pytest.mark.parametrize('image_format', LOSSLESS_NUMPY_IMAGE_FORMATS)
+def test_encode_numpy_matches_naive(image_format: bti.ImageFormat):
+    for seed, (width, height) in enumerate(IMAGE_SIZES):
+        image = _generate_image(width, height, seed)
+        assert _encode(image, image_format, True) == _encode(image, image_format, False)
+
+
+@pytest.mark.parametrize('image_format', bti.NUMPY_IMAGE_FORMATS)
+def test_decode_numpy_matches_naive(image_format: bti.ImageFormat):
+    block_width = bti.BLOCK_WIDTHS[image_format]
+    block_height = bti.BLOCK_HEIGHTS[image_format]
+    block_data_size = bti.BLOCK_DATA_SIZES[image_format]
+
+    for seed, (width, height) in enumerate(IMAGE_SIZES):
+        blocks_wide = (width + block_width - 1) // block_width
+        blocks_tall = (height + block_height - 1) // block_height
+        image_data = random.Random(seed).randbytes(blocks_wide * blocks_tall * block_data_size)
+
+        assert (_decode(image_data, image_format, width, height, True) == _decode(
+            image_data, image_format, width, height, False))
+
+
+def test_encode_cmpr_numpy_quality():
+    image_format = bti.ImageFormat.CMPR
+
+    for seed, (width, height) in enumerate(IMAGE_SIZES):
+        image = _generate_smooth_image(width, height, seed)
+        original_pixels = image.tobytes()
+
+        errors = []
+        for use_numpy in (True, False):
+            image_data = _encode(image, image_format, use_numpy)
+            pixels = _decode(image_data, image_format, width, height, False)
+
+            error = 0
+            for i in range(0, len(pixels), 4):
+                if original_pixels[i + 3] == 0x00:
+                    assert pixels[i + 3] == 0x00
+                else:
+                    assert pixels[i + 3] == 0xFF
+                    error += sum(abs(original_pixels[i + j] - pixels[i + j]) for j in range(3))
+            errors.append(error / (width * height))
+
+        numpy_error, naive_error = errors
+        assert numpy_error <= naive_error * 1.25 + 1.0
+
+
+def test_create_bti_data_from_image():
+    image = _generate_image(13, 9, 0)
+
+    for image_format in LOSSLESS_NUMPY_IMAGE_FORMATS:
+        data = bti.create_bti_data_from_image(image, image_format)
+
+        bti_image = bti.BTI(io.BytesIO(data))
+        assert bti_image.image_format == image_format
+        assert (bti_image.width, bti_image.height) == image.size
+        assert (bti_image.wrap_s, bti_image.wrap_t) == (bti.WrapMode.ClampToEdge, ) * 2
+        assert bti_image.mipmap_count == 1
+        assert bti.read_all_bytes(bti_image.image_data) == _encode(image, image_format, False)
+
+
+if __name__ == '__main__':
+    sys.exit(pytest.main(sys.argv))
@@ -38,6 +38,18 @@ if (not devkit_tools.GCCPATH and not devkit_tools.LDPATH and not devkit_tools.OB
     devkit_tools.OBJDUMPPATH = os.path.join(devkitppc_dir, f'powerpc-eabi-objdump{exe_extension}')
     devkit_tools.OBJCOPYPATH = os.path.join(devkitppc_dir, f'powerpc-eabi-objcopy{exe_extension}')
 
+BUILD_CACHE_DIR = os.environ.get('MKDD_EXTENDER_BUILD_CACHE_DIR')
+"""
+Optional path to a directory where the outputs of the compiler and the linker are cached, keyed on
+the content of the (already substituted) C code, the symbols map, the toolchain, and the flags.
+Builds that generate the same code (e.g. builds that only differ in the course assets) skip the
+compilation altogether. The toolchain is identified by the version output of the compiler driver,
+`cc1`, `as`, the linker and `objcopy`, and the size of their binaries.
+
+Entries are never evicted: the directory grows without limit (one entry, with the outputs of the
+compiler and the linker, for every distinct build), and can be deleted at any time.
+"""
+
 BUTTONS_STATE_ADDRESSES = {
     'GM4E01': 0x803A4D6C,
     'GM4P01': 0x803AEB8C,
@@ -156,7 +168,19 @@ is a better text for the screen anyway.
 GP_GLOBAL_COURSE_INDEX_ADDRESSES = {k: v + 1 for k, v in GP_INITIAL_PAGE_ADDRESSES.items()}
 """
 Memory address where the global course index in the Extender Cup code patch is stored. Defined as
-the next byte after the initial page.
+the next byte after the initial page. Two bytes (big-endian) are reserved, as the index can exceed
+255 when there are more than 15 pages.
+"""
+
+LOADED_PAGE_ADDRESSES = {k: v + 2 for k, v in GP_GLOBAL_COURSE_INDEX_ADDRESSES.items()}
+"""
+Memory address where the index of the page whose values are currently written in memory (string
+suffixes, minimap values, and audio stream file indexes) is stored. Defined as the next byte after
+the two bytes of the global course index.
+
+This is not always the same as the current page: in the Extender Cup, the current page is set
+directly before the page change is requested, and the values of the new page will be written based
+on the differences with the page that is actually loaded.
 """
 
 PLAYER_ITEM_ROLLS_ADDRESSES = {
@@ -252,6 +276,14 @@ COURSES_TO_COURSE_ID = {
 Course ID as defined internally in the game.
 """
 
+MIN_COURSE_ID = min(COURSES_TO_COURSE_ID.values())
+"""
+The lowest course ID. Bitsets that are indexed by course ID are offset by this value. It needs to
+match the `MIN_COURSE_ID` constant in the C code.
+"""
+assert MIN_COURSE_ID == 0x21
+assert max(COURSES_TO_COURSE_ID.values()) - MIN_COURSE_ID < 32
+
 COURSE_TO_MINIMAP_ADDRESSES = {
     'GM4E01': {
         'BabyLuigi': (0x803CDDEC, 0x803CDDF0, 0x803CDDF4, 0x803CDDF8, 0x80141E14),
@@ -1104,6 +1136,10 @@ IS_TILTING_COURSE_CALL_ADDRESSES = {
 The address to a `lwz` instruction in `Course::reset()` that will be replaced with a function call
 that leaves in `r3` whether the course in the current slot and in the current page is a tilting
 course. The next instruction to this address will be replaced, too, to compare whether `r3` is `1`.
+
+If the Sectioned Courses code patch is enabled, the same call also looks up the section count of the
+course, which `override_total_lap_count()` reads later, when the lap checkers of the karts are set
+up.
 """
 
 CUP_FILENAMES_ARRAY_INSTRUCTION_ADDRESSES = {
@@ -1236,28 +1272,6 @@ The address to the one place from where `ItemShuffleMgr::calcSlot()` is called.
 instruction will be hijacked to add support for type-specific item boxes.
 """
 
-RESET_SECTION_COUNT_CALL_ADDRESSES = {
-    'GM4E01': 0x80179298,
-    'GM4P01': 0x8017813C,
-    'GM4J01': 0x80179298,
-    'GM4E01dbg': 0x801996D8,
-}
-"""
-The address to the area in memory where the branch-link to `reset_section_count` will be inserted.
-This is called during `loadCrsData` to reset the section counter.
-"""
-
-COUNT_SECTION_POINT_CALL_ADDRESSES = {
-    'GM4E01': 0x8017C7D4,
-    'GM4P01': 0x8017B678,
-    'GM4J01': 0x8017C7D4,
-    'GM4E01dbg': 0x8019DE28,
-}
-"""
-The address to the area in memory where the branch-link to `count_section_point` will be inserted.
-This is called during `setPointData` and increments the section counter in memory.
-"""
-
 OVERRIDE_TOTAL_LAP_COUNT_CALL_ADDRESSES = {
     'GM4E01': 0x80187E24,
     'GM4P01': 0x80186CC8,
@@ -1378,6 +1392,40 @@ Minimal symbols map for each region.
 """
 
 
+CACHE_LINE_SIZE = 32
+"""
+The size (in bytes) of the lines in the data and instruction caches of the Gekko CPU.
+"""
+
+PERFORMANCE_COUNTER_NAMES = (
+    'scenecourseselect_calcanm_ex',
+    'lanselectmode_calcanm_ex',
+    'scenemapselect_calcanm_ex',
+    'change_course_page',
+    'itemshufflemgr_calcslot_ex',
+    'check_lap_ex',
+)
+"""
+The injected entry points that are measured when performance counters are enabled, in the order in
+which their counters are laid out in the `g_performance_counters` array in `lib.c`.
+
+Each counter is a 16-byte struct: call count (u32), max ticks (u32), and total ticks (u64), in
+big-endian and in ticks of the Time Base Register (40.5 MHz). Counters of entry points that are not
+injected (e.g. when the corresponding code patch is disabled) remain zero.
+"""
+
+PERFORMANCE_COUNTER_SIZE = 16
+"""
+The size (in bytes) of each of the structs in the `g_performance_counters` array.
+"""
+
+COMPACT_COORDINATES_MIN_SCALE = 1.0 / 256.0
+"""
+The finest scale (i.e. the value of one unit) of the fixed-point minimap coordinates that are
+generated when compact code data is requested.
+"""
+
+
 @contextlib.contextmanager
 def current_directory(dirpath):
     cwd = os.getcwd()
@@ -1392,6 +1440,10 @@ def aligned(value: int, alignment: int = 32) -> int:
     return (value | alignment - 1) + 1 if value % alignment else value
 
 
+def cache_line(address: int) -> int:
+    return address & ~(CACHE_LINE_SIZE - 1)
+
+
 def find_char_offset_in_string(string: str) -> int:
     if string.startswith('/'):
         # Find the first slash (/) character (after position 1, as some strings start with a forward
@@ -1406,6 +1458,28 @@ def find_char_offset_in_string(string: str) -> int:
     return len(os.path.splitext(string)[0]) - 1
 
 
+def build_adjacent_page_diff_masks(page_values: 'list[list]') -> 'list[int]':
+    """
+    Returns, for each page, a bitmask with the slots whose values differ between the page and the
+    next page (wrapping around).
+
+    As only adjacent pages are compared, `change_course_page()` can use the mask at index `p` to
+    switch between page `p` and page `p + 1` in either direction.
+    """
+    page_count = len(page_values)
+    masks = []
+    for page_index in range(page_count):
+        values = page_values[page_index]
+        next_values = page_values[(page_index + 1) % page_count]
+        assert len(values) == len(next_values) <= 32
+        mask = 0
+        for i, (value, next_value) in enumerate(zip(values, next_values)):
+            if value != next_value:
+                mask |= 1 << i
+        masks.append(mask)
+    return masks
+
+
 def read_osarena(dol_path, game_id) -> int:
     with open(dol_path, 'rb') as f:
         dol_file = dolreader.DolFile(f)
@@ -1442,13 +1516,15 @@ def read_osarena(dol_path, game_id) -> int:
 
 
 def patch_bti_filenames_in_blo_file(game_id: str, battle_stages_enabled: bool, blo_path: str):
+    import mkdd_extender  # pylint: disable=import-outside-toplevel
+
     with open(blo_path, 'rb') as f:
         data = f.read()
 
     for string in get_string_addresses(game_id, battle_stages_enabled):
         char_offset = find_char_offset_in_string(string)
         new_string = bytearray(string, encoding='ascii')
-        new_string[char_offset] = ord('0')
+        new_string[char_offset] = ord(mkdd_extender.PAGE_INDEX_CHARACTERS[0])
         string = bytes(string, encoding='ascii')
         data = data.replace(string, new_string)
 
@@ -1465,7 +1541,9 @@ def patch_dol_file(
     replaces_data: dict,
     minimap_data: dict,
     tilt_setting_data: dict,
+    section_count_data: dict,
     audio_track_data: 'tuple[tuple[int]]',
+    file_list: 'tuple[str]',
     battle_stages_enabled: bool,
     remove_movie_trailer: bool,
     extender_cup: bool,
@@ -1481,6 +1559,11 @@ def patch_dol_file(
     log.info('Generating and injecting C code...')
 
     initial_page_index = initial_page_number - 1
+    compact_code_data = bool(args.compact_code_data)
+    lazy_course_page_data = bool(args.lazy_course_page_data)
+    instant_mapselect_refresh = bool(args.instant_map_select_refresh)
+    performance_counters = bool(args.performance_counters)
+    code_optimization = args.code_optimization or 'O1'
     page_count = len(audio_track_data)
     page_course_count = (mkdd_extender.RACE_AND_BATTLE_COURSE_COUNT
                          if battle_stages_enabled else mkdd_extender.RACE_TRACK_COUNT)
@@ -1510,7 +1593,7 @@ def patch_dol_file(
         char_address = address + char_offset
         char_addresses.append(f'(char*)0x{char_address:08X}')
     char_addresses = ', '.join(char_addresses)
-    string_data_code_lines.append(f'char* char_addresses[] = {{{char_addresses}}};')
+    string_data_code_lines.append(f'static char* const char_addresses[] = {{{char_addresses}}};')
     string_data_code = '\n'.join(string_data_code_lines)
 
     # Read initial minimap values.
@@ -1526,9 +1609,23 @@ def patch_dol_file(
         initial_minimap_values['Mini8'] = initial_minimap_values['Mini8 (2)']
     course_to_minimap_addresses['Mini8'] = course_to_minimap_addresses['Mini8 (2)']
 
+    # Minimap values of each course in each page.
+    page_minimap_values = []
+    for page_index in range(page_count):
+        values = []
+        for track_index in range(page_course_count):
+            if page_index == 0:
+                values.append(initial_minimap_values[COURSES[track_index]])
+            else:
+                values.append(minimap_data[(page_index, track_index)])
+        page_minimap_values.append(values)
+
+    # Size of the data that the compact encoding has saved in the generated tables.
+    saved_data_size = 0
+
     # Minimap data.
     minimap_data_code_lines = []
-    minimap_data_code_lines.append('float* const coordinates_addresses[] = {')
+    minimap_data_code_lines.append('static float* const coordinates_addresses[] = {')
     for track_index in range(page_course_count):
         if track_index > 0:
             minimap_data_code_lines.append(',')
@@ -1537,65 +1634,126 @@ def patch_dol_file(
             comma = '' if i == 0 else ', '
             minimap_data_code_lines.append(f'{comma}(float*)0x{addresses[i]:08X}')
     minimap_data_code_lines.append('};')
-    minimap_data_code_lines.append('char* const orientations_addresses[] = {')
+    minimap_data_code_lines.append('static char* const orientations_addresses[] = {')
     for track_index in range(page_course_count):
         if track_index > 0:
             minimap_data_code_lines.append(',')
         addresses = course_to_minimap_addresses[COURSES[track_index]]
         minimap_data_code_lines.append(f'(char*)0x{addresses[4] + 3:08X}')
     minimap_data_code_lines.append('};')
+    # The modified `li` instructions need to be flushed from the caches. To flush each cache line
+    # only once, the distinct cache lines are gathered, and each course is mapped to its line.
+    orientations_cache_lines = sorted(
+        set(
+            cache_line(course_to_minimap_addresses[COURSES[track_index]][4] + 3)
+            for track_index in range(page_course_count)))
+    assert len(orientations_cache_lines) <= 32
+    orientations_cache_lines_code = ', '.join(f'(char*)0x{address:08X}'
+                                              for address in orientations_cache_lines)
     minimap_data_code_lines.append(
-        f'const float coordinates[PAGE_COUNT][{page_course_count} * 4] = {{')
+        f'static char* const orientations_cache_lines[] = {{{orientations_cache_lines_code}}};')
+    orientations_cache_line_indexes_code = ', '.join(
+        str(
+            orientations_cache_lines.index(
+                cache_line(course_to_minimap_addresses[COURSES[track_index]][4] + 3)))
+        for track_index in range(page_course_count))
+    minimap_data_code_lines.append('static const unsigned char orientations_cache_line_indexes[] = '
+                                   f'{{{orientations_cache_line_indexes_code}}};')
+    if compact_code_data:
+        # Coordinates are stored as 16-bit fixed-point values, with the finest power-of-two scale
+        # that can represent all the coordinates in a signed short.
+        max_coordinate = max(
+            abs(value) for page_values in page_minimap_values for values in page_values
+            for value in values[:4])
+        coordinates_scale = COMPACT_COORDINATES_MIN_SCALE
+        while max_coordinate / coordinates_scale > 32767:
+            coordinates_scale *= 2
+        minimap_data_code_lines.append(f'const float coordinates_scale = {coordinates_scale}f;')
+        coordinates_data_type = 'short'
+        coordinates_data_size = 2
+    else:
+        coordinates_data_type = 'float'
+        coordinates_data_size = 4
+    minimap_data_code_lines.append(f'static const {coordinates_data_type} '
+                                   f'coordinates[PAGE_COUNT][{page_course_count} * 4] = {{')
     for page_index in range(page_count):
         minimap_data_code_lines.append('{' if page_index == 0 else ', {')
         for track_index in range(page_course_count):
             if track_index > 0:
                 minimap_data_code_lines.append(',')
-            if page_index == 0:
-                values = initial_minimap_values[COURSES[track_index]]
-            else:
-                values = minimap_data[(page_index, track_index)]
+            values = page_minimap_values[page_index][track_index]
             for i in range(4):
                 comma = '' if i == 0 else ', '
-                minimap_data_code_lines.append(f'{comma}{values[i]}f')
+                if compact_code_data:
+                    minimap_data_code_lines.append(f'{comma}{round(values[i] / coordinates_scale)}')
+                else:
+                    minimap_data_code_lines.append(f'{comma}{values[i]}f')
         minimap_data_code_lines.append('}')
     minimap_data_code_lines.append('};')
-    minimap_data_code_lines.append(f'const char orientations[PAGE_COUNT][{page_course_count}] = {{')
+    minimap_data_code_lines.append(f'const {coordinates_data_type}* const page_coordinates = '
+                                   'coordinates[(int)page];')
+    saved_data_size += (4 - coordinates_data_size) * page_count * page_course_count * 4
+    minimap_data_code_lines.append(
+        f'static const char orientations[PAGE_COUNT][{page_course_count}] = {{')
     for page_index in range(page_count):
         minimap_data_code_lines.append('{' if page_index == 0 else ', {')
         for track_index in range(page_course_count):
             if track_index > 0:
                 minimap_data_code_lines.append(',')
-            if page_index == 0:
-                values = initial_minimap_values[COURSES[track_index]]
-            else:
-                values = minimap_data[(page_index, track_index)]
+            values = page_minimap_values[page_index][track_index]
             minimap_data_code_lines.append(f'{values[4]}')
         minimap_data_code_lines.append('}')
     minimap_data_code_lines.append('};')
+    coordinates_diff_masks = build_adjacent_page_diff_masks(
+        [[values[:4] for values in page_values] for page_values in page_minimap_values])
+    orientations_diff_masks = build_adjacent_page_diff_masks(
+        [[values[4] for values in page_values] for page_values in page_minimap_values])
+    coordinates_diff_masks = ', '.join(f'0x{mask:08X}' for mask in coordinates_diff_masks)
+    orientations_diff_masks = ', '.join(f'0x{mask:08X}' for mask in orientations_diff_masks)
+    minimap_data_code_lines.append(
+        f'static const unsigned int coordinates_diff_masks[PAGE_COUNT] = '
+        f'{{{coordinates_diff_masks}}};')
+    minimap_data_code_lines.append(
+        f'static const unsigned int orientations_diff_masks[PAGE_COUNT] = '
+        f'{{{orientations_diff_masks}}};')
     minimap_data_code = '\n'.join(minimap_data_code_lines)
 
     # Audio track indices.
-    max_audio_index = -1
+    min_audio_index = min(min(audio_indexes) for audio_indexes in audio_track_data)
+    max_audio_index = max(max(audio_indexes) for audio_indexes in audio_track_data)
+    # In compact mode, indexes are stored relative to the lowest index; stream files are
+    # contiguous in the file list, so the offsets will normally fit in a byte.
+    audio_indexes_base = min_audio_index if compact_code_data else 0
     audio_data_code_lines = []
+    audio_data_code_lines.append(f'const unsigned int audio_indexes_base = {audio_indexes_base};')
+    audio_data_type = 'char' if max_audio_index - audio_indexes_base <= 255 else 'short'
+    audio_data_code_lines.append(
+        f'static const unsigned {audio_data_type} audio_indexes[PAGE_COUNT][32] = {{')
     for page_index, audio_indexes in enumerate(audio_track_data):
         audio_data_code_lines.append('{' if page_index == 0 else ', {')
         for i, audio_index in enumerate(audio_indexes):
             if i > 0:
                 audio_data_code_lines.append(',')
-            max_audio_index = max(max_audio_index, audio_index)
-            audio_data_code_lines.append(f'{audio_index}')
+            audio_data_code_lines.append(f'{audio_index - audio_indexes_base}')
         audio_data_code_lines.append('}')
     audio_data_code_lines.append('};')
-    audio_data_type = 'char' if max_audio_index <= 255 else 'short'
-    audio_data_code_lines.insert(0, f'const {audio_data_type} audio_indexes[PAGE_COUNT][32] = {{')
     audio_data_code_lines.append(f'const unsigned {audio_data_type}* const page_audio_indexes = '
-                                 f'(const unsigned {audio_data_type}*)audio_indexes[(int)page];')
+                                 'audio_indexes[(int)page];')
+    if audio_data_type == 'char' and max_audio_index > 255:
+        saved_data_size += page_count * 32
+    audio_diff_masks = build_adjacent_page_diff_masks(audio_track_data)
+    audio_diff_masks = ', '.join(f'0x{mask:08X}' for mask in audio_diff_masks)
+    audio_data_code_lines.append(
+        f'static const unsigned int audio_diff_masks[PAGE_COUNT] = {{{audio_diff_masks}}};')
     audio_data_code = '\n'.join(audio_data_code_lines)
 
     # Tilting courses data.
     page_tilting_courses = collections.defaultdict(list)
     page_tilting_courses[0].append(COURSES.index('Mini5'))  # Just Tilt-A-Kart in first page.
+    if not battle_stages_enabled:
+        # Battle stages are not paged; the stock Tilt-A-Kart is played in every page.
+        for page_index in range(1, page_count):
+            page_tilting_courses[page_index].append(COURSES.index('Mini5'))
     for page_index in range(page_count):
         if page_index == 0:  # First page already handled.
             continue
@@ -1607,294 +1765,337 @@ def patch_dol_file(
             if (replaces_data[key] == 'Mini5'
                     or (tilting_courses and tilt_setting_data[key] == 0x02)):
                 page_tilting_courses[page_index].append(track_index)
-    tilting_data_code_lines = []
-    for page_index, track_indexes in page_tilting_courses.items():
-        tilting_data_code_lines.append('else if' if tilting_data_code_lines else 'if')
-        tilting_data_code_lines.append(f' (page == {page_index}) {{')
-        for track_index in track_indexes:
+    # A bitset (indexed by course ID) is generated for each page.
+    tilting_masks = []
+    for page_index in range(page_count):
+        mask = 0
+        for track_index in page_tilting_courses[page_index]:
             course_id = COURSES_TO_COURSE_ID[COURSES[track_index]]
-            tilting_data_code_lines.append(f'if (course_id == {course_id}) {{ return true; }}')
-        tilting_data_code_lines.append('}')
-    tilting_data_code = '\n'.join(tilting_data_code_lines)
-
-    # Addresses to symbols that are only known after the first pass.
-    extender_cup_cup_filenames_address = None
-    extender_cup_preview_filename_address = None
-
-    for pass_number in range(2):
-        # The project is going to be built twice; the size of the new DOL section needs to be known
-        # to determine the OS Arena, which needs too be known to determine the offset required for
-        # certain of the addresses that appear in the C code that refer to dynamic memory. When the
-        # OS Arena changes, these addresses need to be offset too, based on the new value, and the
-        # retail value.
+            mask |= 1 << (course_id - MIN_COURSE_ID)
+        tilting_masks.append(mask)
+    tilting_masks = ', '.join(f'0x{mask:08X}' for mask in tilting_masks)
+    tilting_data_code = (
+        f'static const unsigned int tilting_masks[PAGE_COUNT] = {{{tilting_masks}}};')
+
+    # Section count data. The number of section points in each race track is looked up when the
+    # course is reset, and used as the lap count. Race tracks in the first page, and courses without
+    # section points, are assigned `0`, which leaves the lap count untouched.
+    race_track_count = mkdd_extender.RACE_TRACK_COUNT
+    race_track_by_course_bit = [-1] * (max(
+        COURSES_TO_COURSE_ID[COURSES[track_index]]
+        for track_index in range(race_track_count)) - MIN_COURSE_ID + 1)
+    for track_index in range(race_track_count):
+        course_id = COURSES_TO_COURSE_ID[COURSES[track_index]]
+        race_track_by_course_bit[course_id - MIN_COURSE_ID] = track_index
+    section_counts = []
+    for page_index in range(page_count):
+        counts = [
+            0 if page_index == 0 else section_count_data.get((page_index, track_index), 0)
+            for track_index in range(race_track_count)
+        ]
+        section_counts.append(f'{{{", ".join(str(count) for count in counts)}}}')
+    section_count_data_code = '\n'.join((
+        'static const signed char race_track_by_course_bit[] = '
+        f'{{{", ".join(str(i) for i in race_track_by_course_bit)}}};',
+        f'static const unsigned char section_counts[PAGE_COUNT][{race_track_count}] = '
+        f'{{{", ".join(section_counts)}}};',
+    ))
+
+    # Address to a symbol that is only known once the injected code has been linked.
+    performance_counters_address = None
+
+    def patch_symbols(dol_file, symbols):
+        # Addresses in dynamic memory are offset by the growth of the OS Arena, which is known only
+        # once the injected code has been linked.
         offset = aligned(unaligned_new_osarena_value) - OSARENALO_ADDRESSES[game_id]
+        dol_file.seek(symbols['g_course_to_stream_file_indexes'])
+        dolreader.write_uint32(dol_file, COURSE_TO_STREAM_FILE_INDEX_ADDRESSES[game_id] + offset)
+
+        if extender_cup:
+            extender_cup_cup_filenames_address = symbols['g_extender_cup_cup_filenames']
+            dol_file.seek(CUP_FILENAMES_ARRAY_INSTRUCTION_ADDRESSES[game_id])
+            doltools.write_lis(dol_file, 3, extender_cup_cup_filenames_address >> 16, signed=False)
+            dol_file.seek(CUP_FILENAMES_ARRAY_INSTRUCTION_ADDRESSES[game_id] + 8)
+            doltools.write_ori(dol_file, 3, 28, extender_cup_cup_filenames_address & 0x0000FFFF)
+
+            extender_cup_preview_filename_address = symbols['g_extender_cup_preview_filenames']
+            for address in PREVIEW_FILENAMES_ARRAY_INSTRUCTIONS_ADDRESSES[game_id]:
+                dol_file.seek(address)
+                doltools.write_lis(dol_file,
+                                   4,
+                                   extender_cup_preview_filename_address >> 16,
+                                   signed=False)
+                dol_file.seek(address + 0x04)
+                doltools.write_ori(dol_file, 4, 4,
+                                   extender_cup_preview_filename_address & 0x0000FFFF)
+
+        if performance_counters:
+            nonlocal performance_counters_address
+            performance_counters_address = symbols['g_performance_counters']
+
+    # Load the C file and replace constants and placeholders.
+    replacements = (
+        ('__ALT_BUTTONS_STATE_ADDRESS__', f'0x{ALT_BUTTONS_STATE_ADDRESSES[game_id]:08X}'),
+        ('__BATTLE_STAGES__', str(int(battle_stages_enabled))),
+        ('__BUTTONS_STATE_ADDRESS__', f'0x{BUTTONS_STATE_ADDRESSES[game_id]:08X}'),
+        ('__COMPACT_CODE_DATA__', str(int(compact_code_data))),
+        ('__CURRENT_PAGE_ADDRESS__', f'0x{CURRENT_PAGE_ADDRESSES[game_id]:08X}'),
+        ('__EXTENDER_CUP__', str(int(extender_cup))),
+        ('__GAMEAUDIO_MAIN_ADDRESS__', f'0x{GAMEAUDIO_MAIN_ADDRESSES[game_id]:08X}'),
+        ('__GM4E01_DEBUG_BUILD__', str(int(game_id == 'GM4E01dbg'))),
+        ('__GP_AWARDED_SCORES_ADDRESS__', f'0x{GP_AWARDED_SCORES_ADDRESSES[game_id]:08X}'),
+        ('__GP_COURSE_INDEX_ADDRESS__', f'0x{GP_COURSE_INDEX_ADDRESSES[game_id]:08X}'),
+        ('__GP_CUP_INDEX_ADDRESS__', f'0x{GP_CUP_INDEX_ADDRESSES[game_id]:08X}'),
+        ('__GP_GLOBAL_COURSE_INDEX_ADDRESS__',
+         f'0x{GP_GLOBAL_COURSE_INDEX_ADDRESSES[game_id]:08X}'),
+        ('__GP_INITIAL_PAGE_ADDRESS__', f'0x{GP_INITIAL_PAGE_ADDRESSES[game_id]:08X}'),
+        ('__INSTANT_MAPSELECT_REFRESH__', str(int(instant_mapselect_refresh))),
+        ('__LAN_STRUCT_ADDRESS__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][0]:08X}'),
+        ('__LAN_STRUCT_OFFSET1__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][1]:04X}'),
+        ('__LAN_STRUCT_OFFSET2__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][2]:04X}'),
+        ('__LAN_STRUCT_OFFSET3__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][3]:04X}'),
+        ('__LAN_STRUCT_OFFSET4__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][4]:04X}'),
+        ('__LAN_STRUCT_OFFSET5__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][5]:04X}'),
+        ('__LAZY_COURSE_PAGE_DATA__', str(int(lazy_course_page_data))),
+        ('__LOADED_PAGE_ADDRESS__', f'0x{LOADED_PAGE_ADDRESSES[game_id]:08X}'),
+        ('__PAGE_COUNT__', f'{page_count}'),
+        ('__PAGE_INDEX_CHARACTERS__', f'"{mkdd_extender.PAGE_INDEX_CHARACTERS[:page_count]}"'),
+        ('__PERFORMANCE_COUNTERS__', str(int(performance_counters))),
+        ('__PLAYER_ITEM_ROLLS_ADDRESS__', f'0x{PLAYER_ITEM_ROLLS_ADDRESSES[game_id]:08X}'),
+        ('__REDRAW_COURSESELECT_SCREEN_ADDRESS__',
+         f'0x{REDRAW_COURSESELECT_SCREEN_ADDRESSES[game_id]:08X}'),
+        ('__SPAM_FLAG_ADDRESS__', f'0x{SPAM_FLAG_ADDRESSES[game_id]:08X}'),
+        ('__USE_ALT_BUTTONS__', str(int(use_alternative_buttons))),
+        ('__TILTING_COURSES__', str(int(tilting_courses))),
+        ('__TYPE_SPECIFIC_ITEM_BOXES__', str(int(type_specific_item_boxes))),
+        ('__SECTIONED_COURSES__', str(int(sectioned_courses))),
+        ('// __AUDIO_DATA_PLACEHOLDER__', audio_data_code),
+        ('// __MINIMAP_DATA_PLACEHOLDER__', minimap_data_code),
+        ('// __STRING_DATA_PLACEHOLDER__', string_data_code),
+        ('// __TILTING_DATA_PLACEHOLDER__', tilting_data_code),
+        ('// __SECTION_COUNT_DATA_PLACEHOLDER__', section_count_data_code),
+    )
+    with open(os.path.join(code_dir, 'lib.c'), 'r', encoding='ascii') as f:
+        code = f.read()
+    for name, value in replacements:
+        code = code.replace(name, value)
+
+    with tempfile.TemporaryDirectory(prefix=mkdd_extender.TEMP_DIR_PREFIX) as tmp_dir:
+        with current_directory(tmp_dir):
+            project = devkit_tools.Project(dol_path, address=dol_section_address)
+            project.set_osarena_patcher(patch_osarena)
+            project.set_post_link_patcher(patch_symbols)
+            if BUILD_CACHE_DIR:
+                project.set_build_cache_dir(BUILD_CACHE_DIR)
+            project.set_optimize(f'-{code_optimization}')
+            # Code that is not reachable from the hooks (e.g. the functions of disabled features or
+            # the helpers that have been inlined) is stripped from the injected code. The symbols
+            # that are only referenced from the DOL file need to be kept explicitly.
+            project.set_gc_sections(True)
+            project.keep_symbol('g_course_to_stream_file_indexes')
+            if extender_cup:
+                project.keep_symbol('g_extender_cup_cup_filenames')
+                project.keep_symbol('g_extender_cup_preview_filenames')
+            if performance_counters:
+                project.keep_symbol('g_performance_counters')
+
+            # Initialize static variables.
+            project.dol.seek(SPAM_FLAG_ADDRESSES[game_id])
+            project.dol.write(b'\0')
+            project.dol.seek(CURRENT_PAGE_ADDRESSES[game_id])
+            project.dol.write(initial_page_index.to_bytes(1, 'big'))
+            project.dol.seek(LOADED_PAGE_ADDRESSES[game_id])
+            project.dol.write(initial_page_index.to_bytes(1, 'big'))
+            if extender_cup:
+                project.dol.seek(GP_GLOBAL_COURSE_INDEX_ADDRESSES[game_id])
+                project.dol.write(b'\0\0')
+            if type_specific_item_boxes:
+                project.dol.seek(PLAYER_ITEM_ROLLS_ADDRESSES[game_id])
+                project.dol.write(b'\xff\xff\xff\xff\xff\xff\xff\xff')
+
+            # Initialize the strings with the character of the initial page.
+            for string, address in string_addresses.items():
+                char_offset = find_char_offset_in_string(string)
+                char_address = address + char_offset
+                project.dol.seek(char_address)
+                project.dol.write(
+                    mkdd_extender.PAGE_INDEX_CHARACTERS[initial_page_index].encode('ascii'))
+
+            # Set up minimap coordinates for the selected initial page.
+            for track_index in range(page_course_count):
+                addresses = course_to_minimap_addresses[COURSES[track_index]]
+                values = page_minimap_values[initial_page_index][track_index]
+                for i in range(4):
+                    project.dol.seek(addresses[i])
+                    project.dol.write(struct.pack('>f', values[i]))
+                project.dol.seek(addresses[4] + 3)
+                project.dol.write(struct.pack('>B', values[4]))
+
+            if not args.skip_menu_titles:
+                project.dol.seek(LAN_MENU_TITLE_INDEX_INSTRUCTION_ADDRESSES[game_id] + 3)
+                project.dol.write(b'\4')
+
+            if battle_stages_enabled:
+                project.dol.seek(LUIGIS_MANSION_AUDIO_STREAM_ADDRESSES[game_id] + 3)
+                project.dol.write(b'\x23')
+
+                # The four offsets to Pipe Plaza's coordinates array can be seen in a number of
+                # `lfs` instructions near the `li` instruction that defines the orientation.
+                # These instructions need to be tweaked to point to the unused array. The base
+                # offset is hardcoded: it's the first offset seen in the `default:` case in the
+                # `switch` in `Race2D::__ct()`.
+                pipe_plaza_orientation_address = course_to_minimap_addresses['Mini8'][4]
+                base_offset = 0x9A70 if game_id != 'GM4E01dbg' else 0xA164
+                for i, offset_from_li_instruction_address in enumerate((24, 16, 4, -4)):
+                    lfs_instruction_address = \
+                        pipe_plaza_orientation_address + offset_from_li_instruction_address
+                    project.dol.seek(lfs_instruction_address)
+                    lfs_instruction = dolreader.read_uint32(project.dol)
+                    lfs_instruction = (lfs_instruction & 0xFFFF0000) | (base_offset - i * 4)
+                    project.dol.seek(lfs_instruction_address)
+                    dolreader.write_uint32(project.dol, lfs_instruction)
+
+            with open('symbols.txt', 'w', encoding='ascii') as f:
+                f.write(SYMBOLS_MAP[game_id])
+            project.add_linker_file('symbols.txt')
+
+            with open('lib.c', 'w', encoding='ascii') as f:
+                f.write(code)
+
+            project.add_file('lib.c')
+            if code_optimization == 'Os':
+                # With `-Os`, the compiler saves and restores the callee-saved registers through
+                # out-of-line functions, normally provided by libgcc (which is not linked). They
+                # fall through into each other, and are therefore kept as a whole (244 bytes).
+                shutil.copyfile(os.path.join(code_dir, 'savres.s'), 'savres.s')
+                project.add_asm_file('savres.s')
+
+            # Page selection logic.
+            project.branchlink(SCENECOURSESELECT_CALCANM_CALL_ADDRESSES[game_id],
+                               'scenecourseselect_calcanm_ex')
+            if battle_stages_enabled:
+                project.branchlink(SCENEMAPSELECT_CALCANM_CALL_ADDRESSES[game_id],
+                                   'scenemapselect_calcanm_ex')
+            if (battle_stages_enabled or tilting_courses or lazy_course_page_data
+                    or sectioned_courses):
+                project.branchlink(IS_TILTING_COURSE_CALL_ADDRESSES[game_id], 'is_tilting_course')
+                project.dol.seek(IS_TILTING_COURSE_CALL_ADDRESSES[game_id] + 4)
+                project.dol.write(struct.pack('>I', 0x2C030001))  # cmpwi r3, 0x1
+            project.branchlink(LANSELECTMODE_CALCANM_CALL_ADDRESSES[game_id],
+                               'lanselectmode_calcanm_ex')
+
+            if remove_movie_trailer:
+                project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][0])
+                doltools.write_li(project.dol, 0, 3)
+                project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][1])
+                doltools.write_nop(project.dol)
+                project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][2])
+                doltools.write_li(project.dol, 0, 1)
+                if game_id == 'GM4E01dbg':
+                    for address in SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][3]:
+                        project.dol.seek(address)
+                        dolreader.write_uint32(project.dol, 0x48000038)  # b +14
+
+            # Code extensions.
+            if extender_cup:
+                project.dol.seek(GP_TOTAL_COURSE_COUNT_INSTRUCTION_ADDRESSES[game_id])
+                doltools.write_li(project.dol, 24, page_count * 16)
+                project.branchlink(ON_GP_ABOUR_TO_START_INSERTION_ADDRESSES[game_id],
+                                   'on_gp_about_to_start')
+                project.branchlink(GET_GP_COURSE_INDEX_INSERTION_ADDRESSES[game_id],
+                                   'get_gp_course_index')
+                project.branchlink(SEQUENCEINFO_SETCLRGPCOURSE_CALL_ADDRESSES[game_id],
+                                   'sequenceinfo_setclrgpcourse_ex')
+
+            if type_specific_item_boxes:
+                project.branchlink(ITEMOBJMGR_ISAVAILABLEROLLINGSLOT_CALL_ADDRESSES[game_id],
+                                   'itemobjmgr_isavailablerollingslot_ex')
+                project.branchlink(ITEMSHUFFLEMGR_CALCSLOT_CALL_ADDRESSES[game_id],
+                                   'itemshufflemgr_calcslot_ex')
+
+            if sectioned_courses:
+                project.branchlink(OVERRIDE_TOTAL_LAP_COUNT_CALL_ADDRESSES[game_id],
+                                   'override_total_lap_count')
+                project.branchlink(CHECK_LAP_EX_CALL_ADDRESSES[game_id], 'check_lap_ex')
+
+            project.build(dol_path)
+            if project.build_cache_hit:
+                log.info('Build cache hit.')
+
+            # Diagnosis logging only if enabled on the user end.
+            if debug_output:
+                # If Clang-Format is available in the system, run the C file through it.
+                shutil.copyfile(os.path.join(code_dir, '.clang-format'), '.clang-format')
+                try:
+                    subprocess.call(('clang-format', '-i', 'lib.c'))
+                except Exception:
+                    pass
+
+                with open('lib.c', 'r', encoding='ascii') as f:
+                    print('#' * 80)
+                    print(f'{" C Code ":#^80}')
+                    print('#' * 80)
+                    print(f.read())
 
-        # Load the C file and replace constants and placeholders.
-        replacements = (
-            ('__ALT_BUTTONS_STATE_ADDRESS__', f'0x{ALT_BUTTONS_STATE_ADDRESSES[game_id]:08X}'),
-            ('__BATTLE_STAGES__', str(int(battle_stages_enabled))),
-            ('__BUTTONS_STATE_ADDRESS__', f'0x{BUTTONS_STATE_ADDRESSES[game_id]:08X}'),
-            ('__COURSE_TO_STREAM_FILE_INDEX_ADDRESS__',
-             f'0x{COURSE_TO_STREAM_FILE_INDEX_ADDRESSES[game_id] + offset:08X}'),
-            ('__CURRENT_PAGE_ADDRESS__', f'0x{CURRENT_PAGE_ADDRESSES[game_id]:08X}'),
-            ('__EXTENDER_CUP__', str(int(extender_cup))),
-            ('__GAMEAUDIO_MAIN_ADDRESS__', f'0x{GAMEAUDIO_MAIN_ADDRESSES[game_id]:08X}'),
-            ('__GM4E01_DEBUG_BUILD__', str(int(game_id == 'GM4E01dbg'))),
-            ('__GP_AWARDED_SCORES_ADDRESS__', f'0x{GP_AWARDED_SCORES_ADDRESSES[game_id]:08X}'),
-            ('__GP_COURSE_INDEX_ADDRESS__', f'0x{GP_COURSE_INDEX_ADDRESSES[game_id]:08X}'),
-            ('__GP_CUP_INDEX_ADDRESS__', f'0x{GP_CUP_INDEX_ADDRESSES[game_id]:08X}'),
-            ('__GP_GLOBAL_COURSE_INDEX_ADDRESS__',
-             f'0x{GP_GLOBAL_COURSE_INDEX_ADDRESSES[game_id]:08X}'),
-            ('__GP_INITIAL_PAGE_ADDRESS__', f'0x{GP_INITIAL_PAGE_ADDRESSES[game_id]:08X}'),
-            ('__LAN_STRUCT_ADDRESS__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][0]:08X}'),
-            ('__LAN_STRUCT_OFFSET1__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][1]:04X}'),
-            ('__LAN_STRUCT_OFFSET2__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][2]:04X}'),
-            ('__LAN_STRUCT_OFFSET3__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][3]:04X}'),
-            ('__LAN_STRUCT_OFFSET4__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][4]:04X}'),
-            ('__LAN_STRUCT_OFFSET5__', f'0x{LAN_STRUCT_ADDRESSES_AND_OFFSETS[game_id][5]:04X}'),
-            ('__PAGE_COUNT__', f'{page_count}'),
-            ('__PLAYER_ITEM_ROLLS_ADDRESS__', f'0x{PLAYER_ITEM_ROLLS_ADDRESSES[game_id]:08X}'),
-            ('__REDRAW_COURSESELECT_SCREEN_ADDRESS__',
-             f'0x{REDRAW_COURSESELECT_SCREEN_ADDRESSES[game_id]:08X}'),
-            ('__SPAM_FLAG_ADDRESS__', f'0x{SPAM_FLAG_ADDRESSES[game_id]:08X}'),
-            ('__USE_ALT_BUTTONS__', str(int(use_alternative_buttons))),
-            ('__TILTING_COURSES__', str(int(tilting_courses))),
-            ('__TYPE_SPECIFIC_ITEM_BOXES__', str(int(type_specific_item_boxes))),
-            ('__SECTIONED_COURSES__', str(int(sectioned_courses))),
-            ('// __AUDIO_DATA_PLACEHOLDER__', audio_data_code),
-            ('// __MINIMAP_DATA_PLACEHOLDER__', minimap_data_code),
-            ('// __STRING_DATA_PLACEHOLDER__', string_data_code),
-            ('// __TILTING_DATA_PLACEHOLDER__', tilting_data_code),
-        )
-        with open(os.path.join(code_dir, 'lib.c'), 'r', encoding='ascii') as f:
-            code = f.read()
-        for name, value in replacements:
-            code = code.replace(name, value)
-
-        with tempfile.TemporaryDirectory(prefix=mkdd_extender.TEMP_DIR_PREFIX) as tmp_dir:
-            with current_directory(tmp_dir):
-                project = devkit_tools.Project(dol_path, address=dol_section_address)
-                project.set_osarena_patcher(patch_osarena)
-
-                # Initialize static variables.
-                project.dol.seek(SPAM_FLAG_ADDRESSES[game_id])
-                project.dol.write(b'\0')
-                project.dol.seek(CURRENT_PAGE_ADDRESSES[game_id])
-                project.dol.write(initial_page_index.to_bytes(1, 'big'))
-                if extender_cup:
-                    project.dol.seek(GP_GLOBAL_COURSE_INDEX_ADDRESSES[game_id])
-                    project.dol.write(b'\0')
-                if type_specific_item_boxes:
-                    project.dol.seek(PLAYER_ITEM_ROLLS_ADDRESSES[game_id])
-                    project.dol.write(b'\xff\xff\xff\xff\xff\xff\xff\xff')
-
-                # Initialize the strings with the character of the first page ('0').
-                for string, address in string_addresses.items():
-                    char_offset = find_char_offset_in_string(string)
-                    char_address = address + char_offset
-                    project.dol.seek(char_address)
-                    project.dol.write(str(initial_page_index).encode('utf-8'))
-
-                # Set up minimap coordinates for the selected initial page.
-                for track_index in range(page_course_count):
-                    addresses = course_to_minimap_addresses[COURSES[track_index]]
-                    if initial_page_index == 0:
-                        values = initial_minimap_values[COURSES[track_index]]
-                    else:
-                        values = minimap_data[(initial_page_index, track_index)]
-                    for i in range(4):
-                        project.dol.seek(addresses[i])
-                        project.dol.write(struct.pack('>f', values[i]))
-                    project.dol.seek(addresses[4] + 3)
-                    project.dol.write(struct.pack('>B', values[4]))
-
-                if not args.skip_menu_titles:
-                    project.dol.seek(LAN_MENU_TITLE_INDEX_INSTRUCTION_ADDRESSES[game_id] + 3)
-                    project.dol.write(b'\4')
-
-                if battle_stages_enabled:
-                    project.dol.seek(LUIGIS_MANSION_AUDIO_STREAM_ADDRESSES[game_id] + 3)
-                    project.dol.write(b'\x23')
-
-                    # The four offsets to Pipe Plaza's coordinates array can be seen in a number of
-                    # `lfs` instructions near the `li` instruction that defines the orientation.
-                    # These instructions need to be tweaked to point to the unused array. The base
-                    # offset is hardcoded: it's the first offset seen in the `default:` case in the
-                    # `switch` in `Race2D::__ct()`.
-                    pipe_plaza_orientation_address = course_to_minimap_addresses['Mini8'][4]
-                    base_offset = 0x9A70 if game_id != 'GM4E01dbg' else 0xA164
-                    for i, offset_from_li_instruction_address in enumerate((24, 16, 4, -4)):
-                        lfs_instruction_address = \
-                            pipe_plaza_orientation_address + offset_from_li_instruction_address
-                        project.dol.seek(lfs_instruction_address)
-                        lfs_instruction = dolreader.read_uint32(project.dol)
-                        lfs_instruction = (lfs_instruction & 0xFFFF0000) | (base_offset - i * 4)
-                        project.dol.seek(lfs_instruction_address)
-                        dolreader.write_uint32(project.dol, lfs_instruction)
-
-                with open('symbols.txt', 'w', encoding='ascii') as f:
-                    f.write(SYMBOLS_MAP[game_id])
-                project.add_linker_file('symbols.txt')
-
-                with open('lib.c', 'w', encoding='ascii') as f:
-                    f.write(code)
-
-                project.add_file('lib.c')
-
-                # Page selection logic.
-                project.branchlink(SCENECOURSESELECT_CALCANM_CALL_ADDRESSES[game_id],
-                                   'scenecourseselect_calcanm_ex')
-                if battle_stages_enabled:
-                    project.branchlink(SCENEMAPSELECT_CALCANM_CALL_ADDRESSES[game_id],
-                                       'scenemapselect_calcanm_ex')
-                if battle_stages_enabled or tilting_courses:
-                    project.branchlink(IS_TILTING_COURSE_CALL_ADDRESSES[game_id],
-                                       'is_tilting_course')
-                    project.dol.seek(IS_TILTING_COURSE_CALL_ADDRESSES[game_id] + 4)
-                    project.dol.write(struct.pack('>I', 0x2C030001))  # cmpwi r3, 0x1
-                project.branchlink(LANSELECTMODE_CALCANM_CALL_ADDRESSES[game_id],
-                                   'lanselectmode_calcanm_ex')
-
-                if remove_movie_trailer:
-                    project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][0])
-                    doltools.write_li(project.dol, 0, 3)
-                    project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][1])
-                    doltools.write_nop(project.dol)
-                    project.dol.seek(SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][2])
-                    doltools.write_li(project.dol, 0, 1)
-                    if game_id == 'GM4E01dbg':
-                        for address in SKIP_MOVIE_TRAILER_INSTRUCTIONS_ADDRESSES[game_id][3]:
-                            project.dol.seek(address)
-                            dolreader.write_uint32(project.dol, 0x48000038)  # b +14
-
-                # Code extensions.
-                if extender_cup:
-                    project.dol.seek(GP_TOTAL_COURSE_COUNT_INSTRUCTION_ADDRESSES[game_id])
-                    doltools.write_li(project.dol, 24, page_count * 16)
-                    project.branchlink(ON_GP_ABOUR_TO_START_INSERTION_ADDRESSES[game_id],
-                                       'on_gp_about_to_start')
-                    project.branchlink(GET_GP_COURSE_INDEX_INSERTION_ADDRESSES[game_id],
-                                       'get_gp_course_index')
-                    project.branchlink(SEQUENCEINFO_SETCLRGPCOURSE_CALL_ADDRESSES[game_id],
-                                       'sequenceinfo_setclrgpcourse_ex')
-
-                    if pass_number == 1:
-                        project.dol.seek(CUP_FILENAMES_ARRAY_INSTRUCTION_ADDRESSES[game_id])
-                        doltools.write_lis(project.dol,
-                                           3,
-                                           extender_cup_cup_filenames_address >> 16,
-                                           signed=False)
-                        project.dol.seek(CUP_FILENAMES_ARRAY_INSTRUCTION_ADDRESSES[game_id] + 8)
-                        doltools.write_ori(project.dol, 3, 28,
-                                           extender_cup_cup_filenames_address & 0x0000FFFF)
-
-                        for address in PREVIEW_FILENAMES_ARRAY_INSTRUCTIONS_ADDRESSES[game_id]:
-                            project.dol.seek(address)
-                            doltools.write_lis(project.dol,
-                                               4,
-                                               extender_cup_preview_filename_address >> 16,
-                                               signed=False)
-                            project.dol.seek(address + 0x04)
-                            doltools.write_ori(project.dol, 4, 4,
-                                               extender_cup_preview_filename_address & 0x0000FFFF)
-
-                if type_specific_item_boxes:
-                    project.branchlink(ITEMOBJMGR_ISAVAILABLEROLLINGSLOT_CALL_ADDRESSES[game_id],
-                                       'itemobjmgr_isavailablerollingslot_ex')
-                    project.branchlink(ITEMSHUFFLEMGR_CALCSLOT_CALL_ADDRESSES[game_id],
-                                       'itemshufflemgr_calcslot_ex')
-
-                if sectioned_courses:
-                    project.branchlink(RESET_SECTION_COUNT_CALL_ADDRESSES[game_id],
-                                       'reset_section_count')
-                    project.branchlink(COUNT_SECTION_POINT_CALL_ADDRESSES[game_id],
-                                       'count_section_point')
-                    project.branchlink(OVERRIDE_TOTAL_LAP_COUNT_CALL_ADDRESSES[game_id],
-                                       'override_total_lap_count')
-                    project.branchlink(CHECK_LAP_EX_CALL_ADDRESSES[game_id], 'check_lap_ex')
-
-                project.build('main.dol' if pass_number == 0 else dol_path)
-
-                # Further symbol post-processing once the map is available.
-                if pass_number == 0:
-                    if extender_cup:
-                        with open('project.map', 'r', encoding='ascii') as f:
-                            for line in f:
-                                if 'g_extender_cup_cup_filenames' in line:
-                                    extender_cup_cup_filenames_address = int(line.split()[0],
-                                                                             base=16)
-                                elif 'g_extender_cup_preview_filenames' in line:
-                                    extender_cup_preview_filename_address = int(line.split()[0],
-                                                                                base=16)
-                        assert extender_cup_cup_filenames_address is not None
-                        assert extender_cup_preview_filename_address is not None
-
-                # Diagnosis logging only if enabled on the user end.
-                if pass_number == 1 and debug_output:
-                    # If Clang-Format is available in the system, run the C file through it.
-                    shutil.copyfile(os.path.join(code_dir, '.clang-format'), '.clang-format')
-                    try:
-                        subprocess.call(('clang-format', '-i', 'lib.c'))
-                    except Exception:
-                        pass
-
-                    with open('lib.c', 'r', encoding='ascii') as f:
-                        print('#' * 80)
-                        print(f'{" C Code ":#^80}')
-                        print('#' * 80)
-                        print(f.read())
-
-                    with open('lib.c.s', 'r', encoding='ascii') as f:
-                        print('#' * 80)
-                        print(f'{" Assembly Code ":#^80}')
-                        print('#' * 80)
-                        print(f.read())
-
-                    with open('project.map', 'r', encoding='ascii') as f:
-                        print('#' * 80)
-                        print(f'{" Symbols Map ":#^80}')
-                        print('#' * 80)
-                        print(f.read())
+                with open('lib.c.s', 'r', encoding='ascii') as f:
+                    print('#' * 80)
+                    print(f'{" Assembly Code ":#^80}')
+                    print('#' * 80)
+                    print(f.read())
 
+                with open('project.map', 'r', encoding='ascii') as f:
                     print('#' * 80)
-                    print(f'{" Object Dump ":#^80}')
+                    print(f'{" Symbols Map ":#^80}')
                     print('#' * 80)
-                    devkit_tools.objdump('project.o', '--full-content')
+                    print(f.read())
+
+                print('#' * 80)
+                print(f'{" Symbol Sizes ":#^80}')
+                print('#' * 80)
+                section_sizes = devkit_tools.read_input_section_sizes('project.map')
+                for name, size in sorted(section_sizes.items(), key=lambda e: (-e[1], e[0])):
+                    if name.startswith(('.comment', '.eh_frame', '.gnu.attributes')):
+                        continue  # Stripped from the binary.
+                    print(f'{size:>8}  {name}')
+                print(f'{injected_code_size:>8}  (total, including alignment)')
+
+                print('#' * 80)
+                print(f'{" Object Dump ":#^80}')
+                print('#' * 80)
+                devkit_tools.objdump('project.o', '--full-content')
 
     if initial_page_index > 0:
         # Audio track indexes need to be adjusted for the selected initial page. This is done by
         # rewriting the BSFT file where each course's audio ID is mapped to a file in the `Stream`
-        # directory. This makes the game load the audio indexes of the selected initial page.
+        # directory. This makes the game load the audio indexes of the selected initial page. The
+        # BSFT section is patched in place; the rest of the BAA file is left untouched.
 
         files_dirpath = os.path.join(iso_tmp_dir, 'files')
         baa_filepath = os.path.join(files_dirpath, 'AudioRes', 'GCKart.baa')
 
-        with tempfile.TemporaryDirectory(prefix=mkdd_extender.TEMP_DIR_PREFIX) as tmp_dir:
-            baa.unpack_baa(baa_filepath, tmp_dir)
-
-            for name in os.listdir(tmp_dir):
-                if name.endswith('.bsft'):
-                    bsft_filepath = os.path.join(tmp_dir, name)
-                    break
-            else:
-                raise RuntimeError('Unable to locate BSFT file in GCKart.baa.')
-
-            paths = [path for _offset, path in baa.read_bsft(bsft_filepath)]
-
-            audio_indexes = audio_track_data[initial_page_index]
-            file_list = mkdd_extender.build_file_list(iso_tmp_dir)
-            for i, audio_index in enumerate(audio_indexes):
-                paths[i] = file_list[audio_index].lstrip('files/')
+        paths = [path for _offset, path in baa.read_baa_bsft(baa_filepath)]
 
-            baa.write_bsft(paths, bsft_filepath)
-
-            # Although the standalone GCKart.bsft file (next to the GCKart.baa file) is not accessed
-            # in the game, it will be updated too for correctness.
-            standlone_bsft_filepath = os.path.join(f'{os.path.splitext(baa_filepath)[0]}.bsft')
-            shutil.copy2(bsft_filepath, standlone_bsft_filepath)
-
-            baa.pack_baa(tmp_dir, baa_filepath)
-
-    log.info(f'Injected {injected_code_size} bytes of new code. '
+        audio_indexes = audio_track_data[initial_page_index]
+        for i, audio_index in enumerate(audio_indexes):
+            paths[i] = file_list[audio_index].lstrip('files/')
+
+        baa.patch_baa_bsft(baa_filepath, paths)
+
+        # Although the standalone GCKart.bsft file (next to the GCKart.baa file) is not accessed in
+        # the game, it will be updated too for correctness.
+        standlone_bsft_filepath = os.path.join(f'{os.path.splitext(baa_filepath)[0]}.bsft')
+        baa.write_bsft(paths, standlone_bsft_filepath)
+
+    if performance_counters:
+        log.info(f'Performance counters at 0x{performance_counters_address:08X} (call count, max '
+                 f'ticks, and total ticks; {PERFORMANCE_COUNTER_SIZE} bytes each):')
+        for i, name in enumerate(PERFORMANCE_COUNTER_NAMES):
+            address = performance_counters_address + i * PERFORMANCE_COUNTER_SIZE
+            log.info(f'    0x{address:08X}: {name}()')
+
+    saved_data_size_text = ''
+    if compact_code_data:
+        saved_data_size_text = f' ({saved_data_size} bytes of table data saved by compact encoding)'
+    log.info(f'Injected {injected_code_size} bytes of new code{saved_data_size_text}. '
              f'OS Arena: 0x{aligned(unaligned_previous_osarena_value):08X} (previous) -> '
              f'0x{aligned(unaligned_new_osarena_value):08X} (new).')
@@ -14,7 +14,7 @@
 #define ALT_BUTTONS_STATE_ADDRESS __ALT_BUTTONS_STATE_ADDRESS__
 #define BATTLE_STAGES __BATTLE_STAGES__
 #define BUTTONS_STATE_ADDRESS __BUTTONS_STATE_ADDRESS__
-#define COURSE_TO_STREAM_FILE_INDEX_ADDRESS __COURSE_TO_STREAM_FILE_INDEX_ADDRESS__
+#define COMPACT_CODE_DATA __COMPACT_CODE_DATA__
 #define CURRENT_PAGE_ADDRESS __CURRENT_PAGE_ADDRESS__
 #define EXTENDER_CUP __EXTENDER_CUP__
 #define GAMEAUDIO_MAIN_ADDRESS __GAMEAUDIO_MAIN_ADDRESS__
@@ -24,13 +24,18 @@
 #define GP_CUP_INDEX_ADDRESS __GP_CUP_INDEX_ADDRESS__
 #define GP_GLOBAL_COURSE_INDEX_ADDRESS __GP_GLOBAL_COURSE_INDEX_ADDRESS__
 #define GP_INITIAL_PAGE_ADDRESS __GP_INITIAL_PAGE_ADDRESS__
+#define INSTANT_MAPSELECT_REFRESH __INSTANT_MAPSELECT_REFRESH__
 #define LAN_STRUCT_ADDRESS __LAN_STRUCT_ADDRESS__
 #define LAN_STRUCT_OFFSET1 __LAN_STRUCT_OFFSET1__
 #define LAN_STRUCT_OFFSET2 __LAN_STRUCT_OFFSET2__
 #define LAN_STRUCT_OFFSET3 __LAN_STRUCT_OFFSET3__
 #define LAN_STRUCT_OFFSET4 __LAN_STRUCT_OFFSET4__
 #define LAN_STRUCT_OFFSET5 __LAN_STRUCT_OFFSET5__
+#define LAZY_COURSE_PAGE_DATA __LAZY_COURSE_PAGE_DATA__
+#define LOADED_PAGE_ADDRESS __LOADED_PAGE_ADDRESS__
 #define PAGE_COUNT __PAGE_COUNT__
+#define PAGE_INDEX_CHARACTERS __PAGE_INDEX_CHARACTERS__
+#define PERFORMANCE_COUNTERS __PERFORMANCE_COUNTERS__
 #define PLAYER_ITEM_ROLLS_ADDRESS __PLAYER_ITEM_ROLLS_ADDRESS__
 #define REDRAW_COURSESELECT_SCREEN_ADDRESS __REDRAW_COURSESELECT_SCREEN_ADDRESS__
 #define SPAM_FLAG_ADDRESS __SPAM_FLAG_ADDRESS__
@@ -39,46 +44,188 @@
 #define TYPE_SPECIFIC_ITEM_BOXES __TYPE_SPECIFIC_ITEM_BOXES__
 #define SECTIONED_COURSES __SECTIONED_COURSES__
 
-void change_course_page(const int delta)
+#if PERFORMANCE_COUNTERS
+
+// The order needs to match `PERFORMANCE_COUNTER_NAMES` in `code_patcher.py`.
+#define SCENECOURSESELECT_CALCANM_COUNTER 0
+#define LANSELECTMODE_CALCANM_COUNTER 1
+#define SCENEMAPSELECT_CALCANM_COUNTER 2
+#define CHANGE_COURSE_PAGE_COUNTER 3
+#define ITEMSHUFFLEMGR_CALCSLOT_COUNTER 4
+#define CHECK_LAP_EX_COUNTER 5
+#define PERFORMANCE_COUNTER_COUNT 6
+
+// Measured in ticks of the Time Base Register, that in the GameCube runs at a quarter of the bus
+// clock frequency (40.5 MHz).
+struct PerformanceCounter
 {
-    const int previous_page = (int)(*(char*)CURRENT_PAGE_ADDRESS);
-    const int page = (previous_page + delta + PAGE_COUNT) % PAGE_COUNT;
-    *(char*)CURRENT_PAGE_ADDRESS = (char)page;
+    unsigned int call_count;
+    unsigned int max_ticks;
+    unsigned long long total_ticks;
+};
 
-    const char suffix = '0' + page;
-    // __STRING_DATA_PLACEHOLDER__
-    for (int i = 0; i < (int)(sizeof(char_addresses) / sizeof(char*)); ++i)
+// Explicitly placed in the data section, as zero-initialized variables would otherwise be placed
+// in a section that is not part of the injected code.
+struct PerformanceCounter g_performance_counters[PERFORMANCE_COUNTER_COUNT]
+    __attribute__((section(".data"))) = {{0}};
+
+void record_performance_counter(const int index, const unsigned int start_ticks)
+{
+    unsigned int end_ticks;
+    asm volatile("mftb %0" : "=r"(end_ticks));
+    const unsigned int ticks = end_ticks - start_ticks;
+
+    struct PerformanceCounter* const counter = &g_performance_counters[index];
+    ++counter->call_count;
+    counter->total_ticks += ticks;
+    if (ticks > counter->max_ticks)
     {
-        *(char_addresses[i]) = suffix;
+        counter->max_ticks = ticks;
+    }
+}
+
+// Some of the hooks rely on registers that the compiler is not aware of (`r0`, `r3`, and `r9` hold
+// values, and `r29` and `r30` hold pointers in the caller's frame). Those registers are excluded
+// from the Time Base Register read, and the start value is kept in the stack.
+#define BEGIN_PERFORMANCE_COUNTER()                                                            \
+    volatile unsigned int performance_counter_start;                                           \
+    asm volatile("mftb %0" : "=r"(performance_counter_start) : : "r0", "r3", "r9", "r29", "r30")
+#define END_PERFORMANCE_COUNTER(index) record_performance_counter(index, performance_counter_start)
+
+#else
+
+#define BEGIN_PERFORMANCE_COUNTER()
+#define END_PERFORMANCE_COUNTER(index)
+
+#endif
+
+// The course-to-stream file index array lives in dynamic memory, which starts after the injected
+// code. Since its address depends on the final size of the injected code, the pointer is patched in
+// the DOL file once the code has been linked.
+unsigned int* g_course_to_stream_file_indexes = (unsigned int*)0xFFFFFFFF;
+
+// Returns the index of the entry in the `*_diff_masks` tables that flags the slots that differ
+// between the two given pages, or -1 if the pages are not adjacent (in which case all slots are
+// assumed to be different).
+int get_diff_mask_index(const int page_a, const int page_b)
+{
+    if ((page_a + 1) % PAGE_COUNT == page_b)
+    {
+        return page_a;
+    }
+    if ((page_b + 1) % PAGE_COUNT == page_a)
+    {
+        return page_b;
+    }
+    return -1;
+}
+
+// Writes the minimap values and the audio track indices of the current page, which the game does
+// not read until a course is loaded.
+void load_course_page_data()
+{
+    const int page = (int)(*(char*)CURRENT_PAGE_ADDRESS);
+
+    // Only the values that differ from the ones that are currently in memory need to be written.
+    const int loaded_page = (int)(*(char*)LOADED_PAGE_ADDRESS);
+    if (page == loaded_page)
+    {
+        return;
     }
+    *(char*)LOADED_PAGE_ADDRESS = (char)page;
+    const int diff_mask_index = get_diff_mask_index(loaded_page, page);
 
     // __MINIMAP_DATA_PLACEHOLDER__
-    const float* const page_coordinates = coordinates[(int)page];
-    for (int i = 0; i < (BATTLE_STAGES ? 22 : 16) * 4; ++i)
+    const unsigned int coordinates_diff_mask =
+        diff_mask_index < 0 ? 0xFFFFFFFF : coordinates_diff_masks[diff_mask_index];
+    for (int i = 0; i < (BATTLE_STAGES ? 22 : 16); ++i)
     {
-        *coordinates_addresses[i] = page_coordinates[i];
+        if (!(coordinates_diff_mask & (1u << i)))
+        {
+            continue;
+        }
+        for (int j = i * 4; j < i * 4 + 4; ++j)
+        {
+#if COMPACT_CODE_DATA
+            *coordinates_addresses[j] = (float)page_coordinates[j] * coordinates_scale;
+#else
+            *coordinates_addresses[j] = page_coordinates[j];
+#endif
+        }
     }
+    const unsigned int orientations_diff_mask =
+        diff_mask_index < 0 ? 0xFFFFFFFF : orientations_diff_masks[diff_mask_index];
     const char* const page_orientations = orientations[(int)page];
+    unsigned int orientations_cache_lines_mask = 0;
     for (int i = 0; i < (BATTLE_STAGES ? 22 : 16); ++i)
     {
-        register char* const reg8 asm("r8") = orientations_addresses[i];
-        *reg8 = page_orientations[i];
-        // Using GPR 8, as that was the compiler's choice for storing the address to the
-        // instruction. Although not relevant, GPR 7 was/is used for storing the actual orientation.
-
-        // Invalidate the instruction block so that the new, modified `li` instruction that loads
-        // the orientation is picked up.
-        asm("dcbf 0, 8\n"
-            "sync\n"
-            "icbi 0, 8\n"
-            "isync\n");
+        if (!(orientations_diff_mask & (1u << i)))
+        {
+            continue;
+        }
+        *orientations_addresses[i] = page_orientations[i];
+        orientations_cache_lines_mask |= 1u << orientations_cache_line_indexes[i];
+    }
+    if (orientations_cache_lines_mask)
+    {
+        // Invalidate the instruction blocks so that the new, modified `li` instructions that load
+        // the orientations are picked up. Each cache line is flushed only once, and the pipeline is
+        // synchronized only once for all of them.
+        const int cache_line_count = (int)(sizeof(orientations_cache_lines) / sizeof(char*));
+        for (int i = 0; i < cache_line_count; ++i)
+        {
+            if (orientations_cache_lines_mask & (1u << i))
+            {
+                asm volatile("dcbf 0, %0" : : "r"(orientations_cache_lines[i]) : "memory");
+            }
+        }
+        asm volatile("sync");
+        for (int i = 0; i < cache_line_count; ++i)
+        {
+            if (orientations_cache_lines_mask & (1u << i))
+            {
+                asm volatile("icbi 0, %0" : : "r"(orientations_cache_lines[i]) : "memory");
+            }
+        }
+        asm volatile("sync\n"
+                     "isync\n");
     }
 
     // __AUDIO_DATA_PLACEHOLDER__
+    const unsigned int audio_diff_mask =
+        diff_mask_index < 0 ? 0xFFFFFFFF : audio_diff_masks[diff_mask_index];
     for (int i = 0; i < 32; ++i)
     {
-        ((unsigned int*)COURSE_TO_STREAM_FILE_INDEX_ADDRESS)[i] = page_audio_indexes[i];
+        if (audio_diff_mask & (1u << i))
+        {
+            g_course_to_stream_file_indexes[i] = audio_indexes_base + page_audio_indexes[i];
+        }
+    }
+}
+
+void change_course_page(const int delta)
+{
+    BEGIN_PERFORMANCE_COUNTER();
+
+    const int previous_page = (int)(*(char*)CURRENT_PAGE_ADDRESS);
+    const int page = (previous_page + delta + PAGE_COUNT) % PAGE_COUNT;
+    *(char*)CURRENT_PAGE_ADDRESS = (char)page;
+
+    // The filenames are needed right away, as the course selection screens show the images of the
+    // courses in the new page. Only one character is written per string, regardless of the number
+    // of pages.
+    const char suffix = PAGE_INDEX_CHARACTERS[page];
+    // __STRING_DATA_PLACEHOLDER__
+    for (int i = 0; i < (int)(sizeof(char_addresses) / sizeof(char*)); ++i)
+    {
+        *(char_addresses[i]) = suffix;
     }
+
+#if !LAZY_COURSE_PAGE_DATA
+    load_course_page_data();
+#endif
+
+    END_PERFORMANCE_COUNTER(CHANGE_COURSE_PAGE_COUNTER);
 }
 
 void refresh_lanselectmode()
@@ -100,26 +247,62 @@ void refresh_mapselectmode()
 {
     SceneMapSelect__reset(g_scenemapselect);
 
+#if INSTANT_MAPSELECT_REFRESH
+    // Jump straight to the last frame of the animation, whose duration is 16 frames. Experimental:
+    // it is unverified whether the screen state matches the one after the 16 initialization passes.
+    g_scenemapselect[150] = 15;
+    SceneMapSelect__map_init(g_scenemapselect);
+#else
     // Fast-forward the animation, whose duration is 16 frames.
     for (int i = 0; i < 16; ++i)
     {
         g_scenemapselect[150] = i;
         SceneMapSelect__map_init(g_scenemapselect);
     }
+#endif
 }
 
 #endif
 
-#if BATTLE_STAGES || TILTING_COURSES
+#if SECTIONED_COURSES
+
+// Section count of the current course, or `0` if the lap count is not to be overridden.
+static unsigned short g_section_count = 0;
+
+#endif
+
+#if BATTLE_STAGES || TILTING_COURSES || LAZY_COURSE_PAGE_DATA || SECTIONED_COURSES
+
+#define MIN_COURSE_ID 0x21  // Baby Park.
 
 bool is_tilting_course(const int* const course)
 {
-    const int course_id = *course;
+#if LAZY_COURSE_PAGE_DATA
+    // Called from `Course::reset()`, before the minimap and the audio track are used.
+    load_course_page_data();
+#endif
+
+    const unsigned int course_bit = (unsigned int)(*course - MIN_COURSE_ID);
     const int page = (int)(*(char*)CURRENT_PAGE_ADDRESS);
 
+#if SECTIONED_COURSES
+    // __SECTION_COUNT_DATA_PLACEHOLDER__
+
+    // Also called before the lap checkers of the karts are set up.
+    const int race_track = course_bit < sizeof(race_track_by_course_bit)
+                               ? (int)race_track_by_course_bit[course_bit]
+                               : -1;
+    g_section_count = race_track < 0 ? 0 : section_counts[page][race_track];
+#endif
+
+    if (course_bit >= 32)
+    {
+        return false;
+    }
+
     // __TILTING_DATA_PLACEHOLDER__
 
-    return false;
+    return (bool)((tilting_masks[page] >> course_bit) & 1u);
 }
 
 #endif
@@ -128,7 +311,15 @@ bool is_tilting_course(const int* const course)
 #define BATTLE_MODE 1
 #define LAN_MODE 2
 
-void process_course_page_change(const int mode)
+// Unless optimizing for size, the page change logic is always inlined, so that each screen gets its
+// own specialization, with the mode (and the branches that depend on it) resolved at compile time.
+#ifdef __OPTIMIZE_SIZE__
+#define PAGE_CHANGE_HANDLER_SPECIFIERS
+#else
+#define PAGE_CHANGE_HANDLER_SPECIFIERS static inline __attribute__((always_inline))
+#endif
+
+PAGE_CHANGE_HANDLER_SPECIFIERS void process_course_page_change(const int mode)
 {
     char next_spam_flag;
     float next_redraw_courseselect_screen;
@@ -174,6 +365,13 @@ void process_course_page_change(const int mode)
     {
         next_spam_flag = 0;
         next_redraw_courseselect_screen = 13.0f;
+
+#if LAZY_COURSE_PAGE_DATA
+        // Use the idle time (D-pad released) to write the data of the page that the player has
+        // settled on, so that it does not need to be written when the course is loaded. This is a
+        // no-op if the data is already in memory.
+        load_course_page_data();
+#endif
     }
 
     *(char*)SPAM_FLAG_ADDRESS = next_spam_flag;
@@ -187,7 +385,11 @@ void process_course_page_change(const int mode)
 void scenecourseselect_calcanm_ex()
 {
     SceneCourseSelect__calcAnm();
+
+    // Only the cost of the page change logic is measured.
+    BEGIN_PERFORMANCE_COUNTER();
     process_course_page_change(RACE_MODE);
+    END_PERFORMANCE_COUNTER(SCENECOURSESELECT_CALCANM_COUNTER);
 }
 
 #if BATTLE_STAGES
@@ -197,14 +399,22 @@ void scenemapselect_calcanm_ex()
     g_scenemapselect = this;
 
     SceneMapSelect__calcAnm();
+
+    // Only the cost of the page change logic is measured.
+    BEGIN_PERFORMANCE_COUNTER();
     process_course_page_change(BATTLE_MODE);
+    END_PERFORMANCE_COUNTER(SCENEMAPSELECT_CALCANM_COUNTER);
 }
 #endif
 
 void lanselectmode_calcanm_ex()
 {
     LANSelectMode__calcAnm();
+
+    // Only the cost of the page change logic is measured.
+    BEGIN_PERFORMANCE_COUNTER();
     process_course_page_change(LAN_MODE);
+    END_PERFORMANCE_COUNTER(LANSELECTMODE_CALCANM_COUNTER);
 }
 
 #if EXTENDER_CUP
@@ -238,14 +448,40 @@ const int g_limited_awarded_scores[8] = {7, 6, 5, 4, 3, 2, 1, 0};
 const int g_limited_awarded_scores[8] = {6, 5, 4, 3, 2, 1, 0, 0};
 #elif PAGE_COUNT == 10
 const int g_limited_awarded_scores[8] = {6, 5, 4, 3, 2, 1, 0, 0};
+#else
+// The maximum score that can be awarded in each race is chosen so that the total score never
+// exceeds 999 points.
+#define LIMITED_MAX_AWARDED_SCORE (999 / (PAGE_COUNT * 16))
+#define LIMITED_AWARDED_SCORE(position)                                                        \
+    (LIMITED_MAX_AWARDED_SCORE > (position) ? LIMITED_MAX_AWARDED_SCORE - (position) : 0)
+const int g_limited_awarded_scores[8] = {
+    LIMITED_AWARDED_SCORE(0), LIMITED_AWARDED_SCORE(1), LIMITED_AWARDED_SCORE(2),
+    LIMITED_AWARDED_SCORE(3), LIMITED_AWARDED_SCORE(4), LIMITED_AWARDED_SCORE(5),
+    LIMITED_AWARDED_SCORE(6), LIMITED_AWARDED_SCORE(7),
+};
 #endif
 #endif
 
+// The global course index is stored in two bytes (big-endian), as it can exceed 255 when there are
+// more than 15 pages. The address is not aligned; the bytes are accessed individually.
+int get_gp_global_course_index()
+{
+    const unsigned char* const bytes = (const unsigned char*)GP_GLOBAL_COURSE_INDEX_ADDRESS;
+    return (bytes[0] << 8) | bytes[1];
+}
+
+void set_gp_global_course_index(const int global_course_index)
+{
+    unsigned char* const bytes = (unsigned char*)GP_GLOBAL_COURSE_INDEX_ADDRESS;
+    bytes[0] = (unsigned char)(global_course_index >> 8);
+    bytes[1] = (unsigned char)global_course_index;
+}
+
 void on_gp_about_to_start()
 {
     asm("stw 0, 0x0094(3)");  // Hijacked instruction.
 
-    *(char*)GP_GLOBAL_COURSE_INDEX_ADDRESS = 0;
+    set_gp_global_course_index(0);
     *(char*)GP_INITIAL_PAGE_ADDRESS = *(const char*)CURRENT_PAGE_ADDRESS;
 
 #if PAGE_COUNT > 6
@@ -267,7 +503,7 @@ int get_gp_course_index()
         return *(char*)GP_COURSE_INDEX_ADDRESS;
     }
 
-    return *(char*)GP_GLOBAL_COURSE_INDEX_ADDRESS;
+    return get_gp_global_course_index();
 }
 
 void sequenceinfo_setclrgpcourse_ex()
@@ -277,7 +513,8 @@ void sequenceinfo_setclrgpcourse_ex()
     if (*(const char*)GP_CUP_INDEX_ADDRESS != ALL_CUP_TOUR_INDEX)
         return;
 
-    const char global_course_index = ++*(char*)GP_GLOBAL_COURSE_INDEX_ADDRESS;
+    const int global_course_index = get_gp_global_course_index() + 1;
+    set_gp_global_course_index(global_course_index);
     char* const course_index = (char*)GP_COURSE_INDEX_ADDRESS;
 
     if (*course_index == 16)
@@ -288,7 +525,7 @@ void sequenceinfo_setclrgpcourse_ex()
         }
 
         const char initial_page = *(const char*)GP_INITIAL_PAGE_ADDRESS;
-        const char pages_played = global_course_index / 16;
+        const char pages_played = (char)(global_course_index / 16);
         *(char*)CURRENT_PAGE_ADDRESS = initial_page + pages_played - 1;
     }
 
@@ -352,7 +589,8 @@ int itemobjmgr_isavailablerollingslot_ex(const unsigned int* const itemobjmgr,
     {
         const struct SObject* const sobj = itembox->sobj;
         signed char* const player_item_rolls = (signed char*)PLAYER_ITEM_ROLLS_ADDRESS;
-        player_item_rolls[player] = (signed char)(sobj->field_36 == 0 ? -1 : sobj->field_36 - 1);
+        // A value of 0 (no specific item type) naturally maps to -1.
+        player_item_rolls[player] = (signed char)(sobj->field_36 - 1);
     }
 
     return is_available;
@@ -364,68 +602,43 @@ int itemshufflemgr_calcslot_ex(const unsigned int* const itemshufflemgr,
                                const int unk2,
                                const bool unk3)
 {
+    BEGIN_PERFORMANCE_COUNTER();
+
     const int player = *(kartrankdataset - 8 / 4);
     const signed char* const player_item_rolls = (const signed char*)PLAYER_ITEM_ROLLS_ADDRESS;
     const int player_item_type = (int)player_item_rolls[player];
 
+    int slot;
     if (player_item_type == -1)
     {
-        return ItemShuffleMgr__calcSlot(itemshufflemgr, kartrankdataset, unk1, unk2, unk3);
+        slot = ItemShuffleMgr__calcSlot(itemshufflemgr, kartrankdataset, unk1, unk2, unk3);
     }
-
-    if (player_item_type == 20)
+    else if (player_item_type == 20)
     {
         const int other_data = *(kartrankdataset - 1);
         const char character = (char)(other_data >> 24);
-        return ItemObj__getSpecialKind(&player, &character);
+        slot = ItemObj__getSpecialKind(&player, &character);
     }
+    else
+    {
+        slot = player_item_type;
+    }
+
+    END_PERFORMANCE_COUNTER(ITEMSHUFFLEMGR_CALCSLOT_COUNTER);
 
-    return player_item_type;
+    return slot;
 }
 
 #endif
 
 #if SECTIONED_COURSES
 
-static unsigned short g_section_count = 0;
-
 // Due to the nature of the compiler, portions of the code had to be rewritten in ASM
 // so that the compiler would not ignore it, and thus break this code patch.
 // To compensate, nearly every set of ASM instructions has a description of what it's doing.
 
-// Reset the section counter.
-void reset_section_count()
-{
-    asm("or %r31, %r3, %r3");  // Run hijacked instruction.
-    g_section_count = 0;
-}
-
-// During course load, count each section point.
-// This will be used to jury-rig the "max laps" count to always be the section number.
-void count_section_point()
-{
-#if GM4E01_DEBUG_BUILD
-    asm("stw %r30, 0x8(%r31)");  // Run hijacked instruction.
-
-    register const unsigned int base asm("r30");
-#else
-    asm("stw %r4, 0x8(%r31)");  // Run hijacked instruction.
-
-    register const unsigned int base asm("r4");
-#endif
-
-    const bool shortcut_point = *(const bool*)(base + 0x0018);
-    if (shortcut_point)
-        return;
-
-    const bool lap_checkpoint = *(const bool*)(base + 0x001B);
-    if (!lap_checkpoint)
-        return;
-
-    ++g_section_count;
-}
-
-// Override the lap count in a section course to be the number of section points.
+// Override the lap count in a section course to be the number of section points (as looked up in
+// `is_tilting_course()`).
 void override_total_lap_count()
 {
 #if GM4E01_DEBUG_BUILD
@@ -438,11 +651,8 @@ void override_total_lap_count()
 
     if (reg9 != 0)
     {
-        // The game will crash on a race finish if more than 9 laps/sections are present.
-        if (reg9 > 9)
-        {
-            asm("li %r9, 0x09");
-        }
+        // The section counts have already been limited to 9; the game will crash on a race finish
+        // if more than 9 laps/sections are present.
         asm("sth %r9, 0x2e(%r31)");
     }
 }
@@ -554,6 +764,8 @@ void check_lap_ex()
     register char reg0 asm("r0");
     register char reg9 asm("r9");
 
+    BEGIN_PERFORMANCE_COUNTER();
+
     // setPass will have already run by this point.
     asm("rlwinm %r9, %r3, 0x0, 0x18, 0x1f");  // r9 = (char)r3
 
@@ -579,6 +791,8 @@ void check_lap_ex()
         force_lap_increment();
     }
 
+    END_PERFORMANCE_COUNTER(CHECK_LAP_EX_COUNTER);
+
 #if GM4E01_DEBUG_BUILD
     asm("lwz %r3, 0x3c(%r30)");  // Hijacked instruction.
 #else
@@ -0,0 +1,33 @@
+# Out-of-line functions that save and restore the callee-saved general-purpose registers, which the
+# compiler references when optimizing for size (`-Os`). They are normally provided by libgcc, which
+# is not linked into the injected code. Register r11 points to the top of the stack frame.
+
+    .section .text.savres, "ax"
+
+    .irp n, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+    .globl _savegpr_\n
+_savegpr_\n:
+    stw \n, -(32 - \n) * 4(11)
+    .endr
+    blr
+
+    .irp n, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+    .globl _restgpr_\n
+_restgpr_\n:
+    lwz \n, -(32 - \n) * 4(11)
+    .endr
+    blr
+
+    # Also restore the link register and the stack pointer, and return to the caller's caller.
+    .irp n, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30
+    .globl _restgpr_\n\()_x
+_restgpr_\n\()_x:
+    lwz \n, -(32 - \n) * 4(11)
+    .endr
+    .globl _restgpr_31_x
+_restgpr_31_x:
+    lwz 0, 4(11)
+    lwz 31, -4(11)
+    mtlr 0
+    mr 1, 11
+    blr
@@ -0,0 +1,69 @@
+"""
+Module that writes minimal synthetic GCM images, which are used in the unit tests and in the
+benchmarks in place of a stock ISO file.
+"""
+import struct
+
+from tools import gcm
+
+
+def build_iso(iso_filepath: str, files: 'dict[str, bytes]'):
+    """
+    Writes a minimal GCM image with the given files (paths relative to the `files` directory).
+    """
+    # Build the directory tree, and flatten it in FST order.
+    tree = {}
+    for path, data in files.items():
+        node = tree
+        *dirnames, filename = path.split('/')
+        for dirname in dirnames:
+            node = node.setdefault(dirname, {})
+        node[filename] = data
+
+    entries = []  # [name, parent index, children dict or file data, next index]
+
+    def flatten(node: dict, parent_index: int):
+        for name, child in sorted(node.items()):
+            entries.append([name, parent_index, child, None])
+            if isinstance(child, dict):
+                index = len(entries) - 1
+                flatten(child, index)
+                entries[index][3] = len(entries)
+
+    entries.append(['', 0, tree, None])
+    flatten(tree, 0)
+    entries[0][3] = len(entries)
+
+    APPLOADER_OFFSET = 0x2440
+    APPLOADER_SIZE = 0x40
+    DOL_OFFSET = 0x2500
+    DOL_SIZE = 0x120
+    FST_OFFSET = 0x2700
+
+    names = b''.join(name.encode('shift_jis') + b'\0' for name, *_rest in entries[1:])
+    fst_size = len(entries) * 0xC + len(names)
+    data_offset = gcm.pad_offset_to_nearest(FST_OFFSET + fst_size, 4)
+
+    iso = bytearray(data_offset)
+    struct.pack_into('>III', iso, 0x424, FST_OFFSET, fst_size, fst_size)
+    struct.pack_into('>I', iso, 0x420, DOL_OFFSET)
+    struct.pack_into('>II', iso, APPLOADER_OFFSET + 0x14, APPLOADER_SIZE, 0)
+    struct.pack_into('>II', iso, DOL_OFFSET, 0x100, 0)
+    struct.pack_into('>I', iso, DOL_OFFSET + 0x90, DOL_SIZE - 0x100)
+
+    name_offset = 0
+    for index, (name, parent_index, child, next_index) in enumerate(entries):
+        entry_offset = FST_OFFSET + index * 0xC
+        if isinstance(child, dict):
+            struct.pack_into('>III', iso, entry_offset, 0x01000000 | name_offset, parent_index,
+                             next_index)
+        else:
+            struct.pack_into('>III', iso, entry_offset, name_offset, len(iso), len(child))
+            iso += child
+            iso += b'\0' * (gcm.pad_offset_to_nearest(len(iso), 4) - len(iso))
+        if index:
+            name_offset += len(name.encode('shift_jis')) + 1
+    iso[FST_OFFSET + len(entries) * 0xC:FST_OFFSET + fst_size] = names
+
+    with open(iso_filepath, 'wb') as f:
+        f.write(iso)
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the `gcm` module.
+"""
+import os
+import sys
+import tempfile
+
+import pytest
+
+import gcm_builder
+from tools import gcm
+
+
+def _read_files(iso_filepath: str, use_mmap: bool = True) -> 'dict[str, bytes]':
+    gcm_file = gcm.GCM(iso_filepath, use_mmap)
+    gcm_file.read_entire_disc()
+    return {
+        file_path: bytes(gcm_file.read_file_raw_data(file_path))
+        for file_path, file_entry in gcm_file.files_by_path.items()
+        if not file_entry.is_system_file
+    }
+
+
+def _list_paths(dirpath: str) -> 'list[str]':
+    paths = []
+    for parent_dirpath, dirnames, filenames in os.walk(dirpath):
+        for name in dirnames + filenames:
+            paths.append(os.path.relpath(os.path.join(parent_dirpath, name), dirpath))
+    return sorted(paths)
+
+
+def _extend(input_filepath: str, output_filepath: str, overlay: bool, delta: bool = False):
+    gcm_file = gcm.GCM(input_filepath)
+    gcm_file.read_entire_disc()
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        for _filepath, _files_done in gcm_file.export_disc_to_folder_with_changed_files(tmp_dir):
+            pass
+        initial_paths = _list_paths(tmp_dir)
+
+        files_dirpath = os.path.join(tmp_dir, 'files')
+        # Renamed directory.
+        os.rename(os.path.join(files_dirpath, 'Course'), os.path.join(files_dirpath, 'Course0'))
+        # Hard link to a stock file.
+        os.makedirs(os.path.join(files_dirpath, 'Course1'))
+        os.link(os.path.join(files_dirpath, 'Course0', 'Luigi.arc'),
+                os.path.join(files_dirpath, 'Course1', 'Luigi.arc'))
+        # File modified in place, without changing its size.
+        with open(os.path.join(files_dirpath, 'Course0', 'Mario.arc'), 'r+b') as f:
+            f.write(b'MARIO')
+        # File replaced.
+        with open(os.path.join(files_dirpath, 'Stream', 'a.ast'), 'wb') as f:
+            f.write(b'new contents')
+        # New file.
+        with open(os.path.join(files_dirpath, 'Stream', 'c.ast'), 'wb') as f:
+            f.write(b'new file' * 100)
+        # System file modified.
+        with open(os.path.join(tmp_dir, 'sys', 'main.dol'), 'r+b') as f:
+            f.seek(0x100)
+            f.write(b'patched')
+
+        final_paths = _list_paths(tmp_dir)
+        for path in initial_paths:
+            if path not in final_paths:
+                dir_entry = gcm_file.dirs_by_path_lowercase.get(path.lower())
+                if dir_entry is not None:
+                    gcm_file.delete_directory(dir_entry)
+                    continue
+                file_entry = gcm_file.files_by_path_lowercase.get(path.lower())
+                if file_entry is not None:
+                    gcm_file.delete_file(file_entry)
+        for path in final_paths:
+            if path not in initial_paths:
+                if os.path.isfile(os.path.join(tmp_dir, path)):
+                    gcm_file.add_new_file(path)
+                else:
+                    gcm_file.add_new_directory(path)
+
+        if overlay:
+            gcm_file.overlay_all_files_from_disk(tmp_dir)
+            # Only the files whose contents have changed need to be read from disk.
+            assert sorted(gcm_file.changed_files) == [
+                os.path.join('files', 'Course0', 'Mario.arc'),
+                os.path.join('files', 'Stream', 'a.ast'),
+                os.path.join('files', 'Stream', 'c.ast'),
+                os.path.join('sys', 'main.dol'),
+            ]
+        else:
+            gcm_file.import_all_files_from_disk(tmp_dir)
+
+        expected_files = {}
+        for path in final_paths:
+            filepath = os.path.join(tmp_dir, path)
+            if path.startswith('files') and os.path.isfile(filepath):
+                with open(filepath, 'rb') as f:
+                    expected_files[path] = f.read()
+        with open(os.path.join(tmp_dir, 'sys', 'main.dol'), 'rb') as f:
+            expected_dol_data = f.read()
+
+        for _filepath, _files_done in gcm_file.export_disc_to_iso_with_changed_files(
+                output_filepath, delta):
+            pass
+
+    if delta:
+        return
+
+    assert _read_files(output_filepath) == expected_files
+
+    gcm_file = gcm.GCM(output_filepath)
+    gcm_file.read_entire_disc()
+    assert gcm_file.read_file_raw_data(os.path.join('sys', 'main.dol')) == expected_dol_data
+
+
+def test_overlay_all_files_from_disk():
+    files = {
+        'Course/Luigi.arc': os.urandom(3000),
+        'Course/Mario.arc': os.urandom(2000),
+        'Course/Peach.arc': os.urandom(1),
+        'Stream/a.ast': os.urandom(5000),
+        'Stream/b.ast': b'',
+        'readme.txt': b'readme',
+    }
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        input_filepath = os.path.join(tmp_dir, 'input.iso')
+        gcm_builder.build_iso(input_filepath, files)
+        assert _read_files(input_filepath) == {
+            os.path.join('files', *path.split('/')): data
+            for path, data in files.items()
+        }
+
+        for overlay in (False, True):
+            output_filepath = os.path.join(tmp_dir, f'output{int(overlay)}.iso')
+            _extend(input_filepath, output_filepath, overlay)
+
+        # Both modes must produce readable images with the same contents.
+        assert _read_files(os.path.join(tmp_dir, 'output0.iso')) == _read_files(
+            os.path.join(tmp_dir, 'output1.iso'))
+
+
+def test_partial_export():
+    files = {
+        'Course/Luigi.arc': os.urandom(3000),
+        'Stream/a.ast': os.urandom(5000),
+        'Stream/b.ast': os.urandom(1000),
+        'readme.txt': b'readme',
+    }
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        input_filepath = os.path.join(tmp_dir, 'input.iso')
+        gcm_builder.build_iso(input_filepath, files)
+
+        gcm_file = gcm.GCM(input_filepath)
+        gcm_file.read_entire_disc()
+        export_dirpath = os.path.join(tmp_dir, 'export')
+        stream_dirpath = os.path.join('files', 'Stream')
+        for _filepath, _files_done in gcm_file.export_disc_to_folder_with_changed_files(
+                export_dirpath, path_filter=lambda path: not path.startswith(stream_dirpath)):
+            pass
+        assert sorted(gcm_file.unexported_files) == [
+            os.path.join(stream_dirpath, 'a.ast'),
+            os.path.join(stream_dirpath, 'b.ast'),
+        ]
+        assert not os.path.exists(os.path.join(export_dirpath, stream_dirpath))
+        assert os.path.isfile(os.path.join(export_dirpath, 'files', 'readme.txt'))
+
+        with open(os.path.join(export_dirpath, 'files', 'readme.txt'), 'wb') as f:
+            f.write(b'new readme')
+
+        # Files that have not been exported are still written from the input ISO.
+        gcm_file.overlay_all_files_from_disk(export_dirpath)
+        assert sorted(gcm_file.changed_files) == [os.path.join('files', 'readme.txt')]
+        output_filepath = os.path.join(tmp_dir, 'output.iso')
+        for _filepath, _files_done in gcm_file.export_disc_to_iso_with_changed_files(
+                output_filepath):
+            pass
+
+        assert _read_files(output_filepath) == {
+            os.path.join('files', *path.split('/')): b'new readme' if path == 'readme.txt' else data
+            for path, data in files.items()
+        }
+
+
+def test_delta_patch():
+    files = {
+        'Course/Luigi.arc': os.urandom(3000),
+        'Course/Mario.arc': os.urandom(2000),
+        'Stream/a.ast': os.urandom(5000),
+        'Stream/b.ast': os.urandom(1024 * 1024),
+        'readme.txt': b'readme',
+    }
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        input_filepath = os.path.join(tmp_dir, 'input.iso')
+        gcm_builder.build_iso(input_filepath, files)
+
+        for overlay in (False, True):
+            output_filepath = os.path.join(tmp_dir, 'output.iso')
+            patch_filepath = os.path.join(tmp_dir, 'output.patch')
+            patched_filepath = os.path.join(tmp_dir, 'patched.iso')
+            _extend(input_filepath, output_filepath, overlay)
+            _extend(input_filepath, patch_filepath, overlay, delta=True)
+
+            if overlay:
+                # Files that have not changed are only referenced from the input ISO.
+                assert os.path.getsize(patch_filepath) < len(files['Stream/b.ast'])
+
+            gcm.apply_delta_patch(input_filepath, patch_filepath, patched_filepath)
+
+            with open(output_filepath, 'rb') as f:
+                expected_data = f.read()
+            with open(patched_filepath, 'rb') as f:
+                data = f.read()
+            assert data == expected_data
+
+        # The patch cannot be applied to a different ISO.
+        other_input_filepath = os.path.join(tmp_dir, 'other_input.iso')
+        gcm_builder.build_iso(other_input_filepath,
+                              dict(files, **{'readme.txt': b'other readme'}))
+        other_patched_filepath = os.path.join(tmp_dir, 'other_patched.iso')
+        with pytest.raises(Exception):
+            gcm.apply_delta_patch(other_input_filepath, patch_filepath, other_patched_filepath)
+        assert not os.path.exists(other_patched_filepath)
+
+
+def test_read_modes():
+    files = {
+        'a/b/c.bin': os.urandom(100),
+        'a/d.bin': os.urandom(200),
+        'e.bin': b'',
+        'ファイル.bin': os.urandom(300),
+    }
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        iso_filepath = os.path.join(tmp_dir, 'input.iso')
+        gcm_builder.build_iso(iso_filepath, files)
+
+        assert _read_files(iso_filepath, use_mmap=True) == _read_files(iso_filepath, use_mmap=False)
+
+        gcm_file = gcm.GCM(iso_filepath, use_mmap=True)
+        gcm_file.read_entire_disc()
+        file_path = os.path.join('files', 'a', 'd.bin')
+        data = gcm_file.read_file_raw_data(file_path)
+        assert isinstance(data, memoryview)
+        assert data == files['a/d.bin']
+        assert gcm_file.read_file_data(file_path).read() == files['a/d.bin']
+        del data
+
+        # Once closed, the mapping is released, and data is read from the file instead.
+        with gcm.GCM(iso_filepath, use_mmap=True) as gcm_file:
+            gcm_file.read_entire_disc()
+            assert gcm_file.iso_mmap is not None
+            data = gcm_file.read_file_raw_data(file_path)
+        assert gcm_file.iso_mmap is None
+        assert data == files['a/d.bin']
+        data.release()
+        assert gcm_file.read_file_raw_data(file_path) == files['a/d.bin']
+
+
+def test_copy_data():
+    data = os.urandom(10000)
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        src_filepath = os.path.join(tmp_dir, 'src')
+        dst_filepath = os.path.join(tmp_dir, 'dst')
+        with open(src_filepath, 'wb') as f:
+            f.write(data)
+
+        with open(src_filepath, 'rb') as src_file, open(dst_filepath, 'wb') as dst_file:
+            dst_file.write(b'header')
+            gcm.copy_data(src_file, 100, dst_file, 5000)
+            dst_file.write(b'trailer')
+
+        with open(dst_filepath, 'rb') as f:
+            assert f.read() == b'header' + data[100:5100] + b'trailer'
+
+        with open(src_filepath, 'rb') as src_file, open(dst_filepath, 'wb') as dst_file:
+            with pytest.raises(gcm.InvalidOffsetError):
+                gcm.copy_data(src_file, 9000, dst_file, 2000)
+
+
+if __name__ == '__main__':
+    sys.exit(pytest.main(sys.argv))
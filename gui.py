@@ -9,6 +9,7 @@ import configparser
 import contextlib
 import datetime
 import gc
+import heapq
 import itertools
 import json
 import logging
@@ -880,6 +881,78 @@ def cancel_futures(thread_pool_executor: concurrent.futures.ThreadPoolExecutor):
             work_item.future.cancel()
 
 
+def pil_image_to_qimage(image: Image.Image) -> QtGui.QImage:
+    if image.mode != 'RGBA':
+        image = image.convert('RGBA')
+    data = image.tobytes('raw', 'RGBA')
+    # The QImage instance does not own the buffer; a deep copy is returned.
+    return QtGui.QImage(data, *image.size, QtGui.QImage.Format_RGBA8888).copy()
+
+
+SELECTION_PRIORITY = 0
+PREFETCH_PRIORITY = 1
+
+
+class PriorityThreadPoolExecutor():
+    """
+    Thread pool whose pending work items are run in order of priority (lower values first), and in
+    order of submission within the same priority. Pending work items of a given priority can be
+    canceled at once when they become stale.
+    """
+
+    def __init__(self, max_workers: int):
+        self._condition = threading.Condition()
+        self._heap = []
+        self._counter = itertools.count()
+        self._shutdown = False
+
+        for _ in range(max_workers):
+            threading.Thread(target=self._run, daemon=True).start()
+
+    def submit(self, priority: int, fn: callable, *args) -> concurrent.futures.Future:
+        future = concurrent.futures.Future()
+        with self._condition:
+            if self._shutdown:
+                future.cancel()
+                return future
+            heapq.heappush(self._heap, (priority, next(self._counter), future, fn, args))
+            self._condition.notify()
+        return future
+
+    def cancel_pending(self, priority: int = None):
+        with self._condition:
+            heap = []
+            for work_item in self._heap:
+                if priority is None or work_item[0] == priority:
+                    work_item[2].cancel()
+                else:
+                    heap.append(work_item)
+            heapq.heapify(heap)
+            self._heap = heap
+
+    def shutdown(self):
+        self.cancel_pending()
+        with self._condition:
+            self._shutdown = True
+            self._condition.notify_all()
+
+    def _run(self):
+        while True:
+            with self._condition:
+                while not self._heap and not self._shutdown:
+                    self._condition.wait()
+                if self._shutdown:
+                    return
+                _priority, _index, future, fn, args = heapq.heappop(self._heap)
+
+            if not future.set_running_or_notify_cancel():
+                continue
+            try:
+                future.set_result(fn(*args))
+            except BaseException as e:
+                future.set_exception(e)
+
+
 class InfoViewWidget(QtWidgets.QScrollArea):
 
     shown = QtCore.Signal()
@@ -912,14 +985,19 @@ class InfoViewWidget(QtWidgets.QScrollArea):
         self._checksum_cache = {}
         self._pixmap_cache = {}
         self._minimap_pixmap_cache = {}
+        # Decoded images are also persisted to disk (as PNG files named after their checksum), so
+        # that they do not need to be decoded again in the next session.
+        self._cache_dirpath = None
         self._minimap_thread_pool_executor = concurrent.futures.ThreadPoolExecutor(1)
         self._thread_pool_executor = concurrent.futures.ThreadPoolExecutor(1)
-        self._child_thread_pool_executor = concurrent.futures.ThreadPoolExecutor(4)
+        # Images of the selected course are loaded ahead of the images that are prefetched for the
+        # visible rows in the custom tracks table.
+        self._image_loader = PriorityThreadPoolExecutor(os.cpu_count() or 4)
         self._about_to_quit = False
 
         def shutdown_executors():
             self._about_to_quit = True
-            shutdown_executor(self._child_thread_pool_executor)
+            self._image_loader.shutdown()
             shutdown_executor(self._thread_pool_executor)
             shutdown_executor(self._minimap_thread_pool_executor)
 
@@ -939,11 +1017,35 @@ class InfoViewWidget(QtWidgets.QScrollArea):
         self._expansion_states.clear()
         self._expansion_states.update(expansion_states)
 
+    def add_checksums(self, checksums: 'dict[str, str]'):
+        self._checksum_cache.update(checksums)
+
+    def set_cache_dirpath(self, dirpath: str):
+        self._cache_dirpath = dirpath
+
     def purge_caches(self):
         self._ast_metadata_cache.clear()
         self._checksum_cache.clear()
         self._minimap_pixmap_cache.clear()
         self._pixmap_cache.clear()
+        if self._cache_dirpath is not None:
+            shutil.rmtree(self._cache_dirpath, ignore_errors=True)
+
+    def prefetch_images(self, image_filepaths: 'list[str]'):
+        """
+        Loads the given images in the background, after the images of the selected course. Images
+        that were being prefetched in a previous call and have not started loading are discarded.
+        """
+        self._image_loader.cancel_pending(PREFETCH_PRIORITY)
+
+        checksums = set()
+        for image_filepath in image_filepaths:
+            checksum = self._checksum_cache.get(image_filepath)
+            if checksum is not None:
+                if checksum in self._pixmap_cache or checksum in checksums:
+                    continue
+                checksums.add(checksum)
+            self._image_loader.submit(PREFETCH_PRIORITY, self._load_image, image_filepath)
 
     def show_placeholder_message(self):
         self._build_label('Select a custom course to view its details', QtGui.QColor(100, 100, 100))
@@ -1171,6 +1273,7 @@ class InfoViewWidget(QtWidgets.QScrollArea):
         if not self._verify_image_files_ready(image_filepaths_by_language):
             # Cancel all pending futures to prioritize the current request.
             cancel_futures(self._thread_pool_executor)
+            self._image_loader.cancel_pending(SELECTION_PRIORITY)
 
             self._pending_image_filepaths_by_language = image_filepaths_by_language
             self._thread_pool_executor.submit(self._load_images_async, image_filepaths_by_language)
@@ -1245,14 +1348,15 @@ class InfoViewWidget(QtWidgets.QScrollArea):
 
             for image_filepath in image_filepaths:
                 futures.append(
-                    self._child_thread_pool_executor.submit(self._load_image, image_filepath))
+                    self._image_loader.submit(SELECTION_PRIORITY, self._load_image,
+                                              image_filepath))
 
             while not self._about_to_quit:
                 done, _undone = concurrent.futures.wait(futures, timeout=0.250)
                 if len(futures) == len(done):
                     break
 
-            if self._about_to_quit:
+            if self._about_to_quit or any(future.cancelled() for future in futures):
                 return
 
         self._images_loaded.emit(image_filepaths_by_language)
@@ -1272,19 +1376,45 @@ class InfoViewWidget(QtWidgets.QScrollArea):
         pixmap = QtGui.QPixmap()
 
         if checksum is not False:
-            try:
-                image = mkdd_extender.convert_bti_to_image(filepath)
-                if image is not None:
-                    if image.mode != 'RGBA':
-                        image = image.convert('RGBA')
-                    data = image.tobytes("raw", "RGBA")
-                    image = QtGui.QImage(data, *image.size, QtGui.QImage.Format_RGBA8888)
-                    pixmap = QtGui.QPixmap.fromImage(image)
-            except Exception:
-                pass
+            image = self._read_cached_image(checksum, 'images')
+            if image is None:
+                try:
+                    image = mkdd_extender.convert_bti_to_image(filepath)
+                    if image is not None:
+                        image = pil_image_to_qimage(image)
+                        self._write_cached_image(checksum, 'images', image)
+                except Exception:
+                    image = None
+            if image is not None:
+                pixmap = QtGui.QPixmap.fromImage(image)
 
         self._pixmap_cache[checksum] = pixmap
 
+    def _read_cached_image(self, checksum: str, category: str) -> 'QtGui.QImage | None':
+        if self._cache_dirpath is None:
+            return None
+        image_filepath = os.path.join(self._cache_dirpath, category, f'{checksum}.png')
+        if not os.path.isfile(image_filepath):
+            return None
+        image = QtGui.QImage(image_filepath)
+        return None if image.isNull() else image
+
+    def _write_cached_image(self, checksum: str, category: str, image: QtGui.QImage):
+        if self._cache_dirpath is None:
+            return
+        try:
+            dirpath = os.path.join(self._cache_dirpath, category)
+            os.makedirs(dirpath, exist_ok=True)
+            # Written to a temporary file first, as the same image may be saved concurrently.
+            fd, tmp_filepath = tempfile.mkstemp(suffix='.png', dir=dirpath)
+            os.close(fd)
+            if image.save(tmp_filepath, 'PNG'):
+                os.replace(tmp_filepath, os.path.join(dirpath, f'{checksum}.png'))
+            else:
+                os.remove(tmp_filepath)
+        except OSError:
+            pass
+
     def _on_images_loaded(self, image_filepaths_by_language: 'dict[str, list[str]]'):
         if image_filepaths_by_language == self._pending_image_filepaths_by_language:
             self._show_image_files(image_filepaths_by_language)
@@ -1332,7 +1462,10 @@ class InfoViewWidget(QtWidgets.QScrollArea):
 
         pixmap = QtGui.QPixmap()
 
-        if checksum is not False:
+        image = None if checksum is False else self._read_cached_image(checksum, 'minimaps')
+        if image is not None:
+            pixmap = QtGui.QPixmap.fromImage(image)
+        elif checksum is not False:
             try:
                 with tempfile.TemporaryDirectory(prefix=mkdd_extender.TEMP_DIR_PREFIX) as tmp_dir:
                     rarc.extract(rarc_filepath, tmp_dir)
@@ -1348,10 +1481,8 @@ class InfoViewWidget(QtWidgets.QScrollArea):
 
                     image = mkdd_extender.convert_bti_to_image(minimap_filepath)
                     if image is not None:
-                        if image.mode != 'RGBA':
-                            image = image.convert('RGBA')
-                        data = image.tobytes("raw", "RGBA")
-                        image = QtGui.QImage(data, *image.size, QtGui.QImage.Format_RGBA8888)
+                        image = pil_image_to_qimage(image)
+                        self._write_cached_image(checksum, 'minimaps', image)
                         pixmap = QtGui.QPixmap.fromImage(image)
             except Exception:
                 pass
@@ -1725,6 +1856,8 @@ class DelayedDirectoryWatcher(QtCore.QObject):
 
 class MKDDExtenderWindow(QtWidgets.QMainWindow):
 
+    _custom_track_details_loaded = QtCore.Signal(str, str, object)
+
     def __init__(self,
                  parent: QtWidgets.QWidget = None,
                  flags: QtCore.Qt.WindowFlags = QtCore.Qt.WindowFlags()):
@@ -1759,6 +1892,25 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
 
         self._item_text_to_path = {}
 
+        # The library index is loaded on the first scan of the custom tracks directory, and kept in
+        # memory afterwards.
+        self._library_index_filepath = os.path.join(
+            os.path.dirname(os.path.abspath(self._settings.fileName())), 'library_index.json')
+        self._library_index = None
+        self._path_to_image_filepaths = {}
+
+        # Scanning the directory only retrieves the track names. The details of the custom tracks
+        # (notably the checksums of the course images) that are not in the library index yet are
+        # retrieved in the background afterwards, and the index is saved once they stop arriving.
+        self._custom_track_details_thread_pool_executor = concurrent.futures.ThreadPoolExecutor(1)
+        self._custom_track_details_loaded.connect(self._on_custom_track_details_loaded)
+        self._save_library_index_timer = QtCore.QTimer(self)
+        self._save_library_index_timer.setSingleShot(True)
+        self._save_library_index_timer.setInterval(1000)
+        self._save_library_index_timer.timeout.connect(self._save_library_index)
+        QtWidgets.QApplication.instance().aboutToQuit.connect(
+            lambda: shutdown_executor(self._custom_track_details_thread_pool_executor))
+
         self._directory_watcher = DelayedDirectoryWatcher()
         self._directory_watcher.changed.connect(self._load_custom_tracks_directory)
 
@@ -1856,6 +2008,15 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
         self._custom_tracks_table.verticalHeader().hide()
         self._custom_tracks_table.verticalHeader().setSectionResizeMode(
             QtWidgets.QHeaderView.ResizeToContents)
+        # Images of the rows that are visible in the table are prefetched, once scrolling settles.
+        self._prefetch_timer = QtCore.QTimer(self)
+        self._prefetch_timer.setSingleShot(True)
+        self._prefetch_timer.setInterval(100)
+        self._prefetch_timer.timeout.connect(self._prefetch_visible_custom_tracks_images)
+        self._custom_tracks_table.verticalScrollBar().valueChanged.connect(
+            self._prefetch_timer.start)
+        self._custom_tracks_table.horizontalHeader().sortIndicatorChanged.connect(
+            self._prefetch_timer.start)
         self._custom_tracks_table.setVerticalScrollMode(QtWidgets.QAbstractItemView.ScrollPerPixel)
         self._custom_tracks_table.setWordWrap(False)
         self._custom_tracks_table_label = 'Custom Courses'
@@ -2020,6 +2181,8 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
         main_area_layout.addWidget(pages_scroll_widget)
 
         self._info_view = InfoViewWidget()
+        self._info_view.set_cache_dirpath(
+            os.path.join(os.path.dirname(self._library_index_filepath), 'preview_cache'))
         self._info_view.shown.connect(self._update_info_view)
         self._splitter = QtWidgets.QSplitter()
         self._splitter.addWidget(SplitterChildHolder(custom_tracks_widget))
@@ -2390,7 +2553,8 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
             <b>{self._total_page_count_label.text()}</b> drop down (from 2 to
             {mkdd_extender.MAX_EXTRA_PAGES + 1} pages). The first page is reserved for the stock
             courses in the input ISO file; it does not appear in the list, which starts counting at
-            2.
+            2. More than {mkdd_extender.MAX_PAGES_WITHOUT_EXTENDED_MEMORY} pages require the
+            <b>Extended Memory</b> option (see the <b>Expert Options</b> section).
             <br/>
             <br/>
             By default, only custom race tracks can be assigned. Check the
@@ -2466,6 +2630,72 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
             else:
                 self._custom_tracks_table.hideRow(row)
 
+        self._prefetch_timer.start()
+
+    def _prefetch_visible_custom_tracks_images(self):
+        if not self._custom_tracks_table.isEnabled():
+            return
+
+        first_row = self._custom_tracks_table.rowAt(0)
+        if first_row < 0:
+            return
+        last_row = self._custom_tracks_table.rowAt(
+            self._custom_tracks_table.viewport().height() - 1)
+        if last_row < 0:
+            last_row = self._custom_tracks_table.rowCount() - 1
+
+        image_filepaths = []
+        for row in range(first_row, last_row + 1):
+            if self._custom_tracks_table.isRowHidden(row):
+                continue
+            item = self._custom_tracks_table.item(row, 0)
+            path = self._item_text_to_path.get(item.text()) if item is not None else None
+            image_filepaths.extend(self._path_to_image_filepaths.get(path, ()))
+
+        self._info_view.prefetch_images(image_filepaths)
+
+    def _add_custom_track_image_filepaths(self, path: str, details: dict) -> 'dict[str, str]':
+        trackinfo_dirpath = path
+        if details['trackinfo_dirpath'] != '.':
+            trackinfo_dirpath = os.path.join(path, details['trackinfo_dirpath'])
+        checksums = {}
+        image_filepaths = []
+        for relpath, checksum in details['image_checksums'].items():
+            image_filepath = os.path.join(trackinfo_dirpath, *relpath.split('/'))
+            checksums[image_filepath] = checksum
+            if image_filepath.endswith('.bti'):
+                image_filepaths.append(image_filepath)
+        self._path_to_image_filepaths[path] = image_filepaths
+        return checksums
+
+    def _load_custom_track_details(self, path: str):
+        # NOTE: Called in a worker thread. The signature is computed first, so that the details are
+        # discarded if the custom track is modified in the meantime.
+        try:
+            signature = mkdd_extender.get_custom_track_signature(path)
+            details = mkdd_extender.get_custom_track_details(path)
+        except Exception:
+            return
+        self._custom_track_details_loaded.emit(path, signature, details)
+
+    def _on_custom_track_details_loaded(self, path: str, signature: str, details: 'dict | None'):
+        # While the directory is being scanned (in another thread), the library index is not to be
+        # modified; the details will be requested again after the scan.
+        if self._library_index is None or not self._custom_tracks_table.isEnabled():
+            return
+
+        self._library_index.set_details(path, signature, details)
+        self._save_library_index_timer.start()
+
+        if details is not None and path in self._item_text_to_path.values():
+            self._info_view.add_checksums(self._add_custom_track_image_filepaths(path, details))
+            self._prefetch_timer.start()
+
+    def _save_library_index(self):
+        if self._library_index is None or not self._custom_tracks_table.isEnabled():
+            return
+        self._library_index.save()
+
     def _load_custom_tracks_directory(self, dirpath: str = ''):
         selected_items_text = []
         for item in self._custom_tracks_table.selectedItems():
@@ -2475,6 +2705,8 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
         self._custom_tracks_table.setRowCount(0)
 
         self._item_text_to_path.clear()
+        self._path_to_image_filepaths.clear()
+        cancel_futures(self._custom_track_details_thread_pool_executor)
 
         dirpath = dirpath or self._custom_tracks_directory_edit.get_path()
 
@@ -2482,9 +2714,17 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
             self._directory_watcher.set_directory(dirpath)
 
         if dirpath:
-            progress_dialog = ProgressDialog(
-                'Scanning custom courses directory...',
-                lambda: mkdd_extender.scan_custom_tracks_directory(dirpath), self)
+
+            def scan_custom_tracks_directory() -> 'dict[str, str]':
+                if self._library_index is None:
+                    self._library_index = mkdd_extender.LibraryIndex(self._library_index_filepath)
+                paths_to_track_name = mkdd_extender.scan_custom_tracks_directory(
+                    dirpath, self._library_index)
+                self._library_index.save()
+                return paths_to_track_name
+
+            progress_dialog = ProgressDialog('Scanning custom courses directory...',
+                                             scan_custom_tracks_directory, self)
             paths_to_track_name = progress_dialog.execute_and_wait()
 
             if not paths_to_track_name:
@@ -2503,6 +2743,21 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
                 self._custom_tracks_table.setRowCount(len(paths_to_track_name))
                 track_names = tuple(paths_to_track_name.values())
 
+                # The checksums of the course images are stored in the library index; they are
+                # handed over to the info view, which will not need to compute them again. Those
+                # that are not in the index yet are computed in the background.
+                checksums = {}
+                for path in paths_to_track_name:
+                    if not os.path.isdir(path):
+                        continue
+                    details = self._library_index.get_cached_details(path)
+                    if details is None:
+                        self._custom_track_details_thread_pool_executor.submit(
+                            self._load_custom_track_details, path)
+                        continue
+                    checksums.update(self._add_custom_track_image_filepaths(path, details))
+                self._info_view.add_checksums(checksums)
+
                 item_text_to_item = {}
 
                 for i, (path, track_name) in enumerate(paths_to_track_name.items()):
@@ -3775,6 +4030,8 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
 
     def _on_purge_preview_caches_action_triggered(self):
         self._info_view.purge_caches()
+        if self._library_index is not None:
+            self._library_index.clear()
         gc.collect()  # Rather placebo, but at least intention is shown.
         self._load_custom_tracks_directory()
 
@@ -3884,6 +4141,7 @@ class MKDDExtenderWindow(QtWidgets.QMainWindow):
             args.input = input_path
             args.output = output_path
             args.tracks = []
+            args.battle_stages = self._enable_custom_battle_stages.isChecked()
 
             extra_page_count = self._get_configured_extra_page_count()
 
@@ -1,10 +1,11 @@
 #!/usr/bin/env python3
 """
-MKDD Extender is a tool that extends Mario Kart: Double Dash!! with 144 extra custom race tracks and
-54 extra custom battle stages.
+MKDD Extender is a tool that extends Mario Kart: Double Dash!! with 416 extra custom race tracks and
+156 extra custom battle stages.
 """
 import argparse
 import collections
+import concurrent.futures
 import configparser
 import contextlib
 import difflib
@@ -13,6 +14,7 @@ import itertools
 import json
 import logging
 import math
+import multiprocessing
 import os
 import platform
 import re
@@ -30,6 +32,7 @@ from PIL import Image, ImageDraw, ImageFont
 
 import ast_converter
 import code_patcher
+import profiler
 import rarc
 from tools import bti, gcm
 
@@ -167,10 +170,11 @@ EXTENDER_CUP_PREVIEW_TEXT = {
 Text that is used in the preview image for the Extender Cup.
 """
 
-MAX_EXTRA_PAGES = 9
+MAX_EXTRA_PAGES = 26
 """
-The maximum number of extra pages that can be added to the game, to a total of 10 pages, including
-the first page that features the stock courses.
+The maximum number of extra pages that can be added to the game, to a total of 27 pages, including
+the first page that features the stock courses. Bounded by the letters that are used in the prefixes
+of the course archives (`A` to `Z`).
 """
 
 MAX_PAGES = 1 + MAX_EXTRA_PAGES
@@ -178,6 +182,22 @@ MAX_PAGES = 1 + MAX_EXTRA_PAGES
 The maximum number of pages that can be present int the game.
 """
 
+MAX_PAGES_WITHOUT_EXTENDED_MEMORY = 10
+"""
+The maximum number of pages (144 custom race tracks, or 54 custom battle stages) that can be present
+in the game unless the Extended Memory option is enabled. The preview and label images are
+downscaled to fit in the `courseselect.arc` and `mapselect.arc` files; beyond this number of pages,
+they would no longer be readable.
+"""
+
+PAGE_INDEX_CHARACTERS = '0123456789abcdefghijklmnopq'
+"""
+The character that is used in the filenames of each page (and that is written in the strings in the
+DOL file when the page is changed). The file system in the game is case-insensitive, so only
+lowercase letters are used after the digits.
+"""
+assert len(PAGE_INDEX_CHARACTERS) == MAX_PAGES
+
 RACE_TRACK_COUNT = 16
 """
 Total number of race tracks in the unmodified game.
@@ -291,6 +311,15 @@ data_dir = os.path.join(script_dir, 'data')
 
 TEMP_DIR_PREFIX = 'mkddext'
 
+MELD_CACHE_DIR = os.environ.get('MKDD_EXTENDER_MELD_CACHE_DIR')
+"""
+Optional path to a directory where the files that are generated when a custom course is melded (the
+course archives, the course images, the conformed audio files, and the minimap values) are cached,
+keyed on the contents of the custom course, its slot, and the options that have an effect on the
+output. Courses that have not changed since the previous build are not melded again. Entries are
+never evicted; the directory can be deleted at any time.
+"""
+
 try:
     RESAMPLING_FILTER = Image.Resampling.LANCZOS
 except AttributeError:
@@ -399,18 +428,82 @@ def run(command: list, verbose: bool = False, cwd: str = None) -> int:
         return process.returncode
 
 
+def run_in_process_pool(func: callable, batch: 'list[tuple]', jobs: int,
+                        raise_if_canceled: callable) -> 'collections.abc.Iterator[tuple]':
+    """
+    Calls the given function with each of the argument tuples in the batch, and yields the argument
+    tuples as the calls complete.
+
+    If more than one job is requested, the calls are distributed across a pool of processes, and
+    complete in no particular order; otherwise, they are run in order in the calling process. The
+    function must be picklable (i.e. defined at module level).
+    """
+    if jobs <= 1 or len(batch) <= 1:
+        for func_args in batch:
+            func(*func_args)
+            yield func_args
+            raise_if_canceled()
+        return
+
+    # Processes are spawned (rather than forked), as the calling process may have other threads
+    # running (e.g. in GUI mode).
+    executor = concurrent.futures.ProcessPoolExecutor(
+        max_workers=min(jobs, len(batch)), mp_context=multiprocessing.get_context('spawn'))
+    try:
+        futures = {executor.submit(func, *func_args): func_args for func_args in batch}
+        for future in concurrent.futures.as_completed(futures):
+            future.result()
+            yield futures[future]
+            raise_if_canceled()
+    finally:
+        executor.shutdown(wait=True, cancel_futures=True)
+
+
 def md5sum(filepath: str) -> str:
     return hashlib.md5(open(filepath, 'rb').read()).hexdigest()
 
 
-def build_file_list(dirpath: str) -> 'tuple[str]':
+def hash_values(*values) -> str:
+    hasher = hashlib.sha256()
+    for value in values:
+        value = value if isinstance(value, bytes) else str(value).encode('utf-8')
+        hasher.update(len(value).to_bytes(8, 'big'))
+        hasher.update(value)
+    return hasher.hexdigest()
+
+
+def hash_directory(dirpath: str) -> str:
+    # NOTE: Unlike `build_file_list()`, the current directory is not changed; this function can be
+    # called concurrently.
+    file_hashes = []
+    for parent_dirpath, dirnames, filenames in os.walk(dirpath):
+        dirnames.sort()
+        for filename in sorted(filenames):
+            filepath = os.path.join(parent_dirpath, filename)
+            with open(filepath, 'rb') as f:
+                file_hashes.append(hash_values(os.path.relpath(filepath, dirpath), f.read()))
+    return hash_values(*file_hashes)
+
+
+def build_file_list(dirpath: str, unextracted_filepaths: 'tuple[str]' = ()) -> 'tuple[str]':
+    # Files that have not been extracted from the input ISO image (relative to `dirpath`) are listed
+    # as if they existed on disk, along with their parent directories.
+    unextracted_names = collections.defaultdict(set)
+    for filepath in unextracted_filepaths:
+        parent_path, name = os.path.split(filepath)
+        while name:
+            unextracted_names[parent_path].add(name)
+            parent_path, name = os.path.split(parent_path)
 
     def _build_file_list(dirpath):
         result = []
-        for name in sorted(os.listdir(dirpath) if dirpath else os.listdir()):
+        names = unextracted_names.get(dirpath, set())
+        if not dirpath or os.path.isdir(dirpath):
+            names = names.union(os.listdir(dirpath) if dirpath else os.listdir())
+        for name in sorted(names):
             path = os.path.normpath(os.path.join(dirpath, name))
             result.append(path)
-            if os.path.isdir(path):
+            if path in unextracted_names or os.path.isdir(path):
                 result.extend(_build_file_list(path))
         return tuple(result)
 
@@ -463,7 +556,260 @@ def get_custom_track_name(path: str) -> str:
     return str()
 
 
-def scan_custom_tracks_directory(dirpath: str) -> 'dict[str, str]':
+def read_minimap_data(filepath: str) -> 'tuple[float, float, float, float, int]':
+    with open(filepath, 'r', encoding='ascii') as f:
+        minimap_json = json.loads(f.read())
+    return (
+        float(minimap_json['Top Left Corner X']),
+        float(minimap_json['Top Left Corner Z']),
+        float(minimap_json['Bottom Right Corner X']),
+        float(minimap_json['Bottom Right Corner Z']),
+        int(minimap_json['Orientation']),
+    )
+
+
+def get_custom_track_signature(path: str) -> str:
+    """
+    Returns a value that changes whenever the custom track in the given path (a directory or a ZIP
+    archive) is modified: it is based on the modification time and the size of the archive, or of
+    the files in the directory that the details of the custom track are retrieved from (see
+    `get_custom_track_info()` and `get_custom_track_details()`).
+    """
+    if not os.path.isdir(path):
+        stat = os.stat(path)
+        return f'{stat.st_mtime_ns}:{stat.st_size}'
+
+    # As in `get_custom_track_name()`, the `trackinfo.ini` file may be nested in a chain of single
+    # directories.
+    trackinfo_dirpath = path
+    while not os.path.isfile(os.path.join(trackinfo_dirpath, 'trackinfo.ini')):
+        names = os.listdir(trackinfo_dirpath)
+        if len(names) != 1 or not os.path.isdir(os.path.join(trackinfo_dirpath, names[0])):
+            break
+        trackinfo_dirpath = os.path.join(trackinfo_dirpath, names[0])
+
+    hasher = hashlib.sha256()
+    hasher.update(f'{os.path.relpath(trackinfo_dirpath, path)}\n'.encode('utf-8'))
+
+    def hash_file(filepath: str):
+        relpath = os.path.relpath(filepath, trackinfo_dirpath)
+        try:
+            stat = os.stat(filepath)
+        except FileNotFoundError:
+            hasher.update(f'{relpath}\n'.encode('utf-8'))
+            return
+        hasher.update(f'{relpath}:{stat.st_mtime_ns}:{stat.st_size}\n'.encode('utf-8'))
+
+    for filename in ('trackinfo.ini', 'track.arc', 'minimap.json'):
+        hash_file(os.path.join(trackinfo_dirpath, filename))
+    for parent_dirpath, dirnames, filenames in os.walk(
+            os.path.join(trackinfo_dirpath, 'course_images')):
+        dirnames.sort()
+        for filename in sorted(filenames):
+            hash_file(os.path.join(parent_dirpath, filename))
+    return hasher.hexdigest()
+
+
+def get_custom_track_info(path: str) -> 'dict | None':
+    """
+    Returns the basic information of the custom track in the given path (a directory or a ZIP
+    archive), or `None` if no custom track is found in the path. Only the `trackinfo.ini` file is
+    read:
+
+    - `name`: The track name, as returned by `get_custom_track_name()`.
+    - `type`: Either `race` or `battle`, depending on the course that is replaced.
+    """
+    track_name = get_custom_track_name(path)
+    if not track_name:
+        return None
+
+    return {
+        'name': track_name,
+        'type': 'battle' if track_name.startswith('🎈') else 'race',
+    }
+
+
+def get_custom_track_details(path: str) -> 'dict | None':
+    """
+    Returns the details of the custom track in the given path (a directory or a ZIP archive), or
+    `None` if no custom track is found in the path. Unlike `get_custom_track_info()`, the course
+    archive is read, and the course images are hashed:
+
+    - `trackinfo_dirpath`: The path to the directory that contains the `trackinfo.ini` file,
+      relative to the given path (or to the root of the archive).
+    - `tilt_setting`: The tilt setting in the BOL file, or `None` if the course archive cannot be
+      read.
+    - `minimap`: The minimap values, or `None` if the `minimap.json` file cannot be read.
+    - `image_checksums`: The MD5 checksums of the files in the `course_images` directory, keyed on
+      their paths relative to `trackinfo_dirpath` (with forward slashes).
+    """
+    if not get_custom_track_name(path):
+        return None
+
+    def is_relevant_file(relpath: str) -> bool:
+        return relpath in ('minimap.json', 'track.arc') or relpath.startswith('course_images/')
+
+    def get_info_from_directory(root_dirpath: str, trackinfo_dirpath: str) -> dict:
+        tilt_setting = None
+        try:
+            archive = rarc.read(os.path.join(trackinfo_dirpath, 'track.arc'))
+            tilt_setting = get_tilt_setting_from_course_archive(archive)
+        except Exception:
+            pass
+
+        minimap = None
+        try:
+            minimap = read_minimap_data(os.path.join(trackinfo_dirpath, 'minimap.json'))
+        except Exception:
+            pass
+
+        image_checksums = {}
+        for parent_dirpath, _dirnames, filenames in os.walk(
+                os.path.join(trackinfo_dirpath, 'course_images')):
+            for filename in filenames:
+                filepath = os.path.join(parent_dirpath, filename)
+                relpath = os.path.relpath(filepath, trackinfo_dirpath).replace(os.sep, '/')
+                image_checksums[relpath] = md5sum(filepath)
+
+        return {
+            'trackinfo_dirpath': os.path.relpath(trackinfo_dirpath, root_dirpath),
+            'tilt_setting': tilt_setting,
+            'minimap': minimap,
+            'image_checksums': dict(sorted(image_checksums.items())),
+        }
+
+    if os.path.isdir(path):
+        # As in `get_custom_track_name()`, the file may be nested in a chain of single directories.
+        trackinfo_dirpath = path
+        while not os.path.isfile(os.path.join(trackinfo_dirpath, 'trackinfo.ini')):
+            trackinfo_dirpath = os.path.join(trackinfo_dirpath, os.listdir(trackinfo_dirpath)[0])
+        return get_info_from_directory(path, trackinfo_dirpath)
+
+    # Only the relevant entries in the archive are extracted.
+    with zipfile.ZipFile(path, 'r') as f:
+        with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
+            names = f.namelist()
+            trackinfo_entry = next(name for name in names
+                                   if os.path.basename(name) == 'trackinfo.ini')
+            entry_prefix = trackinfo_entry[:-len('trackinfo.ini')]
+            for name in names:
+                if name.startswith(entry_prefix) and is_relevant_file(name[len(entry_prefix):]):
+                    f.extract(name, tmp_dir)
+            return get_info_from_directory(tmp_dir, os.path.join(tmp_dir, entry_prefix))
+
+
+class LibraryIndex():
+    """
+    Persistent index of the custom tracks that have been scanned, stored in a JSON file. Entries are
+    keyed on the path of the custom track, and hold the basic information of the custom track (see
+    `get_custom_track_info()`), which is only retrieved again if the signature of the custom track
+    (see `get_custom_track_signature()`) no longer matches.
+
+    The details of the custom track (see `get_custom_track_details()`) are more expensive to
+    retrieve, and are not needed to scan a directory. They are expected to be retrieved in a
+    background pass, and stored with `set_details()`.
+
+    The index is discarded if it was written by a different version of the application.
+    """
+
+    def __init__(self, filepath: str):
+        self._filepath = filepath
+        self._entries = {}
+        self._modified = False
+
+        try:
+            with open(filepath, 'r', encoding='utf-8') as f:
+                index = json.load(f)
+            if index.get('version') == __version__:
+                self._entries = index['entries']
+        except FileNotFoundError:
+            pass
+        except Exception as e:
+            log.warning(f'Unable to read library index ("{filepath}"): {str(e)}.')
+
+    def get_info(self, path: str) -> 'dict | None':
+        """
+        Returns the basic information of the custom track in the given path (see
+        `get_custom_track_info()`), which is retrieved and stored in the index if the entry is
+        missing or outdated.
+        """
+        signature = get_custom_track_signature(path)
+        entry = self._entries.get(path)
+        if entry is not None and entry['signature'] == signature:
+            return entry['info']
+
+        info = get_custom_track_info(path)
+        self._entries[path] = {'signature': signature, 'info': info}
+        self._modified = True
+        return info
+
+    def get_cached_details(self, path: str) -> 'dict | None':
+        entry = self._entries.get(path)
+        return entry.get('details') if entry is not None else None
+
+    def set_details(self, path: str, signature: str, details: 'dict | None'):
+        """
+        Stores the details of the custom track in the given path, as long as the signature that was
+        computed before retrieving the details still matches the one in the entry.
+        """
+        entry = self._entries.get(path)
+        if entry is not None and entry['signature'] == signature:
+            entry['details'] = details
+            self._modified = True
+
+    def clear(self):
+        self._entries.clear()
+        self._modified = True
+
+    def prune(self, dirpath: str, paths: 'set[str]'):
+        """
+        Removes the entries in the given directory whose paths are not in the given set (i.e. custom
+        tracks that are no longer present in the directory).
+        """
+        dirpath = os.path.join(dirpath, '')
+        for path in tuple(self._entries):
+            if path.startswith(dirpath) and path not in paths:
+                del self._entries[path]
+                self._modified = True
+
+    def save(self):
+        if not self._modified:
+            return
+
+        # Written atomically, in case more than one instance of the application is running.
+        dirpath = os.path.dirname(self._filepath)
+        try:
+            os.makedirs(dirpath, exist_ok=True)
+            tmp_fd, tmp_filepath = tempfile.mkstemp(dir=dirpath)
+            try:
+                with os.fdopen(tmp_fd, 'w', encoding='utf-8') as f:
+                    json.dump({'version': __version__, 'entries': self._entries}, f)
+                os.replace(tmp_filepath, self._filepath)
+            except Exception:
+                remove_file(tmp_filepath)
+                raise
+        except Exception as e:
+            log.warning(f'Unable to write library index ("{self._filepath}"): {str(e)}.')
+            return
+        self._modified = False
+
+
+def scan_custom_tracks_directory(dirpath: str,
+                                 library_index: LibraryIndex = None) -> 'dict[str, str]':
+    """
+    Returns a dictionary with the paths of the custom tracks found in the given directory (searched
+    recursively), and their track names, or `None` if the directory cannot be accessed.
+
+    If a library index is provided, the track names are retrieved through the index, and entries of
+    custom tracks that are no longer present are pruned.
+    """
+    paths_to_track_name = _scan_custom_tracks_directory(dirpath, library_index)
+    if library_index is not None and paths_to_track_name is not None:
+        library_index.prune(dirpath, set(paths_to_track_name))
+    return paths_to_track_name
+
+
+def _scan_custom_tracks_directory(dirpath: str, library_index: LibraryIndex) -> 'dict[str, str]':
     try:
         names = sorted(os.listdir(dirpath))
     except Exception:
@@ -474,13 +820,17 @@ def scan_custom_tracks_directory(dirpath: str) -> 'dict[str, str]':
         path = os.path.join(dirpath, name)
 
         if os.path.isdir(path) and not os.path.isfile(os.path.join(path, 'track.arc')):
-            nested_paths_to_track_name = scan_custom_tracks_directory(path)
+            nested_paths_to_track_name = _scan_custom_tracks_directory(path, library_index)
             if nested_paths_to_track_name:
                 paths_to_track_name.update(nested_paths_to_track_name)
                 continue
 
         try:
-            track_name = get_custom_track_name(path)
+            if library_index is not None:
+                info = library_index.get_info(path)
+                track_name = info['name'] if info is not None else None
+            else:
+                track_name = get_custom_track_name(path)
             if track_name:
                 paths_to_track_name[path] = track_name
                 continue
@@ -556,40 +906,53 @@ def course_name_to_course(course_name: str) -> str:
     return sorted(courses_weight, key=lambda e: e[1])[-1][0]
 
 
-def get_tilt_setting_from_bol_file(course_filepath: str) -> int:
-    BOL_MAGIC = b'0015'
+def find_bol_file_in_course_archive(archive: rarc.Directory) -> memoryview:
+    for filename, data in archive.files.items():
+        if filename.endswith('.bol'):
+            return data
+    raise MKDDExtenderError(f'Unable to locate BOL file in "{archive.name}" course archive.')
+
+
+def get_tilt_setting_from_course_archive(archive: rarc.Directory) -> int:
     TILT_SETTING_OFFSET = 0x04
 
-    with open(course_filepath, 'rb') as f:
-        data = f.read()
+    return find_bol_file_in_course_archive(archive)[TILT_SETTING_OFFSET]
 
-    # If the start of the BOL file can be located [once] in the RARC archive, the BOL file can be
-    # read directly without having to extract the archive first, which would be slower. This
-    # shortcut only possible if the RARC file is uncompressed.
-    if data[:4] == b'RARC':
-        bol_offset = data.find(BOL_MAGIC)
-        if bol_offset > 0:
-            if data.find(BOL_MAGIC, bol_offset + len(BOL_MAGIC)) < 0:
-                with open(course_filepath, 'r+b') as f:
-                    f.seek(bol_offset + TILT_SETTING_OFFSET)
-                    return f.read(1)[0]
-
-    # Otherwise, extract the RARC file, and locate the BOL file in the directory.
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        rarc.extract(course_filepath, tmp_dir)
 
-        course_dirpath = os.path.join(tmp_dir, os.listdir(tmp_dir)[0])
-        bol_filepath = os.path.join(
-            course_dirpath,
-            tuple(p for p in os.listdir(course_dirpath) if p.endswith('.bol'))[0])
+def get_section_count_from_course_archive(archive: rarc.Directory) -> int:
+    """
+    Returns the number of section points (non-shortcut checkpoints that are flagged as lap
+    checkpoints) in the course, which the Sectioned Courses code patch uses as the lap count.
+    """
+    # https://wiki.tockdom.com/wiki/BOL_(File_Format)
+    CHECKPOINT_GROUP_COUNT_OFFSET = 0x1C
+    CHECKPOINT_GROUPS_OFFSET_OFFSET = 0x48
+    CHECKPOINT_GROUP_SIZE = 0x14
+    CHECKPOINT_SIZE = 0x1C
+    SHORTCUT_POINT_OFFSET = 0x18
+    LAP_CHECKPOINT_OFFSET = 0x1B
+
+    data = find_bol_file_in_course_archive(archive)
+
+    group_count = struct.unpack_from('>H', data, CHECKPOINT_GROUP_COUNT_OFFSET)[0]
+    groups_offset = struct.unpack_from('>I', data, CHECKPOINT_GROUPS_OFFSET_OFFSET)[0]
+    checkpoint_count = sum(
+        struct.unpack_from('>H', data, groups_offset + i * CHECKPOINT_GROUP_SIZE)[0]
+        for i in range(group_count))
+    checkpoints_offset = groups_offset + group_count * CHECKPOINT_GROUP_SIZE
+
+    section_count = 0
+    for i in range(checkpoint_count):
+        checkpoint_offset = checkpoints_offset + i * CHECKPOINT_SIZE
+        if data[checkpoint_offset + SHORTCUT_POINT_OFFSET]:
+            continue
+        if data[checkpoint_offset + LAP_CHECKPOINT_OFFSET]:
+            section_count += 1
 
-        with open(bol_filepath, 'r+b') as f:
-            f.seek(TILT_SETTING_OFFSET)
-            return f.read(1)[0]
+    return section_count
 
 
-def patch_music_id_in_bol_file(course_filepath: str, track_index: int):
-    assert course_filepath.endswith('.arc')
+def patch_music_id_in_course_archive(archive: rarc.Directory, track_index: int):
     assert 0 <= track_index < RACE_AND_BATTLE_COURSE_COUNT
 
     MUSIC_IDS = (36, 34, 33, 50, 40, 37, 35, 42, 51, 41, 38, 45, 43, 44, 47, 49, 58, 53, 54, 59, 52,
@@ -598,84 +961,60 @@ def patch_music_id_in_bol_file(course_filepath: str, track_index: int):
 
     music_id = MUSIC_IDS[track_index]
 
-    BOL_MAGIC = b'0015'
     MUSIC_ID_OFFSET = 0x19  # https://wiki.tockdom.com/wiki/BOL_(File_Format)
 
-    with open(course_filepath, 'rb') as f:
-        data = f.read()
-
-    # If the start of the BOL file can be located [once] in the RARC archive, the BOL file can be
-    # edited directly without having to extract the archive first, which would be slower. This
-    # shortcut only possible if the RARC file is uncompressed.
-    if data[:4] == b'RARC':
-        bol_offset = data.find(BOL_MAGIC)
-        if bol_offset > 0:
-            if data.find(BOL_MAGIC, bol_offset + len(BOL_MAGIC)) < 0:
-                with open(course_filepath, 'r+b') as f:
-                    f.seek(bol_offset + MUSIC_ID_OFFSET)
-                    f.write(bytes([music_id]))
-                return
-
-    # Otherwise, extract the RARC file, locate the BOL file in the directory, patch the BOL file,
-    # and re-pack the RARC archive.
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        rarc.extract(course_filepath, tmp_dir)
-
-        course_dirpath = os.path.join(tmp_dir, os.listdir(tmp_dir)[0])
-        bol_filepath = os.path.join(
-            course_dirpath,
-            tuple(p for p in os.listdir(course_dirpath) if p.endswith('.bol'))[0])
-
-        with open(bol_filepath, 'r+b') as f:
-            f.seek(MUSIC_ID_OFFSET)
-            f.write(bytes([music_id]))
-
-        remove_file(course_filepath)  # It may be a hard link; unlink early.
-
-        rarc.pack(course_dirpath, course_filepath)
+    find_bol_file_in_course_archive(archive)[MUSIC_ID_OFFSET] = music_id
 
 
-def repack_course_arc_file(archive_filepath: str, new_dirname: str):
+def rename_course_archive_entries(archive: rarc.Directory, new_dirname: str):
     """
-    Extracts a RARC archive, renames its root directory and its files, and re-packs it.
+    Renames the root directory of a course archive, and the files in it that are prefixed with the
+    course name.
     """
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        rarc.extract(archive_filepath, tmp_dir)
-
-        dirnames = os.listdir(tmp_dir)
-        if len(dirnames) != 1:
-            raise MKDDExtenderError(f'Unable to rename entries in "{archive_filepath}". Unexpected '
-                                    'number of root entries in directory.')
-
-        dirname = dirnames[0]
-        dirpath = os.path.join(tmp_dir, dirname)
-        new_dirpath = os.path.join(tmp_dir, new_dirname)
-        rename(dirpath, new_dirpath)
-
-        course_name = new_dirname
-        if course_name.endswith('l'):
-            course_name = course_name[:-1]
-        if course_name.endswith('2') and not course_name.startswith('mini'):
-            course_name = course_name[:-1]
-
-        # Files that contain "_" in their names need to be renamed as well to the course name.
-        for filename in os.listdir(new_dirpath):
-            if '_' in filename:
-                filepath = os.path.join(new_dirpath, filename)
-                if os.path.isfile(filepath):
-                    parts = filename.split('_', maxsplit=1)
-                    new_filename = f'{course_name}_{parts[1]}'
-                    new_filepath = os.path.join(new_dirpath, new_filename)
-                    rename(filepath, new_filepath)
-
-        remove_file(archive_filepath)  # It may be a hard link; unlink early.
-
-        rarc.pack(new_dirpath, archive_filepath)
+    archive.name = new_dirname
+
+    course_name = new_dirname
+    if course_name.endswith('l'):
+        course_name = course_name[:-1]
+    if course_name.endswith('2') and not course_name.startswith('mini'):
+        course_name = course_name[:-1]
+
+    # Files that contain "_" in their names need to be renamed as well to the course name.
+    files = {}
+    for filename, data in archive.files.items():
+        if '_' in filename:
+            parts = filename.split('_', maxsplit=1)
+            filename = f'{course_name}_{parts[1]}'
+        if filename in files:
+            raise MKDDExtenderError(f'Rename of entries in "{archive.name}" course archive failed: '
+                                    f'"{filename}" exists.')
+        files[filename] = data
+    archive.files = files
+
+
+def decode_bti_image_in_process(filepath: str) -> Image.Image:
+    # Only image formats that the `bti` module can decode quickly are handled; for the rest, `None`
+    # is returned, and `wimgt` should be preferred. Files that cannot be read or that are malformed
+    # (e.g. truncated, or with unknown enum values in the header) are also left to `wimgt`; any
+    # other error is a bug in the decoder, and is not masked.
+    try:
+        with open(filepath, 'rb') as f:
+            bti_image = bti.BTI(f)
+            if bti.is_fast_decoding_supported(bti_image.image_format):
+                return bti_image.render()
+    except (OSError, ValueError, struct.error, bti.InvalidOffsetError) as e:
+        log.debug(f'Unable to decode "{filepath}" in process ({type(e).__name__}: {str(e)}); '
+                  'falling back to wimgt.')
+    return None
 
 
 def convert_bti_to_image(filepath: str) -> Image.Image:
     assert filepath.endswith('.bti')
 
+    image = decode_bti_image_in_process(filepath)
+    if image is not None:
+        return image
+
     with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
         filename = os.path.basename(filepath)
         tmp_filepath = os.path.join(tmp_dir, filename[:-len('.bti')] + '.png')
@@ -701,6 +1040,11 @@ def convert_bti_to_png(src_filepath: str, dst_filepath: str):
 
     os.makedirs(os.path.dirname(dst_filepath), exist_ok=True)
 
+    image = decode_bti_image_in_process(src_filepath)
+    if image is not None:
+        image.save(dst_filepath)
+        return
+
     wimgt_name = 'wimgt.exe' if windows else 'wimgt-mac' if macos else 'wimgt'
     wimgt_path = os.path.join(tools_dir, 'wimgt', wimgt_name)
     command = (wimgt_path, 'decode', src_filepath, '-o', '-d', dst_filepath)
@@ -713,9 +1057,36 @@ def convert_bti_to_png(src_filepath: str, dst_filepath: str):
             raise RuntimeError(f'Error occurred while converting image file ("{src_filepath}").')
 
 
+def convert_image_to_bti(image: Image.Image, dst_filepath: str, image_format: str):
+    assert dst_filepath.endswith('.bti')
+
+    if not bti.is_fast_encoding_supported(bti.ImageFormat[image_format]):
+        # Fall back to `wimgt`, which expects a PNG file.
+        with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
+            tmp_filepath = os.path.join(tmp_dir,
+                                        f'{os.path.splitext(os.path.basename(dst_filepath))[0]}.png')
+            image.save(tmp_filepath)
+            convert_png_to_bti(tmp_filepath, dst_filepath, image_format)
+        return
+
+    # The image is encoded in memory; the generated header has the wrap S/T fields already zeroed
+    # (see `convert_png_to_bti()`).
+    data = bti.create_bti_data_from_image(image, bti.ImageFormat[image_format])
+
+    os.makedirs(os.path.dirname(dst_filepath), exist_ok=True)
+    remove_file(dst_filepath)  # It may be a hard link; unlink early.
+    with open(dst_filepath, 'wb') as f:
+        f.write(data)
+
+
 def convert_png_to_bti(src_filepath: str, dst_filepath: str, image_format: str):
     assert src_filepath.endswith('.png')
 
+    if bti.is_fast_encoding_supported(bti.ImageFormat[image_format]):
+        with Image.open(src_filepath) as image:
+            convert_image_to_bti(image, dst_filepath, image_format)
+        return
+
     os.makedirs(os.path.dirname(dst_filepath), exist_ok=True)
 
     wimgt_name = 'wimgt.exe' if windows else 'wimgt-mac' if macos else 'wimgt'
@@ -774,17 +1145,12 @@ def conform_bti_image(filepath: str, width: int, height: int, image_format: str)
     if src_image_format == image_format and width == src_width and height == src_height:
         return
 
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        filename = os.path.basename(filepath)
-        tmp_filepath_png = os.path.join(tmp_dir, filename[:-len('.bti')] + '.png')
-
-        image = convert_bti_to_image(filepath)
-        image = image.resize((width, height), resample=RESAMPLING_FILTER, reducing_gap=3.0)
-        image.save(tmp_filepath_png)
+    image = convert_bti_to_image(filepath)
+    image = image.resize((width, height), resample=RESAMPLING_FILTER, reducing_gap=3.0)
 
-        remove_file(filepath)  # It may be a hard link; unlink early.
+    remove_file(filepath)  # It may be a hard link; unlink early.
 
-        convert_png_to_bti(tmp_filepath_png, filepath, image_format)
+    convert_image_to_bti(image, filepath, image_format)
 
 
 def crop_image_sides(image: Image.Image) -> Image.Image:
@@ -814,56 +1180,49 @@ def split_image(image: Image.Image) -> 'list[Image.Image]':
 
 
 def add_controls_to_title_image(filepath: str, language: str, use_alternative_buttons: bool):
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        title_filename = os.path.basename(filepath)
-        tmp_filepath = os.path.join(tmp_dir, title_filename[:-len('.bti')] + '.png')
-
-        convert_bti_to_png(filepath, tmp_filepath)
+    controls_filename = 'yx_buttons.png' if use_alternative_buttons else 'dpad_up_down.png'
+    controls_filepath = os.path.join(data_dir, 'controls', controls_filename)
+    controls_image = Image.open(controls_filepath)
+    slash_filepath = os.path.join(data_dir, 'controls', 'slash.png')
+    slash_image = Image.open(slash_filepath)
+    slash_image = slash_image.convert('RGBA')
 
-        controls_filename = 'yx_buttons.png' if use_alternative_buttons else 'dpad_up_down.png'
-        controls_filepath = os.path.join(data_dir, 'controls', controls_filename)
-        controls_image = Image.open(controls_filepath)
-        slash_filepath = os.path.join(data_dir, 'controls', 'slash.png')
-        slash_image = Image.open(slash_filepath)
-        slash_image = slash_image.convert('RGBA')
+    title_image = convert_bti_to_image(filepath)
+    title_image = title_image.convert('RGBA')
 
-        title_image = Image.open(tmp_filepath)
-        title_image = title_image.convert('RGBA')
+    canvas_width = title_image.width
+    canvas_height = title_image.height
 
-        canvas_width = title_image.width
-        canvas_height = title_image.height
+    words = split_image(title_image)
+    if language == 'Spanish':
+        words = words[0::2]  # Drop "UN" and "UNA" in Spanish, as otherwise it's too crowded.
+    words.append(slash_image)
+    words.append(controls_image)
 
-        words = split_image(title_image)
-        if language == 'Spanish':
-            words = words[0::2]  # Drop "UN" and "UNA" in Spanish, as otherwise it's too crowded.
-        words.append(slash_image)
-        words.append(controls_image)
+    effective_width = sum(img.width for img in words)
 
-        effective_width = sum(img.width for img in words)
+    available_width = canvas_width - effective_width
 
-        available_width = canvas_width - effective_width
+    MAX_SPACING = 10
+    spaces = len(words) - 1
+    spacing = min(MAX_SPACING, available_width // spaces)
+    spacing_width = spacing * spaces
 
-        MAX_SPACING = 10
-        spaces = len(words) - 1
-        spacing = min(MAX_SPACING, available_width // spaces)
-        spacing_width = spacing * spaces
+    margin_width = max(0, available_width - spacing_width)
+    offset = max(0, margin_width // 2)
 
-        margin_width = max(0, available_width - spacing_width)
-        offset = max(0, margin_width // 2)
-
-        ops = []
-        for word in words:
-            ops.append((word, (offset, 0)))
-            offset += spacing + word.width
+    ops = []
+    for word in words:
+        ops.append((word, (offset, 0)))
+        offset += spacing + word.width
 
-        image = Image.new('RGBA', (canvas_width, canvas_height))
-        for word, box in reversed(ops):
-            image.alpha_composite(word, dest=box)
-        image.save(tmp_filepath)
+    image = Image.new('RGBA', (canvas_width, canvas_height))
+    for word, box in reversed(ops):
+        image.alpha_composite(word, dest=box)
 
-        remove_file(filepath)  # It may be a hard link; unlink early.
+    remove_file(filepath)  # It may be a hard link; unlink early.
 
-        convert_png_to_bti(tmp_filepath, filepath, 'IA4')
+    convert_image_to_bti(image, filepath, 'IA4')
 
 
 def build_page_numbers_image(page_number: int, page_count: int) -> Image.Image:
@@ -875,71 +1234,57 @@ def build_page_numbers_image(page_number: int, page_count: int) -> Image.Image:
 
 
 def add_page_number_to_cup_name_image(filepath: str, page_number: int, page_count: int):
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        cupname_filename = os.path.basename(filepath)
-        tmp_filepath = os.path.join(tmp_dir, cupname_filename[:-len('.bti')] + '.png')
-
-        convert_bti_to_png(filepath, tmp_filepath)
-
-        cupname_image = Image.open(tmp_filepath)
-        original_mode = cupname_image.mode  # Original mode is 'LA'.
-        cupname_image = cupname_image.convert('RGBA')
-        canvas_width = cupname_image.width
-        canvas_height = cupname_image.height
-
-        numbers_image = build_page_numbers_image(page_number, page_count)
-        numbers_image = numbers_image.resize(
-            (int(numbers_image.width * 0.75), numbers_image.height),
-            resample=RESAMPLING_FILTER,
-            reducing_gap=3.0)
-
-        needed_margin = int(numbers_image.width / 1.5)
-        cropped_cupname_image = crop_image_sides(cupname_image)
-        available_margin = (cupname_image.width - cropped_cupname_image.width) // 2
-
-        margin = max(0, needed_margin - available_margin)
-        cropped_cupname_image = cropped_cupname_image.resize(
-            (cropped_cupname_image.width - margin * 2, cropped_cupname_image.height),
-            resample=RESAMPLING_FILTER,
-            reducing_gap=3.0)
-
-        image = Image.new('RGBA', (canvas_width, canvas_height))
-        image.paste(cropped_cupname_image, ((canvas_width - cropped_cupname_image.width) // 2, 0))
-        image.alpha_composite(numbers_image,
-                              dest=(canvas_width - numbers_image.width,
-                                    canvas_height - numbers_image.height))
-        image = image.convert(original_mode)
-        image.save(tmp_filepath)
+    cupname_image = convert_bti_to_image(filepath)
+    original_mode = cupname_image.mode  # 'LA' if decoded by `wimgt`.
+    cupname_image = cupname_image.convert('RGBA')
+    canvas_width = cupname_image.width
+    canvas_height = cupname_image.height
 
-        remove_file(filepath)  # It may be a hard link; unlink early.
+    numbers_image = build_page_numbers_image(page_number, page_count)
+    numbers_image = numbers_image.resize(
+        (int(numbers_image.width * 0.75), numbers_image.height),
+        resample=RESAMPLING_FILTER,
+        reducing_gap=3.0)
 
-        convert_png_to_bti(tmp_filepath, filepath, 'IA4')
+    needed_margin = int(numbers_image.width / 1.5)
+    cropped_cupname_image = crop_image_sides(cupname_image)
+    available_margin = (cupname_image.width - cropped_cupname_image.width) // 2
 
+    margin = max(0, needed_margin - available_margin)
+    cropped_cupname_image = cropped_cupname_image.resize(
+        (cropped_cupname_image.width - margin * 2, cropped_cupname_image.height),
+        resample=RESAMPLING_FILTER,
+        reducing_gap=3.0)
 
-def add_page_number_to_preview_image(filepath: str, page_number: int, page_count: int):
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        cupname_filename = os.path.basename(filepath)
-        tmp_filepath = os.path.join(tmp_dir, cupname_filename[:-len('.bti')] + '.png')
+    image = Image.new('RGBA', (canvas_width, canvas_height))
+    image.paste(cropped_cupname_image, ((canvas_width - cropped_cupname_image.width) // 2, 0))
+    image.alpha_composite(numbers_image,
+                          dest=(canvas_width - numbers_image.width,
+                                canvas_height - numbers_image.height))
+    image = image.convert(original_mode)
 
-        convert_bti_to_png(filepath, tmp_filepath)
+    remove_file(filepath)  # It may be a hard link; unlink early.
 
-        preview_image = Image.open(tmp_filepath)
-        original_mode = preview_image.mode
-        preview_image = preview_image.convert('RGBA')
-        canvas_width = preview_image.width
-        canvas_height = preview_image.height
+    convert_image_to_bti(image, filepath, 'IA4')
 
-        numbers_image = build_page_numbers_image(page_number, page_count)
 
-        image = Image.new('RGBA', (canvas_width, canvas_height))
-        image.paste(preview_image, (0, 0))
-        image.alpha_composite(numbers_image, dest=(canvas_width - numbers_image.width, 3))
-        image = image.convert(original_mode)
-        image.save(tmp_filepath)
+def add_page_number_to_preview_image(filepath: str, page_number: int, page_count: int):
+    preview_image = convert_bti_to_image(filepath)
+    original_mode = preview_image.mode
+    preview_image = preview_image.convert('RGBA')
+    canvas_width = preview_image.width
+    canvas_height = preview_image.height
 
-        remove_file(filepath)  # It may be a hard link; unlink early.
+    numbers_image = build_page_numbers_image(page_number, page_count)
 
-        convert_png_to_bti(tmp_filepath, filepath, 'CMPR')
+    image = Image.new('RGBA', (canvas_width, canvas_height))
+    image.paste(preview_image, (0, 0))
+    image.alpha_composite(numbers_image, dest=(canvas_width - numbers_image.width, 3))
+    image = image.convert(original_mode)
+
+    remove_file(filepath)  # It may be a hard link; unlink early.
+
+    convert_image_to_bti(image, filepath, 'CMPR')
 
 
 CHARACTERS = ('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '-', ':', '!', '.', '?', '/',
@@ -1185,14 +1530,9 @@ def generate_bti_image_from_bitmap_font(text: str,
         if postprocessing_callback is not None:
             image_with_background = postprocessing_callback(image_with_background)
 
-        with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-            tmp_filepath = os.path.join(tmp_dir,
-                                        f'{os.path.splitext(os.path.basename(filepath))[0]}.png')
-            image_with_background.save(tmp_filepath)
-
-            remove_file(filepath)  # It may be a hard link; unlink early.
+        remove_file(filepath)  # It may be a hard link; unlink early.
 
-            convert_png_to_bti(tmp_filepath, filepath, image_format)
+        convert_image_to_bti(image_with_background, filepath, image_format)
 
         return
 
@@ -1268,14 +1608,9 @@ def generate_bti_image(text: str, width: int, height: int, image_format: str,
     image = Image.new('RGBA', (width, height), background)
     image = Image.alpha_composite(image, tmp_image)
 
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
-        tmp_filepath = os.path.join(tmp_dir,
-                                    f'{os.path.splitext(os.path.basename(filepath))[0]}.png')
-        image.save(tmp_filepath)
-
-        remove_file(filepath)  # It may be a hard link; unlink early.
+    remove_file(filepath)  # It may be a hard link; unlink early.
 
-        convert_png_to_bti(tmp_filepath, filepath, image_format)
+    convert_image_to_bti(image, filepath, image_format)
 
 
 def conform_audio_file(filepath: str, mix_to_mono: bool, downsample_sample_rate: int):
@@ -1300,6 +1635,18 @@ def conform_audio_file(filepath: str, mix_to_mono: bool, downsample_sample_rate:
 
     log.info(f'Conforming audio file ("{filepath}")...')
 
+    if ast_converter.is_fast_conforming_supported():
+        # The audio file is streamed one block at a time; no intermediate WAV file is needed.
+        with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
+            tmp_filepath = os.path.join(tmp_dir, os.path.basename(filepath))
+            ast_converter.conform(filepath, tmp_filepath, needs_mixing,
+                                  downsample_sample_rate if needs_downsampling else None)
+
+            remove_file(filepath)  # It may be a hard link; unlink early.
+
+            shutil.move(tmp_filepath, filepath)
+        return
+
     with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as tmp_dir:
         wav_filepath = os.path.join(tmp_dir,
                                     os.path.splitext(os.path.basename(filepath))[0] + '.wav')
@@ -1486,7 +1833,7 @@ def patch_title_lines(use_alternative_buttons: bool, battle_stages_enabled: bool
 
 def with_page_index_suffix(page_index: int, path: str) -> str:
     stem, ext = os.path.splitext(path)
-    stem = stem[:-len(str(page_index))] + str(page_index)
+    stem = stem[:-1] + PAGE_INDEX_CHARACTERS[page_index]
     return stem + ext
 
 
@@ -1494,7 +1841,7 @@ def with_page_index_infix(page_index: int, path: str) -> str:
     dirname = os.path.dirname(path)
     filename = os.path.basename(path)
     filename = list(filename)
-    filename[1] = str(page_index)
+    filename[1] = PAGE_INDEX_CHARACTERS[page_index]
     filename = ''.join(filename)
     return os.path.join(dirname, filename)
 
@@ -1611,11 +1958,17 @@ def patch_cup_names(args: argparse.Namespace, page_count: int, iso_tmp_dir: str)
     log.info('Cup names patched.')
 
 
-def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
-                 iso_tmp_dir: str) -> 'tuple[dict | list]':
+def meld_courses(args: argparse.Namespace,
+                 raise_if_canceled: callable,
+                 iso_tmp_dir: str,
+                 prof: profiler.Profiler = None,
+                 stock_audio_tracks_checksums: 'dict[str, str]' = None) -> 'tuple[dict | list]':
+    prof = prof or profiler.Profiler(enabled=False)
+
     replaces_data = {}
     minimap_data = {}
     tilt_setting_data = {}
+    section_count_data = {}
     alternative_audio_data = {}
     matching_audio_override_data = {}
     added_course_names = []
@@ -1676,8 +2029,9 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                     if filename.startswith(prefix):
                         track_dirpath = os.path.join(tracks_tmp_dir, prefix)
                         log.info(f'Extracting and flattening "{path}" into "{track_dirpath}"...')
-                        extract_and_flatten(path, track_dirpath)
-                        unwrap_custom_track(track_dirpath)
+                        with prof.stage(filename, 'extract', prefix=prefix):
+                            extract_and_flatten(path, track_dirpath)
+                            unwrap_custom_track(track_dirpath)
                         prefix_to_nodename[prefix] = filename
                         processed += 1
                         raise_if_canceled()
@@ -1689,20 +2043,32 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
 
                     raise MKDDExtenderError(f'No track assigned to slot {prefix}.')
         else:
-            # Since there is not common multiple, the course count can be used to determine whether
-            # custom battle stages are present.
-            assert MAX_PAGES == 10  # If the number of extra pages grows, this assumption breaks.
-            battle_stages_enabled = len(paths) % RACE_AND_BATTLE_COURSE_COUNT == 0
+            # The course count can be used to determine whether custom battle stages are present,
+            # unless it is a common multiple, in which case the caller needs to be explicit.
+            battle_stages_enabled = getattr(args, 'battle_stages', None)
+            if battle_stages_enabled is None:
+                if (len(paths) % RACE_TRACK_COUNT == 0
+                        and len(paths) % RACE_AND_BATTLE_COURSE_COUNT == 0):
+                    raise MKDDExtenderError(
+                        f'Number of items in the `tracks` argument ({len(paths)}) is a multiple of '
+                        f'both {RACE_TRACK_COUNT} and {RACE_AND_BATTLE_COURSE_COUNT}; unable to '
+                        'determine whether custom battle stages are present.')
+                battle_stages_enabled = len(paths) % RACE_AND_BATTLE_COURSE_COUNT == 0
             page_course_count = (RACE_AND_BATTLE_COURSE_COUNT
                                  if battle_stages_enabled else RACE_TRACK_COUNT)
             prefixes = PREFIXES_WITH_BATTLE_STAGES if battle_stages_enabled else PREFIXES
+            if len(paths) % page_course_count != 0 or len(paths) > len(prefixes):
+                raise MKDDExtenderError(
+                    f'Number of items in the `tracks` argument ({len(paths)}) does not fill up to '
+                    f'{MAX_EXTRA_PAGES} pages of {page_course_count} courses.')
             for i, path in enumerate(paths):
                 prefix = prefixes[i]
                 filename = os.path.basename(path)
                 track_dirpath = os.path.join(tracks_tmp_dir, prefix)
                 log.info(f'Extracting and flattening "{path}" into "{track_dirpath}"...')
-                extract_and_flatten(path, track_dirpath)
-                unwrap_custom_track(track_dirpath)
+                with prof.stage(filename, 'extract', prefix=prefix):
+                    extract_and_flatten(path, track_dirpath)
+                    unwrap_custom_track(track_dirpath)
                 prefix_to_nodename[prefix] = filename
                 processed += 1
                 raise_if_canceled()
@@ -1722,6 +2088,13 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 f'Initial page number has been set to {initial_page_number}, but only '
                 f'{total_page_count} pages have been configured.')
 
+        if not args.extended_memory and total_page_count > MAX_PAGES_WITHOUT_EXTENDED_MEMORY:
+            raise MKDDExtenderError(
+                f'{total_page_count} pages have been configured, but only up to '
+                f'{MAX_PAGES_WITHOUT_EXTENDED_MEMORY} pages are supported unless extended memory '
+                'is enabled (`--extended-memory`). The preview and label images would otherwise '
+                'need to be downscaled to sizes that are no longer readable.')
+
         # RARC file gets too large, and causes a crash. Reducing image size is a workaround.
         # However, if extended memory has been set, the retail dimensions can be used instead.
         preview_image_factor = 1
@@ -1751,22 +2124,40 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
             battle_stages_label_image_size = (round(LABEL_IMAGE_SIZE[0] * label_image_factor),
                                               round(LABEL_IMAGE_SIZE[1] * label_image_factor))
         else:
-            preview_image_size = PREVIEW_IMAGE_SIZE
-            label_image_size = LABEL_IMAGE_SIZE
-            battle_stages_preview_image_size = BATTLE_STAGES_PREVIEW_IMAGE_SIZE
-            battle_stages_label_image_size = LABEL_IMAGE_SIZE
+            # Up to `MAX_PAGES_WITHOUT_EXTENDED_MEMORY` pages, the retail dimensions fit in the
+            # extended memory. Beyond that, the images are downscaled so that their total area (and
+            # therefore their size in the RARC files) stays the same.
+            if total_page_count > MAX_PAGES_WITHOUT_EXTENDED_MEMORY:
+                preview_image_factor = math.sqrt(MAX_PAGES_WITHOUT_EXTENDED_MEMORY /
+                                                 total_page_count)
+                if battle_stages_enabled:
+                    preview_image_factor *= 0.95
+                label_image_factor = preview_image_factor
+            preview_image_size = (round(PREVIEW_IMAGE_SIZE[0] * preview_image_factor),
+                                  round(PREVIEW_IMAGE_SIZE[1] * preview_image_factor))
+            battle_stages_preview_image_size = (round(BATTLE_STAGES_PREVIEW_IMAGE_SIZE[0] *
+                                                      preview_image_factor),
+                                                round(BATTLE_STAGES_PREVIEW_IMAGE_SIZE[1] *
+                                                      preview_image_factor))
+            label_image_size = (round(LABEL_IMAGE_SIZE[0] * label_image_factor),
+                                round(LABEL_IMAGE_SIZE[1] * label_image_factor))
+            battle_stages_label_image_size = label_image_size
 
         downscale_preview_images = preview_image_factor != 1
         downscale_label_images = label_image_factor != 1
 
-        # Populate dictionary with checksums from all the stock AST files.
-        audio_tracks_checksums = {}
-        for filename in os.listdir(stream_dirpath):
-            ast_filepath = os.path.join(stream_dirpath, filename)
-            checksum = md5sum(ast_filepath)
-            audio_tracks_checksums[checksum] = filename
+        # Populate dictionary with checksums from all the stock AST files, unless they have been
+        # provided by the caller (the stock AST files are then not extracted).
+        if stock_audio_tracks_checksums is not None:
+            audio_tracks_checksums = dict(stock_audio_tracks_checksums)
+        else:
+            audio_tracks_checksums = {}
+            for filename in os.listdir(stream_dirpath):
+                ast_filepath = os.path.join(stream_dirpath, filename)
+                checksum = md5sum(ast_filepath)
+                audio_tracks_checksums[checksum] = filename
 
-            raise_if_canceled()
+                raise_if_canceled()
 
         # Rename original directories.
         new_course_dirpath = with_page_index_suffix(0, course_dirpath)
@@ -1783,38 +2174,51 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
 
         raise_if_canceled()
 
-        def meld_course(prefix: str, nodename: str):
-            nonlocal melded
-
-            track_dirpath = os.path.join(tracks_tmp_dir, prefix)
+        def get_page_and_track_index(prefix: str) -> 'tuple[int, int]':
             page_index = ord(prefix[0]) - ord('A')
             page_index += 1
             track_index = int(prefix[1:3]) - 1
             assert 0 <= track_index < RACE_AND_BATTLE_COURSE_COUNT
+            return page_index, track_index
+
+        def get_image_filenames(track_index: int) -> 'tuple[str, str, str, callable]':
+            # Returns the name of the directory where the preview image and the label image of the
+            # slot are located, their original filenames, and the function that embeds the page
+            # index in the filenames.
+            is_battle_stage = RACE_TRACK_COUNT <= track_index
+
+            preview_image_partial_name = COURSE_TO_PREVIEW_IMAGE_NAME[COURSES[track_index]]
+            label_image_partial_name = COURSE_TO_LABEL_IMAGE_NAME[COURSES[track_index]]
+            if not is_battle_stage:
+                preview_filename = f'cop_{preview_image_partial_name}.bti'
+                label_filename = f'coname_{label_image_partial_name}.bti'
+            else:
+                preview_filename = f'battlemapsnap{preview_image_partial_name}.bti'
+                label_filename = f'mozi_map{label_image_partial_name}.bti'
+
+            with_page_index_xfix_func = (with_page_index_infix
+                                         if is_battle_stage else with_page_index_suffix)
+
+            appselect_dirname = 'mapselect' if is_battle_stage else 'courseselect'
+
+            return appselect_dirname, preview_filename, label_filename, with_page_index_xfix_func
+
+        def meld_course(prefix: str, nodename: str, output_filepaths: 'list[str]') -> tuple:
+            # NOTE: Courses may be melded concurrently (see `--jobs`). This function must not modify
+            # state that is shared with other courses; its results are returned to the caller, and
+            # merged in slot order. The paths of the files that are written are appended to
+            # `output_filepaths`.
+
+            track_dirpath = os.path.join(tracks_tmp_dir, prefix)
+            page_index, track_index = get_page_and_track_index(prefix)
             is_battle_stage = RACE_TRACK_COUNT <= track_index
 
             log.info(f'Melding "{nodename}" ("{track_dirpath}")...')
-            melded += 1
 
             page_course_dirpath = with_page_index_suffix(page_index, course_dirpath)
             page_coursename_dirpath = with_page_index_suffix(page_index, coursename_dirpath)
             page_staffghosts_dirpath = with_page_index_suffix(page_index, staffghosts_dirpath)
 
-            # Start off with a copy of the original directories. Relevant files will be replaced
-            # next.
-            if not os.path.isdir(page_course_dirpath):
-                shutil.copytree(course_dirpath, page_course_dirpath, copy_function=make_link)
-            if not os.path.isdir(page_coursename_dirpath):
-                shutil.copytree(coursename_dirpath,
-                                page_coursename_dirpath,
-                                copy_function=make_link)
-            if not os.path.isdir(page_staffghosts_dirpath):
-                shutil.copytree(staffghosts_dirpath,
-                                page_staffghosts_dirpath,
-                                copy_function=make_link)
-
-            raise_if_canceled()
-
             # Parse INI file.
             try:
                 trackinfo_filepath = os.path.join(track_dirpath, 'trackinfo.ini')
@@ -1836,7 +2240,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
 
             raise_if_canceled()
 
-            replaces_data[(page_index, track_index)] = course_name_to_course(replaces)
+            replacee = course_name_to_course(replaces)
 
             # Verify that a race track has not been assigned to a battle stage slot and viceversa.
             replaces_is_battle_stage = course_name_to_course(replaces).startswith('Mini')
@@ -1872,13 +2276,12 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
 
             raise_if_canceled()
 
-            added_course_names.append(trackname)
-
+            alternative_audio_course = None
             if not is_battle_stage:
                 if auxiliary_audio_track:
-                    alternative_audio_data[prefix] = course_name_to_course(auxiliary_audio_track)
+                    alternative_audio_course = course_name_to_course(auxiliary_audio_track)
                 elif replaces:
-                    alternative_audio_data[prefix] = course_name_to_course(replaces)
+                    alternative_audio_course = course_name_to_course(replaces)
 
             # Copy course files.
             track_filepath = os.path.join(track_dirpath, 'track.arc')
@@ -1900,50 +2303,52 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                     track_mp_50cc_filepath = track_mp_filepath
                 else:
                     log.info(f'Located `track_mp_50cc.arc` file in "{nodename}".')
+            course = COURSES[track_index]
+            lowercase_course = course.lower()
             if track_index == 0:
-                page_track_filepath = os.path.join(page_course_dirpath,
-                                                   f'{COURSES[track_index]}2.arc')
-                page_track_mp_filepath = os.path.join(page_course_dirpath,
-                                                      f'{COURSES[track_index]}2L.arc')
-                page_track_50cc_filepath = os.path.join(page_course_dirpath,
-                                                        f'{COURSES[track_index]}.arc')
-                page_track_mp_50cc_filepath = os.path.join(page_course_dirpath,
-                                                           f'{COURSES[track_index]}L.arc')
-                make_link(track_filepath, page_track_filepath)
-                make_link(track_mp_filepath, page_track_mp_filepath)
-                make_link(track_50cc_filepath, page_track_50cc_filepath)
-                make_link(track_mp_50cc_filepath, page_track_mp_50cc_filepath)
-
-                patch_music_id_in_bol_file(page_track_filepath, track_index)
-                patch_music_id_in_bol_file(page_track_mp_filepath, track_index)
-                patch_music_id_in_bol_file(page_track_50cc_filepath, track_index)
-                patch_music_id_in_bol_file(page_track_mp_50cc_filepath, track_index)
+                course_archives = (
+                    (track_filepath, f'{course}2.arc', f'{lowercase_course}2'),
+                    (track_mp_filepath, f'{course}2L.arc', f'{lowercase_course}2l'),
+                    (track_50cc_filepath, f'{course}.arc', lowercase_course),
+                    (track_mp_50cc_filepath, f'{course}L.arc', f'{lowercase_course}l'),
+                )
+            else:
+                course_archives = (
+                    (track_filepath, f'{course}.arc', lowercase_course),
+                    (track_mp_filepath, f'{course}L.arc', f'{lowercase_course}l'),
+                )
 
-                raise_if_canceled()
+            # Each source archive is read only once, and is shared across the page archives that
+            # are generated from it (e.g. when no `track_mp.arc` file is provided). Only the names
+            # of the entries differ between them.
+            archives = {}
+            for archive_filepath, page_filename, new_dirname in course_archives:
+                archive = archives.get(archive_filepath)
+                if archive is None:
+                    archive = rarc.read(archive_filepath)
+                    patch_music_id_in_course_archive(archive, track_index)
+                    archives[archive_filepath] = archive
 
-                repack_course_arc_file(page_track_filepath, f'{COURSES[track_index].lower()}2')
-                repack_course_arc_file(page_track_mp_filepath, f'{COURSES[track_index].lower()}2l')
-                repack_course_arc_file(page_track_50cc_filepath, f'{COURSES[track_index].lower()}')
-                repack_course_arc_file(page_track_mp_50cc_filepath,
-                                       f'{COURSES[track_index].lower()}l')
-            else:
-                page_track_filepath = os.path.join(page_course_dirpath,
-                                                   f'{COURSES[track_index]}.arc')
-                page_track_mp_filepath = os.path.join(page_course_dirpath,
-                                                      f'{COURSES[track_index]}L.arc')
-                make_link(track_filepath, page_track_filepath)
-                make_link(track_mp_filepath, page_track_mp_filepath)
+                rename_course_archive_entries(archive, new_dirname)
 
-                patch_music_id_in_bol_file(page_track_filepath, track_index)
-                patch_music_id_in_bol_file(page_track_mp_filepath, track_index)
+                page_archive_filepath = os.path.join(page_course_dirpath, page_filename)
+                remove_file(page_archive_filepath)  # It may be a hard link; unlink early.
+                rarc.write(archive, page_archive_filepath)
+                output_filepaths.append(page_archive_filepath)
 
                 raise_if_canceled()
 
-                repack_course_arc_file(page_track_filepath, f'{COURSES[track_index].lower()}')
-                repack_course_arc_file(page_track_mp_filepath, f'{COURSES[track_index].lower()}l')
+            tilt_setting = get_tilt_setting_from_course_archive(archives[track_filepath])
 
-            tilt_setting_data[(page_index, track_index)] = \
-                get_tilt_setting_from_bol_file(page_track_filepath)
+            section_count = 0
+            if args.sectioned_courses and not is_battle_stage:
+                # The game crashes on a race finish if more than 9 laps are present; the lap count
+                # is limited, but the course will not play as designed.
+                section_count = get_section_count_from_course_archive(archives[track_filepath])
+                if section_count > 9:
+                    log.warning(f'"{nodename}" has {section_count} section points. Only 9 laps '
+                                'will be counted in the game.')
+                    section_count = 9
 
             raise_if_canceled()
 
@@ -1954,6 +2359,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                     page_ght_filepath = os.path.join(page_staffghosts_dirpath,
                                                      f'{COURSES[track_index]}.ght')
                     make_link(ght_filepath, page_ght_filepath)
+                    output_filepaths.append(page_ght_filepath)
                 else:
                     log.warning(f'Unable to locate `staffghost.ght` file in "{nodename}".')
 
@@ -1966,25 +2372,13 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 use_replacee_audio_track = replaces and args.use_replacee_audio_track
                 use_alternative_audio_track = use_auxiliary_audio_track or use_replacee_audio_track
 
-            def conform_and_copy_if_not_cached(src_ast_filepath, dst_ast_filepath, args):
-                # Before copying a AST file to destination, check whether its checksum already
-                # exists, and, if so, insert an entry in the override table instead of copying the
-                # file over.
-
-                checksum = md5sum(src_ast_filepath)
-                dst_ast_filename = os.path.basename(dst_ast_filepath)
-
-                if checksum in audio_tracks_checksums:
-                    cached_filename = audio_tracks_checksums[checksum]
-                    matching_audio_override_data[dst_ast_filename] = cached_filename
-                    log.info(f'Reusing "{dst_ast_filename}" in place of "{cached_filename}" '
-                             f'(shared checksum: "{checksum})."')
-                    return
+            # Audio files are only gathered (along with their checksums) here. Whether they are
+            # copied or replaced with an existing audio file with the same checksum is decided when
+            # the results are merged.
+            audio_files = []
 
-                audio_tracks_checksums[checksum] = dst_ast_filename
-
-                make_link(src_ast_filepath, dst_ast_filepath)
-                conform_audio_file(dst_ast_filepath, args.mix_to_mono, args.sample_rate)
+            def conform_and_copy_if_not_cached(src_ast_filepath, dst_ast_filepath):
+                audio_files.append((src_ast_filepath, dst_ast_filepath, md5sum(src_ast_filepath)))
 
             if not is_battle_stage:
                 if not use_alternative_audio_track:
@@ -1999,15 +2393,14 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                                                                  'lap_music_fast.ast')
                     if os.path.isfile(lap_music_normal_filepath):
                         dst_ast_filepath = os.path.join(stream_dirpath, f'X_COURSE_{prefix}.ast')
-                        conform_and_copy_if_not_cached(lap_music_normal_filepath, dst_ast_filepath,
-                                                       args)
+                        conform_and_copy_if_not_cached(lap_music_normal_filepath, dst_ast_filepath)
 
                         lap_music_fast_filepath = os.path.join(track_dirpath, 'lap_music_fast.ast')
                         if os.path.isfile(lap_music_fast_filepath):
                             dst_ast_filepath = os.path.join(stream_dirpath,
                                                             f'X_FINALLAP_{prefix}.ast')
                             conform_and_copy_if_not_cached(lap_music_fast_filepath,
-                                                           dst_ast_filepath, args)
+                                                           dst_ast_filepath)
                         else:
                             log.warning(f'Unable to locate `lap_music_fast.ast` in "{nodename}". '
                                         '`lap_music_normal.ast` will be used.')
@@ -2112,6 +2505,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 page_coursename_filepath = os.path.join(page_coursename_language_dirpath,
                                                         f'{COURSES[track_index]}_name.bti')
                 copy_or_link_bti_image(logo_filepath, page_coursename_filepath)
+                output_filepaths.append(page_coursename_filepath)
 
             expected_languages = os.listdir(scenedata_dirpath)
             expected_languages = tuple(lang for lang in LANGUAGES if lang in expected_languages)
@@ -2119,40 +2513,10 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 raise MKDDExtenderError('Unable to locate `SceneData/language` directories in '
                                         f'"{nodename}".')
 
-            preview_image_partial_name = COURSE_TO_PREVIEW_IMAGE_NAME[COURSES[track_index]]
-            label_image_partial_name = COURSE_TO_LABEL_IMAGE_NAME[COURSES[track_index]]
-            if not is_battle_stage:
-                preview_filename = f'cop_{preview_image_partial_name}.bti'
-                label_filename = f'coname_{label_image_partial_name}.bti'
-            else:
-                preview_filename = f'battlemapsnap{preview_image_partial_name}.bti'
-                label_filename = f'mozi_map{label_image_partial_name}.bti'
-
-            with_page_index_xfix_func = (with_page_index_infix
-                                         if is_battle_stage else with_page_index_suffix)
-
-            new_preview_filename = with_page_index_xfix_func(0, preview_filename)
-            new_label_filename = with_page_index_xfix_func(0, label_filename)
-
-            appselect_dirname = 'mapselect' if is_battle_stage else 'courseselect'
-
-            if page_index == 1:
-                # Rename original filenames.
-                for language in expected_languages:
-                    appselect_dirpath = os.path.join(scenedata_dirpath, language, appselect_dirname,
-                                                     'timg')
-                    lanplay_dirpath = os.path.join(scenedata_dirpath, language, 'lanplay', 'timg')
-                    rename(os.path.join(appselect_dirpath, preview_filename),
-                           os.path.join(appselect_dirpath, new_preview_filename))
-                    rename(os.path.join(appselect_dirpath, label_filename),
-                           os.path.join(appselect_dirpath, new_label_filename))
-                    rename(os.path.join(lanplay_dirpath, label_filename),
-                           os.path.join(lanplay_dirpath, new_label_filename))
-
-                    raise_if_canceled()
-
-            preview_filename = new_preview_filename
-            label_filename = new_label_filename
+            appselect_dirname, preview_filename, label_filename, with_page_index_xfix_func = (
+                get_image_filenames(track_index))
+            preview_filename = with_page_index_xfix_func(0, preview_filename)
+            label_filename = with_page_index_xfix_func(0, label_filename)
 
             if is_battle_stage:
                 course_preview_image_size = battle_stages_preview_image_size
@@ -2177,6 +2541,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                     language, 'track_image.bti', *course_preview_image_size, 'CMPR', (0, 0, 0, 255))
                 page_preview_filepath = os.path.join(appselect_dirpath, page_preview_filename)
                 copy_or_link_bti_image(preview_filepath, page_preview_filepath)
+                output_filepaths.append(page_preview_filepath)
 
                 raise_if_canceled()
 
@@ -2190,6 +2555,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 )
                 page_label_filepath = os.path.join(appselect_dirpath, page_label_filename)
                 copy_or_link_bti_image(label_filepath, page_label_filepath)
+                output_filepaths.append(page_label_filepath)
 
                 raise_if_canceled()
 
@@ -2197,41 +2563,295 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                     language, 'track_name.bti', *course_label_image_size, 'IA4', (0, 0, 0, 0))
                 page_label_filepath = os.path.join(lanplay_dirpath, page_label_filename)
                 copy_or_link_bti_image(label_filepath, page_label_filepath)
+                output_filepaths.append(page_label_filepath)
 
             raise_if_canceled()
 
             # Gather minimap values.
             minimap_filepath = os.path.join(track_dirpath, 'minimap.json')
             try:
-                with open(minimap_filepath, 'r', encoding='ascii') as f:
-                    minimap_json = json.loads(f.read())
-                minimap_data[(page_index, track_index)] = (
-                    float(minimap_json['Top Left Corner X']),
-                    float(minimap_json['Top Left Corner Z']),
-                    float(minimap_json['Bottom Right Corner X']),
-                    float(minimap_json['Bottom Right Corner Z']),
-                    int(minimap_json['Orientation']),
-                )
+                minimap = read_minimap_data(minimap_filepath)
             except Exception as e:
                 raise MKDDExtenderError(f'Unable to parse minimap data in "{nodename}": '
                                         f'{str(e)}.') from e
 
+            return (trackname, replacee, alternative_audio_course, tilt_setting, section_count,
+                    minimap, audio_files)
+
+        # The keys of the cache entries cover the application itself (the melding logic and the
+        # modules that generate the files), and the options that have an effect on the generated
+        # files. The slot and the contents of the custom course (or the checksum of the audio file)
+        # are added to the key of each entry.
+        application_key_values = [__version__]
+        meld_cache_key_values = []
+        if MELD_CACHE_DIR:
+            for module in (sys.modules[__name__], ast_converter, bti, rarc):
+                try:
+                    with open(module.__file__, 'rb') as f:
+                        application_key_values.append(f.read())
+                except (AttributeError, OSError):
+                    # Source files may not be available in frozen builds.
+                    application_key_values.append(None)
+            meld_cache_key_values.extend(application_key_values)
+            meld_cache_key_values.extend(
+                (enabled_code_patches, args.skip_code_patches_check, args.use_auxiliary_audio_track,
+                 args.use_replacee_audio_track, preview_image_size, label_image_size,
+                 battle_stages_preview_image_size, battle_stages_label_image_size,
+                 sorted(os.listdir(coursename_dirpath)), sorted(os.listdir(scenedata_dirpath))))
+
+        def store_in_meld_cache(prefix: str, cache_key_dirpath: str, result: tuple,
+                                output_filepaths: 'list[str]'):
+            track_dirpath = os.path.join(tracks_tmp_dir, prefix)
+            (trackname, replacee, alternative_audio_course, tilt_setting, section_count, minimap,
+             audio_files) = result
+
+            # Paths are stored relative to the track directory (source audio files) or to the
+            # `files` directory in the ISO (everything else).
+            manifest = {
+                'trackname': trackname,
+                'replacee': replacee,
+                'alternative_audio_course': alternative_audio_course,
+                'tilt_setting': tilt_setting,
+                'section_count': section_count,
+                'minimap': minimap,
+                'audio_files': [(os.path.relpath(src_ast_filepath, track_dirpath),
+                                 os.path.relpath(dst_ast_filepath, files_dirpath), checksum)
+                                for src_ast_filepath, dst_ast_filepath, checksum in audio_files],
+                'files': [],
+            }
+
+            os.makedirs(MELD_CACHE_DIR, exist_ok=True)
+
+            # The entry is populated in a temporary directory first, so that concurrent builds never
+            # see a partial entry.
+            tmp_dirpath = tempfile.mkdtemp(dir=MELD_CACHE_DIR)
+            try:
+                for i, filepath in enumerate(output_filepaths):
+                    filename = f'{i}_{os.path.basename(filepath)}'
+                    shutil.copyfile(filepath, os.path.join(tmp_dirpath, filename))
+                    manifest['files'].append((os.path.relpath(filepath, files_dirpath), filename))
+                with open(os.path.join(tmp_dirpath, 'manifest.json'), 'w', encoding='utf-8') as f:
+                    json.dump(manifest, f, indent=4)
+                os.rename(tmp_dirpath, cache_key_dirpath)
+            except OSError:
+                # Another build may have stored the same entry in the meantime.
+                shutil.rmtree(tmp_dirpath, ignore_errors=True)
+
+        def restore_from_meld_cache(prefix: str, cache_key_dirpath: str) -> tuple:
+            track_dirpath = os.path.join(tracks_tmp_dir, prefix)
+
+            with open(os.path.join(cache_key_dirpath, 'manifest.json'), 'r', encoding='utf-8') as f:
+                manifest = json.load(f)
+
+            for relpath, filename in manifest['files']:
+                filepath = os.path.join(files_dirpath, relpath)
+                os.makedirs(os.path.dirname(filepath), exist_ok=True)
+                remove_file(filepath)  # It may be a hard link; unlink early.
+                shutil.copyfile(os.path.join(cache_key_dirpath, filename), filepath)
+
+                raise_if_canceled()
+
+            # Source audio files are not cached; they are still available in the track directory,
+            # whose contents are part of the key.
+            audio_files = []
+            for src_ast_relpath, dst_ast_relpath, checksum in manifest['audio_files']:
+                audio_files.append((os.path.join(track_dirpath, src_ast_relpath),
+                                    os.path.join(files_dirpath, dst_ast_relpath), checksum))
+
+            return (manifest['trackname'], manifest['replacee'],
+                    manifest['alternative_audio_course'], manifest['tilt_setting'],
+                    manifest['section_count'], tuple(manifest['minimap']), audio_files)
+
+        def meld_course_or_reuse(prefix: str, nodename: str) -> tuple:
+            # Slots may be melded concurrently; counters are measured in the calling thread.
+            with prof.stage(nodename, 'slot', per_thread=True, prefix=prefix) as stage_args:
+                output_filepaths = []
+                if not MELD_CACHE_DIR:
+                    return meld_course(prefix, nodename, output_filepaths)
+
+                # The key must be computed before melding, as some of the files in the track
+                # directory are conformed in place.
+                track_dirpath = os.path.join(tracks_tmp_dir, prefix)
+                cache_key = hash_values(*meld_cache_key_values, prefix,
+                                        hash_directory(track_dirpath))
+                cache_key_dirpath = os.path.join(MELD_CACHE_DIR, cache_key)
+
+                if os.path.isdir(cache_key_dirpath):
+                    try:
+                        result = restore_from_meld_cache(prefix, cache_key_dirpath)
+                        log.info(f'Reused cached files for "{nodename}" ("{cache_key_dirpath}").')
+                        stage_args['cached'] = True
+                        return result
+                    except MKDDExtenderCanceled:
+                        raise
+                    except Exception as e:
+                        log.warning(f'Unable to reuse cached files for "{nodename}" '
+                                    f'("{cache_key_dirpath}"): {str(e)}. The course will be '
+                                    'melded.')
+
+                result = meld_course(prefix, nodename, output_filepaths)
+                store_in_meld_cache(prefix, cache_key_dirpath, result, output_filepaths)
+                return result
+
+        def copy_and_conform_audio_file(src_ast_filepath: str, dst_ast_filepath: str,
+                                        checksum: str):
+            with prof.stage(os.path.basename(dst_ast_filepath), 'audio', per_thread=True):
+                if not MELD_CACHE_DIR or not (args.mix_to_mono or args.sample_rate):
+                    make_link(src_ast_filepath, dst_ast_filepath)
+                    conform_audio_file(dst_ast_filepath, args.mix_to_mono, args.sample_rate)
+                    return
+
+                cache_filepath = os.path.join(
+                    MELD_CACHE_DIR,
+                    hash_values(*application_key_values, checksum, args.mix_to_mono,
+                                args.sample_rate, ast_converter.is_fast_conforming_supported()) +
+                    '.ast')
+                if os.path.isfile(cache_filepath):
+                    remove_file(dst_ast_filepath)  # It may be a hard link; unlink early.
+                    shutil.copyfile(cache_filepath, dst_ast_filepath)
+                    return
+
+                make_link(src_ast_filepath, dst_ast_filepath)
+                conform_audio_file(dst_ast_filepath, args.mix_to_mono, args.sample_rate)
+
+                os.makedirs(MELD_CACHE_DIR, exist_ok=True)
+                tmp_fd, tmp_filepath = tempfile.mkstemp(dir=MELD_CACHE_DIR)
+                os.close(tmp_fd)
+                try:
+                    shutil.copyfile(dst_ast_filepath, tmp_filepath)
+                    os.replace(tmp_filepath, cache_filepath)
+                except OSError:
+                    remove_file(tmp_filepath)
+
         raise_if_canceled()
 
         # Copy files into the ISO temporary directory.
         log.info('Melding directories...')
 
-        for prefix in prefixes[:len(prefix_to_nodename)]:
-            nodename = prefix_to_nodename[prefix]
+        melding_prefixes = prefixes[:len(prefix_to_nodename)]
+
+        # Start off with a copy of the original directories in every page. Relevant files will be
+        # replaced next.
+        for page_index in sorted(set(get_page_and_track_index(p)[0] for p in melding_prefixes)):
+            for dirpath in (course_dirpath, coursename_dirpath, staffghosts_dirpath):
+                page_dirpath = with_page_index_suffix(page_index, dirpath)
+                if not os.path.isdir(page_dirpath):
+                    shutil.copytree(dirpath, page_dirpath, copy_function=make_link)
+
+            raise_if_canceled()
+
+        # The original preview images and label images become the images of the first page.
+        scenedata_languages = tuple(lang for lang in LANGUAGES
+                                    if lang in os.listdir(scenedata_dirpath))
+        for prefix in melding_prefixes:
+            page_index, track_index = get_page_and_track_index(prefix)
+            if page_index != 1:
+                continue
+
+            appselect_dirname, preview_filename, label_filename, with_page_index_xfix_func = (
+                get_image_filenames(track_index))
+            new_preview_filename = with_page_index_xfix_func(0, preview_filename)
+            new_label_filename = with_page_index_xfix_func(0, label_filename)
 
+            for language in scenedata_languages:
+                appselect_dirpath = os.path.join(scenedata_dirpath, language, appselect_dirname,
+                                                 'timg')
+                lanplay_dirpath = os.path.join(scenedata_dirpath, language, 'lanplay', 'timg')
+                rename(os.path.join(appselect_dirpath, preview_filename),
+                       os.path.join(appselect_dirpath, new_preview_filename))
+                rename(os.path.join(appselect_dirpath, label_filename),
+                       os.path.join(appselect_dirpath, new_label_filename))
+                rename(os.path.join(lanplay_dirpath, label_filename),
+                       os.path.join(lanplay_dirpath, new_label_filename))
+
+            raise_if_canceled()
+
+        # When more than one job is requested, courses are melded concurrently in a thread pool.
+        # The work is dominated by file I/O, by image conversion, and by audio conversion. Image
+        # conversion runs in process only where numpy is available (see
+        # `bti.is_fast_decoding_supported()`), whose array operations release the interpreter lock
+        # for the most part; otherwise, it runs in `wimgt` processes. The remaining pure-Python work
+        # (e.g. Yaz0 decoding, or the slow BTI fallback paths) is serialized by the interpreter
+        # lock, and does not scale with the number of jobs. Results are still merged in slot order,
+        # so that the output is deterministic regardless of the number of jobs.
+        jobs = max(1, args.jobs or 1)
+        executor = concurrent.futures.ThreadPoolExecutor(max_workers=jobs) if jobs > 1 else None
+
+        def submit(func: callable, *func_args) -> concurrent.futures.Future:
+            if executor is not None:
+                return executor.submit(func, *func_args)
+            # With a single job, the function is run immediately in the calling thread.
+            future = concurrent.futures.Future()
             try:
-                meld_course(prefix, nodename)
-            except MKDDExtenderCanceled:
-                raise
-            except (AssertionError, Exception) as e:
-                error_message = f': {str(e)}' if str(e) else ''
-                raise type(e)(
-                    f'Unexpected error while processing "{nodename}"{error_message}') from e
+                future.set_result(func(*func_args))
+            except BaseException as e:
+                future.set_exception(e)
+            return future
+
+        def wrap_exception(nodename: str, e: Exception) -> Exception:
+            error_message = f': {str(e)}' if str(e) else ''
+            return type(e)(f'Unexpected error while processing "{nodename}"{error_message}')
+
+        try:
+            audio_futures = []
+
+            futures = ((prefix, submit(meld_course_or_reuse, prefix, prefix_to_nodename[prefix]))
+                       for prefix in melding_prefixes)
+            if executor is not None:
+                futures = list(futures)  # Queue all courses upfront.
+
+            for prefix, future in futures:
+                nodename = prefix_to_nodename[prefix]
+                page_index, track_index = get_page_and_track_index(prefix)
+
+                try:
+                    (trackname, replacee, alternative_audio_course, tilt_setting, section_count,
+                     minimap, audio_files) = future.result()
+                except MKDDExtenderCanceled:
+                    raise
+                except (AssertionError, Exception) as e:
+                    raise wrap_exception(nodename, e) from e
+
+                melded += 1
+                replaces_data[(page_index, track_index)] = replacee
+                added_course_names.append(trackname)
+                if alternative_audio_course is not None:
+                    alternative_audio_data[prefix] = alternative_audio_course
+                tilt_setting_data[(page_index, track_index)] = tilt_setting
+                section_count_data[(page_index, track_index)] = section_count
+                minimap_data[(page_index, track_index)] = minimap
+
+                # Before copying a AST file to destination, check whether its checksum already
+                # exists, and, if so, insert an entry in the override table instead of copying the
+                # file over.
+                for src_ast_filepath, dst_ast_filepath, checksum in audio_files:
+                    dst_ast_filename = os.path.basename(dst_ast_filepath)
+
+                    if checksum in audio_tracks_checksums:
+                        cached_filename = audio_tracks_checksums[checksum]
+                        matching_audio_override_data[dst_ast_filename] = cached_filename
+                        log.info(f'Reusing "{dst_ast_filename}" in place of "{cached_filename}" '
+                                 f'(shared checksum: "{checksum})."')
+                        continue
+
+                    audio_tracks_checksums[checksum] = dst_ast_filename
+
+                    audio_futures.append((nodename,
+                                          submit(copy_and_conform_audio_file, src_ast_filepath,
+                                                 dst_ast_filepath, checksum)))
+
+                raise_if_canceled()
+
+            for nodename, future in audio_futures:
+                try:
+                    future.result()
+                except MKDDExtenderCanceled:
+                    raise
+                except (AssertionError, Exception) as e:
+                    raise wrap_exception(nodename, e) from e
+        finally:
+            if executor is not None:
+                executor.shutdown(wait=True, cancel_futures=True)
 
         raise_if_canceled()
 
@@ -2311,7 +2931,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
                 for filename in os.listdir(mapselect_dirpath):
                     if not filename.endswith('ttlemapsnap1.bti'):
                         continue
-                    page_index = ord(filename[1]) - ord('0')
+                    page_index = PAGE_INDEX_CHARACTERS.find(filename[1])
                     assert 0 <= page_index < total_page_count
                     page_number = page_index + 1
                     image_filepath = os.path.join(mapselect_dirpath, filename)
@@ -2327,6 +2947,7 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
         replaces_data,
         minimap_data,
         tilt_setting_data,
+        section_count_data,
         alternative_audio_data,
         matching_audio_override_data,
         added_course_names,
@@ -2334,13 +2955,11 @@ def meld_courses(args: argparse.Namespace, raise_if_canceled: callable,
     )
 
 
-def gather_audio_file_indices(iso_tmp_dir: str, alternative_audio_data: 'dict[str, str]',
+def gather_audio_file_indices(file_list: 'tuple[str]', alternative_audio_data: 'dict[str, str]',
                               matching_audio_override_data: 'dict[str, str]') -> tuple:
     # The code generator needs the list of 32 integers with the file index of each audio track
     # mapped to each track.
 
-    file_list = build_file_list(iso_tmp_dir)
-
     COURSE_STREAM_ORDER = {
         'BabyLuigi': ('BABY', ),
         'Peach': ('BEACH', ),
@@ -2451,9 +3070,10 @@ def verify_dol_checksum(args: argparse.Namespace, iso_tmp_dir: str):
 
 
 def patch_dol_file(args: argparse.Namespace, replaces_data: dict, minimap_data: dict,
-                   tilt_setting_data: dict, alternative_audio_data: 'dict[str, str]',
+                   tilt_setting_data: dict, section_count_data: dict,
+                   alternative_audio_data: 'dict[str, str]',
                    matching_audio_override_data: 'dict[str, str]', battle_stages_enabled: bool,
-                   iso_tmp_dir: str):
+                   iso_tmp_dir: str, unextracted_filepaths: 'tuple[str]' = ()):
     sys_dirpath = os.path.join(iso_tmp_dir, 'sys')
     dol_path = os.path.join(sys_dirpath, 'main.dol')
     bi2_path = os.path.join(sys_dirpath, 'bi2.bin')
@@ -2482,7 +3102,10 @@ def patch_dol_file(args: argparse.Namespace, replaces_data: dict, minimap_data:
 
     initial_page_number = max(1, args.initial_page_number or 0)
 
-    audio_track_data = gather_audio_file_indices(iso_tmp_dir, alternative_audio_data,
+    # The file list is shared with the code patcher, which needs it to remap the audio tracks when
+    # the initial page is not the first one.
+    file_list = build_file_list(iso_tmp_dir, unextracted_filepaths)
+    audio_track_data = gather_audio_file_indices(file_list, alternative_audio_data,
                                                  matching_audio_override_data)
 
     code_patcher.patch_dol_file(
@@ -2494,7 +3117,9 @@ def patch_dol_file(args: argparse.Namespace, replaces_data: dict, minimap_data:
         replaces_data,
         minimap_data,
         tilt_setting_data,
+        section_count_data,
         audio_track_data,
+        file_list,
         battle_stages_enabled,
         bool(args.remove_movie_trailer),
         bool(args.extender_cup),
@@ -2833,11 +3458,127 @@ OPTIONAL_ARGUMENTS = {
             '`courseselect.arc` and `mapselect.arc` files. When `--extended-memory` is provided, '
             'the full, original image size is used.'
             '\n\n'
+            f'Without `--extended-memory`, up to {MAX_PAGES_WITHOUT_EXTENDED_MEMORY} pages (144 '
+            f'custom race tracks, or 54 custom battle stages) are supported. Up to {MAX_PAGES} '
+            'pages can be configured when `--extended-memory` is provided; beyond '
+            f'{MAX_PAGES_WITHOUT_EXTENDED_MEMORY} pages, the images are downscaled so that their '
+            f'combined size stays that of {MAX_PAGES_WITHOUT_EXTENDED_MEMORY} pages (e.g. '
+            '156x112 preview images with 27 pages).'
+            '\n\n'
             'IMPORTANT: The resulting ISO image will only work in Dolphin, and it is mandatory to '
             'also extend the emulated memory size to 32 MiB. See **Config > Advanced > Memory '
             'Override** in Dolphin. Failing to enable the emulated memory size in Dolphin will '
             'make the game crash to a green screen.',
         ),
+        (
+            'Compact Code Data',
+            bool,
+            'If specified, the per-page data tables that are injected in the DOL file are stored '
+            'in a compact form: minimap coordinates are stored as 16-bit fixed-point values, and '
+            'audio track indexes are stored relative to the lowest index. This reduces the size '
+            'of the injected code, leaving more memory available in the game heap, which can help '
+            'builds with many course pages and heavy custom courses.'
+            '\n\n'
+            'Minimap coordinates are rounded to the fixed-point precision, which is in the order '
+            'of a few units for the largest courses; the difference is not visible in the game.',
+        ),
+        (
+            'Lazy Course Page Data',
+            bool,
+            'If specified, switching course pages will only update the course filenames; the '
+            'minimap values and the audio track indexes of the selected page will be written once '
+            'the D-pad is released in the course selection screens, or when the course is loaded '
+            '(in `Course::reset()`), and only if the page differs from the page whose data is '
+            'already in memory.'
+            '\n\n'
+            'This makes page switches in the course selection screens cheaper, regardless of the '
+            'number of course pages.',
+        ),
+        (
+            'Instant Map Select Refresh',
+            bool,
+            'If specified, the **SELECT MAP** screen (battle stages) will be refreshed on a course '
+            'page change by initializing the screen once with its intro animation set to the final '
+            'frame, instead of initializing it once per frame of the animation (16 times).'
+            '\n\n'
+            '**Experimental.** It has not been verified that the screen ends up in the same state '
+            'as with the 16 initialization passes (the initialization may rely on the intermediate '
+            'frames), nor that the refresh is measurably faster in the game. This option is meant '
+            'for testing purposes.',
+        ),
+        (
+            'Code Optimization',
+            ('choices', ['O1', 'O2', 'Os'], 'O1'),
+            'Optimization level that is used to compile the code that is injected in the DOL file. '
+            '`Os` produces the smallest code, which leaves more memory available in the game heap; '
+            '`O2` favors speed in the code that runs on every frame. Default is `O1`.'
+            '\n\n'
+            'With `Os`, the functions that save and restore registers out of line (which the '
+            'compiler relies on to reduce the size of function prologues and epilogues) are also '
+            'injected, at a fixed cost of 244 bytes that is already accounted for in the total.'
+            '\n\n'
+            'Unused code is always stripped from the injected code; with **Debug Output**, the size '
+            'of each symbol is printed.',
+        ),
+        (
+            'Performance Counters',
+            bool,
+            'If specified, the injected entry points (page change logic in the course selection '
+            'screens, item rolls in type-specific item boxes, and lap checks in sectioned courses) '
+            'will be instrumented to measure their cost in the game. For each entry point, the '
+            'call count, the maximum time, and the total time (in ticks of the Time Base Register, '
+            'at 40.5 MHz) are accumulated in a memory block whose address is printed to the log, '
+            'and that can be inspected in the memory viewer in Dolphin.'
+            '\n\n'
+            'This option is meant for development purposes.',
+        ),
+        (
+            'Output Format',
+            ('choices', ['iso', 'delta'], 'iso'),
+            'Specifies what is written to the output path. Default is `iso`: the full extended ISO '
+            'image.'
+            '\n\n'
+            'If set to `delta`, a delta patch against the input ISO file is written instead. Data '
+            'that is carried over from the input ISO file (most of the disc) is not stored in the '
+            'patch, but referenced; only the modified system files, the file system table, and '
+            'the new or modified files are included. The patch is therefore roughly the size of '
+            'the added custom content, and takes less time to write.'
+            '\n\n'
+            'The patch can be applied to the original ISO file (which is verified before the patch '
+            'is applied) to reproduce the extended ISO image byte for byte:'
+            '\n\n'
+            '`python tools/gcm.py <original ISO> <patch> <output ISO>`',
+        ),
+        (
+            'Profile Report',
+            ('choices', ['off', 'json', 'chrome-trace'], 'off'),
+            'If set, the stages of the process (ISO extraction, RARC extraction, melding of each '
+            'custom course, code injection, RARC packing, ISO writing, etc.) will be measured, and '
+            'a report will be written next to the output ISO file: `<output>.profile.json` in '
+            '`json` format, or `<output>.trace.json` in `chrome-trace` format, which can be loaded '
+            'in `chrome://tracing` or in the Perfetto UI.'
+            '\n\n'
+            'For each stage, the wall time, the CPU time (also of the child processes, such as '
+            '**wimgt** or the compiler), the peak memory usage, and the number of bytes read and '
+            'written (Linux only) are recorded. Custom courses that are melded concurrently are '
+            'measured per thread.'
+            '\n\n'
+            'This option is meant for development purposes.',
+        ),
+        (
+            'Jobs',
+            int,
+            'If set, up to the given number of custom courses will be melded concurrently. Each '
+            'custom course is processed independently (course files, images, and audio files), '
+            'and the results are merged in slot order, so the output does not depend on the '
+            'number of jobs.'
+            '\n\n'
+            'The RARC archives that are modified (menu archives in every language, cup names, '
+            'award screen, etc.) are also extracted and packed concurrently, in up to the given '
+            'number of processes.'
+            '\n\n'
+            'By default, custom courses are melded one at a time.',
+        ),
         (
             'Debug Output',
             bool,
@@ -2932,6 +3673,28 @@ def create_args_parser() -> argparse.ArgumentParser:
     return parser
 
 
+@contextlib.contextmanager
+def profile_report(args: argparse.Namespace) -> 'collections.abc.Iterator[profiler.Profiler]':
+    """
+    Yields a profiler that is enabled if a profile report has been requested. The report is written
+    next to the output ISO file when the context is exited, also if the process has failed.
+    """
+    report_format = args.profile_report if args.profile_report != 'off' else None
+    prof = profiler.Profiler(enabled=report_format is not None)
+    try:
+        with prof.stage('Extend game'):
+            yield prof
+    finally:
+        if report_format is not None:
+            extension = '.profile.json' if report_format == 'json' else '.trace.json'
+            report_filepath = f'{args.output}{extension}'
+            try:
+                prof.write(report_filepath, report_format)
+                log.info(f'Profile report written to "{report_filepath}".')
+            except OSError as e:
+                log.error(f'Unable to write profile report to "{report_filepath}": {str(e)}')
+
+
 def extend_game(args: argparse.Namespace, raise_if_canceled: callable = lambda: None):
     start_time = time.monotonic()
 
@@ -2943,22 +3706,59 @@ def extend_game(args: argparse.Namespace, raise_if_canceled: callable = lambda:
     if args.input == args.output:
         raise MKDDExtenderError('Paths to the input and output ISO files must be different.')
 
-    with tempfile.TemporaryDirectory(prefix=TEMP_DIR_PREFIX) as iso_tmp_dir:
-        # Extract the ISO file entirely for now. In the future, only extracting the files that need
-        # to be read might be ideal performance-wise.
-        log.info(f'Extracting "{args.input}" image to "{iso_tmp_dir}"...')
-        gcm_file = gcm.GCM(args.input)
-        try:
-            gcm_file.read_entire_disc()
-        except Exception as e:
-            raise MKDDExtenderError(f'Unable to read input ISO image: {str(e)}') from e
-        if os.path.join('files', 'Cours0') in gcm_file.dirs_by_path:
-            raise MKDDExtenderError('The input ISO image appears to have been extended already.')
-        files_extracted = 0
-        for _filepath, files_done in gcm_file.export_disc_to_folder_with_changed_files(iso_tmp_dir):
-            if files_done > 0:
-                files_extracted = files_done
-        log.info(f'Image extracted ({files_extracted} files).')
+    with profile_report(args) as prof, tempfile.TemporaryDirectory(
+            prefix=TEMP_DIR_PREFIX) as iso_tmp_dir, contextlib.ExitStack() as exit_stack:
+        # Only the files that are read or rewritten are extracted. The rest of the files (including
+        # the stock AST files, which are only needed for their checksums) will be copied straight
+        # from the input ISO image when the extended image is written.
+        with prof.stage('Extract ISO image'):
+            log.info(f'Extracting "{args.input}" image to "{iso_tmp_dir}"...')
+            # The input ISO is memory-mapped; the mapping is released as soon as the image has been
+            # written, or on error (a traceback may otherwise keep it alive, and lock the file).
+            gcm_file = exit_stack.enter_context(gcm.GCM(args.input))
+            try:
+                gcm_file.read_entire_disc()
+            except Exception as e:
+                raise MKDDExtenderError(f'Unable to read input ISO image: {str(e)}') from e
+            if os.path.join('files', 'Cours0') in gcm_file.dirs_by_path:
+                raise MKDDExtenderError(
+                    'The input ISO image appears to have been extended already.')
+            if args.remove_movie_trailer:
+                # No need to extract files that will be dropped from the image.
+                movie_dir_entry = gcm_file.dirs_by_path_lowercase.get(
+                    os.path.join('files', 'movie'))
+                if movie_dir_entry is not None:
+                    gcm_file.delete_directory(movie_dir_entry)
+            EXTRACTED_PATH_PREFIXES = tuple(
+                os.path.join(*path.split('/')).lower()
+                for path in ('sys/', 'files/AudioRes/', 'files/AwardData/', 'files/Course',
+                             'files/MRAM', 'files/SceneData/', 'files/StaffGhosts/',
+                             'files/opening.bnr'))
+            stream_dirpath = os.path.join('files', 'AudioRes', 'Stream')
+
+            def is_extracted(path: str) -> bool:
+                path = path.lower()
+                return (path.startswith(EXTRACTED_PATH_PREFIXES)
+                        and os.path.dirname(path) != stream_dirpath.lower())
+
+            files_extracted = 0
+            for _filepath, files_done in gcm_file.export_disc_to_folder_with_changed_files(
+                    iso_tmp_dir, path_filter=is_extracted):
+                if files_done > 0:
+                    files_extracted = files_done
+            unextracted_filepaths = tuple(gcm_file.unexported_files)
+            os.makedirs(os.path.join(iso_tmp_dir, stream_dirpath), exist_ok=True)
+            log.info(f'Image extracted ({files_extracted} files; '
+                     f'{len(unextracted_filepaths)} files left in the image).')
+
+            stock_audio_tracks_checksums = {}
+            for filepath in unextracted_filepaths:
+                if os.path.dirname(filepath).lower() == stream_dirpath.lower():
+                    file_entry = gcm_file.files_by_path[filepath]
+                    checksum = hashlib.md5(gcm_file.read_file_entry_data(file_entry)).hexdigest()
+                    stock_audio_tracks_checksums[checksum] = os.path.basename(filepath)
+
+                    raise_if_canceled()
 
         raise_if_canceled()
 
@@ -2968,137 +3768,137 @@ def extend_game(args: argparse.Namespace, raise_if_canceled: callable = lambda:
         raise_if_canceled()
 
         # To determine which have been added, build the initial list now.
-        log.info('Building initial file list...')
-        initial_file_list = build_file_list(iso_tmp_dir)
-        log.info(f'File list built ({len(initial_file_list)} entries).')
+        with prof.stage('Build initial file list'):
+            log.info('Building initial file list...')
+            initial_file_list = build_file_list(iso_tmp_dir, unextracted_filepaths)
+            log.info(f'File list built ({len(initial_file_list)} entries).')
 
         raise_if_canceled()
 
         # Extract the relevant RARC files that will be modified.
-        log.info('Extracting RARC files...')
-        RARC_FILENAMES = ('courseselect.arc', 'LANPlay.arc', 'mapselect.arc', 'titleline.arc')
-        files_dirpath = os.path.join(iso_tmp_dir, 'files')
-        scenedata_dirpath = os.path.join(files_dirpath, 'SceneData')
-        scenedata_filenames = os.listdir(scenedata_dirpath)
-        rarc_extracted = 0
-        for language in LANGUAGES:
-            if language not in scenedata_filenames:
-                continue
-            for filename in RARC_FILENAMES:
-                filepath = os.path.join(scenedata_dirpath, language, filename)
-                rarc.extract(filepath, os.path.dirname(filepath))
-                rarc_extracted += 1
-                raise_if_canceled()
-        if args.extender_cup:
-            cup2d_filepath = os.path.join(scenedata_dirpath, 'cup2d.arc')
-            rarc.extract(cup2d_filepath, scenedata_dirpath)
-            rarc_extracted += 1
-            raise_if_canceled()
-            mram_filepath = os.path.join(files_dirpath, 'MRAM.arc')
-            rarc.extract(mram_filepath, files_dirpath)
-            rarc_extracted += 1
-            raise_if_canceled()
-            mram_dirpath = os.path.join(files_dirpath, 'mram')
-            race2d_filepath = os.path.join(mram_dirpath, 'race2d.arc')
-            rarc.extract(race2d_filepath, mram_dirpath)
-            rarc_extracted += 1
-            raise_if_canceled()
-            awarddata_dirpath = os.path.join(files_dirpath, 'AwardData')
-            award_alltour_filepath = os.path.join(awarddata_dirpath, 'Award_AllTour.arc')
-            rarc.extract(award_alltour_filepath, awarddata_dirpath)
-            rarc_extracted += 1
-            raise_if_canceled()
-            mram_locale_dirpath = os.path.join(files_dirpath, 'MRAM_Locale')
-            mram_locale_filenames = os.listdir(mram_locale_dirpath)
+        with prof.stage('Extract RARC files'):
+            log.info('Extracting RARC files...')
+            RARC_FILENAMES = ('courseselect.arc', 'LANPlay.arc', 'mapselect.arc', 'titleline.arc')
+            files_dirpath = os.path.join(iso_tmp_dir, 'files')
+            scenedata_dirpath = os.path.join(files_dirpath, 'SceneData')
+            scenedata_filenames = os.listdir(scenedata_dirpath)
+            jobs = max(1, args.jobs or 1)
+
+            # Archives are independent of each other, and are extracted in batches, except for
+            # `race2d.arc`, which is nested in `MRAM.arc`.
+            extraction_batch = []
+            nested_extraction_batch = []
             for language in LANGUAGES:
-                if language not in mram_locale_filenames:
+                if language not in scenedata_filenames:
                     continue
-                filepath = os.path.join(mram_locale_dirpath, language, 'MRAMLoc.arc')
-                rarc.extract(filepath, os.path.dirname(filepath))
-                rarc_extracted += 1
-                raise_if_canceled()
-        log.info(f'{rarc_extracted} files extracted.')
+                for filename in RARC_FILENAMES:
+                    filepath = os.path.join(scenedata_dirpath, language, filename)
+                    extraction_batch.append((filepath, os.path.dirname(filepath)))
+            if args.extender_cup:
+                cup2d_filepath = os.path.join(scenedata_dirpath, 'cup2d.arc')
+                extraction_batch.append((cup2d_filepath, scenedata_dirpath))
+                mram_filepath = os.path.join(files_dirpath, 'MRAM.arc')
+                extraction_batch.append((mram_filepath, files_dirpath))
+                mram_dirpath = os.path.join(files_dirpath, 'mram')
+                race2d_filepath = os.path.join(mram_dirpath, 'race2d.arc')
+                nested_extraction_batch.append((race2d_filepath, mram_dirpath))
+                awarddata_dirpath = os.path.join(files_dirpath, 'AwardData')
+                award_alltour_filepath = os.path.join(awarddata_dirpath, 'Award_AllTour.arc')
+                extraction_batch.append((award_alltour_filepath, awarddata_dirpath))
+                mram_locale_dirpath = os.path.join(files_dirpath, 'MRAM_Locale')
+                mram_locale_filenames = os.listdir(mram_locale_dirpath)
+                for language in LANGUAGES:
+                    if language not in mram_locale_filenames:
+                        continue
+                    filepath = os.path.join(mram_locale_dirpath, language, 'MRAMLoc.arc')
+                    extraction_batch.append((filepath, os.path.dirname(filepath)))
+            rarc_extracted = 0
+            for batch in (extraction_batch, nested_extraction_batch):
+                for _filepath, _dirpath in run_in_process_pool(rarc.extract, batch, jobs,
+                                                               raise_if_canceled):
+                    rarc_extracted += 1
+            log.info(f'{rarc_extracted} files extracted.')
 
         raise_if_canceled()
 
         if not args.skip_banner:
-            patch_bnr_file(iso_tmp_dir)
+            with prof.stage('Patch banner'):
+                patch_bnr_file(iso_tmp_dir)
 
         raise_if_canceled()
 
-        (
-            replaces_data,
-            minimap_data,
-            tilt_setting_data,
-            alternative_audio_data,
-            matching_audio_override_data,
-            added_course_names,
-            battle_stages_enabled,
-        ) = meld_courses(args, raise_if_canceled, iso_tmp_dir)
+        with prof.stage('Meld courses'):
+            (
+                replaces_data,
+                minimap_data,
+                tilt_setting_data,
+                section_count_data,
+                alternative_audio_data,
+                matching_audio_override_data,
+                added_course_names,
+                battle_stages_enabled,
+            ) = meld_courses(args, raise_if_canceled, iso_tmp_dir, prof,
+                             stock_audio_tracks_checksums)
 
         raise_if_canceled()
 
         if not args.skip_menu_titles:
-            patch_title_lines(bool(args.use_alternative_buttons), battle_stages_enabled,
-                              iso_tmp_dir)
+            with prof.stage('Patch title lines'):
+                patch_title_lines(bool(args.use_alternative_buttons), battle_stages_enabled,
+                                  iso_tmp_dir)
 
         raise_if_canceled()
 
         page_count = len(added_course_names) // (RACE_AND_BATTLE_COURSE_COUNT
                                                  if battle_stages_enabled else RACE_TRACK_COUNT) + 1
-        patch_cup_names(args, page_count, iso_tmp_dir)
+        with prof.stage('Patch cup names'):
+            patch_cup_names(args, page_count, iso_tmp_dir)
 
         raise_if_canceled()
 
-        patch_dol_file(args, replaces_data, minimap_data, tilt_setting_data, alternative_audio_data,
-                       matching_audio_override_data, battle_stages_enabled, iso_tmp_dir)
+        with prof.stage('Patch DOL file'):
+            patch_dol_file(args, replaces_data, minimap_data, tilt_setting_data,
+                           section_count_data, alternative_audio_data, matching_audio_override_data,
+                           battle_stages_enabled, iso_tmp_dir, unextracted_filepaths)
 
         raise_if_canceled()
 
         # Re-pack RARC files, and erase directories.
-        log.info('Packing RARC files...')
-        rarc_packed = 0
-        if args.extender_cup:
+        with prof.stage('Pack RARC files'):
+            log.info('Packing RARC files...')
+            # As with the extraction, archives are packed in batches. `MRAM.arc` can only be packed
+            # once the nested `race2d.arc` has been packed (and its directory removed).
+            packing_batch = []
+            nesting_packing_batch = []
+            if args.extender_cup:
+                for language in LANGUAGES:
+                    if language not in mram_locale_filenames:
+                        continue
+                    filepath = os.path.join(mram_locale_dirpath, language, 'MRAMLoc.arc')
+                    dirpath = os.path.join(mram_locale_dirpath, language, 'mramloc')
+                    packing_batch.append((dirpath, filepath))
+                award_alltour_dirpath = os.path.join(awarddata_dirpath, 'award_alltour')
+                packing_batch.append((award_alltour_dirpath, award_alltour_filepath))
+                race2d_dirpath = os.path.join(mram_dirpath, 'mram_race2d')
+                packing_batch.append((race2d_dirpath, race2d_filepath))
+                nesting_packing_batch.append((mram_dirpath, mram_filepath))
+                cup2d_dirpath = os.path.join(scenedata_dirpath, 'cup2d')
+                packing_batch.append((cup2d_dirpath, cup2d_filepath))
             for language in LANGUAGES:
-                if language not in mram_locale_filenames:
+                if language not in scenedata_filenames:
                     continue
-                filepath = os.path.join(mram_locale_dirpath, language, 'MRAMLoc.arc')
-                dirpath = os.path.join(mram_locale_dirpath, language, 'mramloc')
-                rarc.pack(dirpath, filepath)
-                shutil.rmtree(dirpath)
-                rarc_packed += 1
-                raise_if_canceled()
-            award_alltour_dirpath = os.path.join(awarddata_dirpath, 'award_alltour')
-            rarc.pack(award_alltour_dirpath, award_alltour_filepath)
-            shutil.rmtree(award_alltour_dirpath)
-            rarc_packed += 1
-            raise_if_canceled()
-            race2d_dirpath = os.path.join(mram_dirpath, 'mram_race2d')
-            rarc.pack(race2d_dirpath, race2d_filepath)
-            shutil.rmtree(race2d_dirpath)
-            rarc_packed += 1
-            raise_if_canceled()
-            rarc.pack(mram_dirpath, mram_filepath)
-            shutil.rmtree(mram_dirpath)
-            rarc_packed += 1
-            raise_if_canceled()
-            cup2d_dirpath = os.path.join(scenedata_dirpath, 'cup2d')
-            rarc.pack(cup2d_dirpath, cup2d_filepath)
-            shutil.rmtree(cup2d_dirpath)
-            rarc_packed += 1
-            raise_if_canceled()
-        for language in LANGUAGES:
-            if language not in scenedata_filenames:
-                continue
-            for filename in RARC_FILENAMES:
-                filepath = os.path.join(scenedata_dirpath, language, filename)
-                dirname = os.path.splitext(filename)[0].lower()
-                dirpath = os.path.join(scenedata_dirpath, language, dirname)
-                rarc.pack(dirpath, filepath)
-                shutil.rmtree(dirpath)
-                rarc_packed += 1
-                raise_if_canceled()
-        log.info(f'{rarc_packed} files packed.')
+                for filename in RARC_FILENAMES:
+                    filepath = os.path.join(scenedata_dirpath, language, filename)
+                    dirname = os.path.splitext(filename)[0].lower()
+                    dirpath = os.path.join(scenedata_dirpath, language, dirname)
+                    packing_batch.append((dirpath, filepath))
+            rarc_packed = 0
+            for batch in (packing_batch, nesting_packing_batch):
+                for dirpath, _filepath in run_in_process_pool(rarc.pack, batch, jobs,
+                                                              raise_if_canceled):
+                    shutil.rmtree(dirpath)
+                    rarc_packed += 1
+            log.info(f'{rarc_packed} files packed.')
 
         raise_if_canceled()
 
@@ -3128,92 +3928,102 @@ def extend_game(args: argparse.Namespace, raise_if_canceled: callable = lambda:
 
         raise_if_canceled()
 
-        if args.remove_movie_trailer:
-            shutil.rmtree(os.path.join(iso_tmp_dir, 'files', 'Movie'))
-
-        raise_if_canceled()
-
         # Generate description file.
         if args.add_description_file:
             write_description_file(args, added_course_names, battle_stages_enabled, iso_tmp_dir)
 
         raise_if_canceled()
 
-        # Cross-check which files have been added, and then import all files from disk. While it
-        # could be more efficient to compare timestamps and import only the ones that have really
-        # changed, the truth is that the ISO image is going to be written straight away, and every
-        # file will have to be read regardless.
-        log.info('Preparing ISO image...')
-        final_file_list = build_file_list(iso_tmp_dir)
-        # Also drop from the list those directories and files that no longer exist in the image.
-        for path in initial_file_list:
-            if path not in final_file_list:
-                dir_entry = gcm_file.dirs_by_path_lowercase.get(path.lower())
-                if dir_entry is not None:
-                    gcm_file.delete_directory(dir_entry)
-                    continue
-                file_entry = gcm_file.files_by_path_lowercase.get(path.lower())
-                if file_entry is not None:
-                    gcm_file.delete_file(file_entry)
-        for path in final_file_list:
-            if path not in initial_file_list:
-                if os.path.isfile(os.path.join(iso_tmp_dir, path)):
-                    gcm_file.add_new_file(path)
-                else:
-                    gcm_file.add_new_directory(path)
-        gcm_file.import_all_files_from_disk(iso_tmp_dir)
-        log.info('ISO image prepared.')
+        # Cross-check which files have been added, and then overlay all files from disk. Files are
+        # not read into memory: those that are still untouched (even if renamed or linked) will be
+        # copied straight from the input ISO image, and the rest streamed from disk.
+        with prof.stage('Prepare ISO image'):
+            log.info('Preparing ISO image...')
+            final_file_list = build_file_list(iso_tmp_dir, unextracted_filepaths)
+            # Also drop from the list those directories and files that no longer exist in the image.
+            for path in initial_file_list:
+                if path not in final_file_list:
+                    dir_entry = gcm_file.dirs_by_path_lowercase.get(path.lower())
+                    if dir_entry is not None:
+                        gcm_file.delete_directory(dir_entry)
+                        continue
+                    file_entry = gcm_file.files_by_path_lowercase.get(path.lower())
+                    if file_entry is not None:
+                        gcm_file.delete_file(file_entry)
+            for path in final_file_list:
+                if path not in initial_file_list:
+                    if os.path.isfile(os.path.join(iso_tmp_dir, path)):
+                        gcm_file.add_new_file(path)
+                    else:
+                        gcm_file.add_new_directory(path)
+            gcm_file.overlay_all_files_from_disk(iso_tmp_dir)
+            log.info('ISO image prepared.')
 
         raise_if_canceled()
 
         # It is paramount that the file list is sorted in the same order that has been used to
         # compute file indexes of the AST files in the Stream folder. Stock ISO files are sorted in
         # the correct order, but modified ISO files may have AST files in a different order.
-        log.info('Sorting file list in asciibetical order...')
-        gcm_file.file_entries = sorted(gcm_file.file_entries, key=lambda e: e.file_path.lower())
-        for file_entry in gcm_file.file_entries:
-            if hasattr(file_entry, 'children'):
-                file_entry.children = sorted(file_entry.children, key=lambda e: e.file_path.lower())
-        gcm_file.files_by_path = {
-            k: gcm_file.files_by_path[k]
-            for k in sorted(gcm_file.files_by_path.keys(), key=str.lower)
-        }
-        gcm_file.files_by_path_lowercase = {
-            k: gcm_file.files_by_path_lowercase[k]
-            for k in sorted(gcm_file.files_by_path_lowercase.keys())
-        }
-        gcm_file.changed_files = {
-            k: gcm_file.changed_files[k]
-            for k in sorted(gcm_file.changed_files.keys(), key=str.lower)
-        }
-        gcm_file.dirs_by_path = {
-            k: gcm_file.dirs_by_path[k]
-            for k in sorted(gcm_file.dirs_by_path.keys(), key=str.lower)
-        }
-        gcm_file.dirs_by_path_lowercase = {
-            k: gcm_file.dirs_by_path_lowercase[k]
-            for k in sorted(gcm_file.dirs_by_path_lowercase.keys())
-        }
+        with prof.stage('Sort file list'):
+            log.info('Sorting file list in asciibetical order...')
+            gcm_file.file_entries = sorted(gcm_file.file_entries, key=lambda e: e.file_path.lower())
+            for file_entry in gcm_file.file_entries:
+                if hasattr(file_entry, 'children'):
+                    file_entry.children = sorted(file_entry.children,
+                                                 key=lambda e: e.file_path.lower())
+            gcm_file.files_by_path = {
+                k: gcm_file.files_by_path[k]
+                for k in sorted(gcm_file.files_by_path.keys(), key=str.lower)
+            }
+            gcm_file.files_by_path_lowercase = {
+                k: gcm_file.files_by_path_lowercase[k]
+                for k in sorted(gcm_file.files_by_path_lowercase.keys())
+            }
+            gcm_file.changed_files = {
+                k: gcm_file.changed_files[k]
+                for k in sorted(gcm_file.changed_files.keys(), key=str.lower)
+            }
+            gcm_file.dirs_by_path = {
+                k: gcm_file.dirs_by_path[k]
+                for k in sorted(gcm_file.dirs_by_path.keys(), key=str.lower)
+            }
+            gcm_file.dirs_by_path_lowercase = {
+                k: gcm_file.dirs_by_path_lowercase[k]
+                for k in sorted(gcm_file.dirs_by_path_lowercase.keys())
+            }
 
         raise_if_canceled()
 
-        # Write the extended ISO file to the final location.
-        log.info(f'Writing extended ISO image to "{args.output}"...')
-        try:
-            files_written = 0
-            for _filepath, files_done in gcm_file.export_disc_to_iso_with_changed_files(
-                    args.output):
-                if files_done > 0:
-                    files_written = files_done
-                raise_if_canceled()
-        except gcm.MaxFileSizeError as e:
-            raise MKDDExtenderError(
-                f'ISO file is larger than the absolute maximum file size ({EXTREME_MAX_ISO_SIZE} '
-                'bytes). Possible solutions: remove some audio tracks, downsample audio tracks, or '
-                'remove some custom courses.') from e
-        iso_size = os.path.getsize(args.output)
-        human_readable_iso_size = round(os.path.getsize(args.output) / 1024.0 / 1024.0)
-        log.info(f'ISO image written ({files_written} files - {human_readable_iso_size} MiB).')
+        # Write the extended ISO file (or the delta patch against the input ISO file) to the final
+        # location.
+        delta = args.output_format == 'delta'
+        with prof.stage('Write ISO image', delta=delta):
+            if delta:
+                log.info(f'Writing extended ISO image as delta patch to "{args.output}"...')
+            else:
+                log.info(f'Writing extended ISO image to "{args.output}"...')
+            try:
+                files_written = 0
+                for _filepath, files_done in gcm_file.export_disc_to_iso_with_changed_files(
+                        args.output, delta):
+                    if files_done > 0:
+                        files_written = files_done
+                    raise_if_canceled()
+            except gcm.MaxFileSizeError as e:
+                raise MKDDExtenderError(
+                    'ISO file is larger than the absolute maximum file size '
+                    f'({EXTREME_MAX_ISO_SIZE} bytes). Possible solutions: remove some audio '
+                    'tracks, downsample audio tracks, or remove some custom courses.') from e
+            iso_size = gcm_file.exported_iso_size
+            human_readable_iso_size = round(iso_size / 1024.0 / 1024.0)
+            if delta:
+                human_readable_patch_size = round(os.path.getsize(args.output) / 1024.0 / 1024.0)
+                log.info(f'Delta patch written ({files_written} files - '
+                         f'{human_readable_iso_size} MiB ISO image - '
+                         f'{human_readable_patch_size} MiB patch).')
+            else:
+                log.info(f'ISO image written ({files_written} files - '
+                         f'{human_readable_iso_size} MiB).')
 
         raise_if_canceled()
 
@@ -3233,6 +4043,10 @@ def extend_game(args: argparse.Namespace, raise_if_canceled: callable = lambda:
 
 
 def main():
+    # Required in frozen bundles, where processes that are spawned for the process pools (see
+    # `run_in_process_pool()`) run the same executable.
+    multiprocessing.freeze_support()
+
     clean_stale_temp_dirs()
 
     # When no arguments are provided, the application will be launched in GUI mode. On Windows, if
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Module that includes a lightweight profiler for measuring the stages of a long-running process.
+
+Each stage records its wall time, its CPU time, the peak resident set size of the process, and the
+number of bytes read and written. Stages can be nested, and can be recorded concurrently from
+multiple threads.
+
+The recorded stages can be written as a JSON report, or in the Trace Event Format, which can be
+loaded in `chrome://tracing` or in https://ui.perfetto.dev:
+- https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OE2kcGyEdwy8rbSNLQtl75s/
+"""
+import contextlib
+import json
+import os
+import platform
+import threading
+import time
+
+try:
+    import resource
+    _RESOURCE_AVAILABLE = True
+except ImportError:
+    _RESOURCE_AVAILABLE = False
+
+REPORT_FORMATS = ('json', 'chrome-trace')
+
+# `ru_maxrss` is given in kibibytes in Linux, but in bytes in macOS.
+_MAXRSS_UNIT = 1 if platform.system() == 'Darwin' else 1024
+
+
+def _read_io_counters(per_thread: bool) -> 'tuple[int, int] | None':
+    """
+    Returns the number of bytes read and written (including reads and writes that were served from
+    the page cache) by the calling thread or by the process, or `None` where the counters are not
+    available (i.e. outside of Linux).
+    """
+    try:
+        with open('/proc/thread-self/io' if per_thread else '/proc/self/io', 'rb') as f:
+            counters = dict(line.split(b':', 1) for line in f.read().splitlines())
+        return int(counters[b'rchar']), int(counters[b'wchar'])
+    except (OSError, KeyError, ValueError):
+        return None
+
+
+def _read_peak_rss() -> 'tuple[int, int] | tuple[None, None]':
+    """
+    Returns the peak resident set size (in bytes) of the process and of the largest of its
+    terminated child processes.
+    """
+    if not _RESOURCE_AVAILABLE:
+        return None, None
+    self_usage = resource.getrusage(resource.RUSAGE_SELF)
+    children_usage = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return self_usage.ru_maxrss * _MAXRSS_UNIT, children_usage.ru_maxrss * _MAXRSS_UNIT
+
+
+def _read_children_cpu_time() -> float:
+    # Only available in Unix; in Windows, the values are always zero.
+    times = os.times()
+    return times.children_user + times.children_system
+
+
+def _difference(end: 'int | None', start: 'int | None') -> 'int | None':
+    return None if end is None or start is None else end - start
+
+
+class Profiler():
+    """
+    Records the stages that are entered through `stage()`. When the profiler is not enabled, stages
+    are not measured, and the overhead is negligible.
+    """
+
+    def __init__(self, enabled: bool = True):
+        self.enabled = enabled
+        self._lock = threading.Lock()
+        self._start_time = time.perf_counter()
+        self._stages = []
+
+    @contextlib.contextmanager
+    def stage(self, name: str, category: str = 'stage', per_thread: bool = False, **args):
+        """
+        Measures the code that runs in the context as a stage with the given name.
+
+        If `per_thread` is true, the CPU time and the I/O counters are those of the calling thread,
+        which is required for stages that run concurrently in a thread pool; the CPU time of child
+        processes cannot be attributed to a thread, and is therefore not measured. Otherwise, the
+        counters are those of the whole process. The peak resident set size is always that of the
+        process.
+
+        Any extra keyword argument is stored along with the stage. The dictionary of arguments is
+        yielded, so that the code in the context can add to it.
+        """
+        if not self.enabled:
+            yield args
+            return
+
+        read_cpu_time = time.thread_time if per_thread else time.process_time
+        start_io_counters = _read_io_counters(per_thread) or (None, None)
+        start_children_cpu_time = None if per_thread else _read_children_cpu_time()
+        start_cpu_time = read_cpu_time()
+        start_time = time.perf_counter()
+        try:
+            yield args
+        finally:
+            end_time = time.perf_counter()
+            end_cpu_time = read_cpu_time()
+            end_children_cpu_time = None if per_thread else _read_children_cpu_time()
+            end_io_counters = _read_io_counters(per_thread) or (None, None)
+            peak_rss, children_peak_rss = _read_peak_rss()
+
+            thread = threading.current_thread()
+            stage = {
+                'name': name,
+                'category': category,
+                'thread_id': threading.get_native_id(),
+                'thread_name': thread.name,
+                'start_time': start_time - self._start_time,
+                'wall_time': end_time - start_time,
+                'cpu_time': end_cpu_time - start_cpu_time,
+                'children_cpu_time': _difference(end_children_cpu_time, start_children_cpu_time),
+                'peak_rss': peak_rss,
+                'children_peak_rss': children_peak_rss,
+                'bytes_read': _difference(end_io_counters[0], start_io_counters[0]),
+                'bytes_written': _difference(end_io_counters[1], start_io_counters[1]),
+                'per_thread': per_thread,
+                'args': args,
+            }
+            with self._lock:
+                self._stages.append(stage)
+
+    def stages(self) -> 'list[dict]':
+        """
+        Returns the recorded stages, sorted by start time.
+        """
+        with self._lock:
+            return sorted(self._stages, key=lambda stage: stage['start_time'])
+
+    def report(self) -> dict:
+        peak_rss, children_peak_rss = _read_peak_rss()
+        return {
+            'wall_time': time.perf_counter() - self._start_time,
+            'peak_rss': peak_rss,
+            'children_peak_rss': children_peak_rss,
+            'stages': self.stages(),
+        }
+
+    def chrome_trace(self) -> dict:
+        """
+        Returns the recorded stages as complete events in the Trace Event Format. Timestamps and
+        durations are given in microseconds.
+        """
+        pid = os.getpid()
+        events = []
+        thread_names = {}
+        for stage in self.stages():
+            thread_names[stage['thread_id']] = stage['thread_name']
+            event_args = {
+                key: value
+                for key, value in stage.items()
+                if key not in ('name', 'category', 'thread_id', 'thread_name', 'start_time',
+                               'wall_time', 'args') and value is not None
+            }
+            event_args.update(stage['args'])
+            events.append({
+                'name': stage['name'],
+                'cat': stage['category'],
+                'ph': 'X',
+                'ts': round(stage['start_time'] * 1e6),
+                'dur': round(stage['wall_time'] * 1e6),
+                'pid': pid,
+                'tid': stage['thread_id'],
+                'args': event_args,
+            })
+        for thread_id, thread_name in thread_names.items():
+            events.append({
+                'name': 'thread_name',
+                'ph': 'M',
+                'pid': pid,
+                'tid': thread_id,
+                'args': {
+                    'name': thread_name
+                },
+            })
+        return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+    def write(self, filepath: str, report_format: str):
+        assert report_format in REPORT_FORMATS, f'Unknown report format: "{report_format}".'
+        data = self.report() if report_format == 'json' else self.chrome_trace()
+        with open(filepath, 'w', encoding='utf-8') as f:
+            json.dump(data, f, indent=4)
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the `profiler` module.
+"""
+import concurrent.futures
+import json
+import os
+import sys
+import tempfile
+
+import pytest
+
+import profiler
+
+
+def _write_and_read(filepath: str, size: int):
+    with open(filepath, 'wb') as f:
+        f.write(b'\0' * size)
+    with open(filepath, 'rb') as f:
+        f.read()
+
+
+def test_stages():
+    prof = profiler.Profiler()
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        with prof.stage('outer', value=1) as stage_args:
+            stage_args['extra'] = 2
+            with prof.stage('inner', 'slot'):
+                _write_and_read(os.path.join(tmp_dir, 'file'), 10000)
+
+    inner_stage, outer_stage = prof.stages()[::-1]
+    assert outer_stage['name'] == 'outer'
+    assert outer_stage['category'] == 'stage'
+    assert outer_stage['args'] == {'value': 1, 'extra': 2}
+    assert inner_stage['name'] == 'inner'
+    assert inner_stage['category'] == 'slot'
+    assert inner_stage['args'] == {}
+
+    # The inner stage is nested in the outer stage.
+    assert outer_stage['start_time'] <= inner_stage['start_time']
+    assert (inner_stage['start_time'] + inner_stage['wall_time'] <=
+            outer_stage['start_time'] + outer_stage['wall_time'])
+
+    for stage in (inner_stage, outer_stage):
+        assert stage['wall_time'] >= 0.0
+        assert stage['cpu_time'] >= 0.0
+        if stage['bytes_read'] is not None:
+            assert stage['bytes_read'] >= 10000
+            assert stage['bytes_written'] >= 10000
+
+
+def test_stage_exception():
+    prof = profiler.Profiler()
+
+    with pytest.raises(ValueError):
+        with prof.stage('failing'):
+            raise ValueError()
+
+    assert [stage['name'] for stage in prof.stages()] == ['failing']
+
+
+def test_disabled():
+    prof = profiler.Profiler(enabled=False)
+
+    with prof.stage('stage', value=1) as stage_args:
+        assert stage_args == {'value': 1}
+
+    assert not prof.stages()
+    assert not prof.chrome_trace()['traceEvents']
+
+
+def test_per_thread_stages():
+    prof = profiler.Profiler()
+
+    def work(index: int):
+        with prof.stage(f'slot {index}', 'slot', per_thread=True):
+            return sum(range(index * 1000))
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=4) as executor:
+        list(executor.map(work, range(16)))
+
+    stages = prof.stages()
+    assert sorted(stage['name'] for stage in stages) == sorted(f'slot {i}' for i in range(16))
+    for stage in stages:
+        assert stage['per_thread']
+        assert stage['children_cpu_time'] is None
+
+
+def test_write():
+    prof = profiler.Profiler()
+
+    with prof.stage('outer'):
+        with prof.stage('inner', value=1):
+            pass
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        filepath = os.path.join(tmp_dir, 'report.json')
+
+        prof.write(filepath, 'json')
+        with open(filepath, 'r', encoding='utf-8') as f:
+            report = json.load(f)
+        assert [stage['name'] for stage in report['stages']] == ['outer', 'inner']
+        assert report['wall_time'] >= report['stages'][0]['wall_time']
+
+        prof.write(filepath, 'chrome-trace')
+        with open(filepath, 'r', encoding='utf-8') as f:
+            trace = json.load(f)
+        events = [event for event in trace['traceEvents'] if event['ph'] == 'X']
+        assert [event['name'] for event in events] == ['outer', 'inner']
+        assert events[1]['args']['value'] == 1
+        assert all(isinstance(event['ts'], int) and event['dur'] >= 0 for event in events)
+        metadata_events = [event for event in trace['traceEvents'] if event['ph'] == 'M']
+        assert [event['args']['name'] for event in metadata_events] == ['MainThread']
+
+
+if __name__ == '__main__':
+    sys.exit(pytest.main(sys.argv))
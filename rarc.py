@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 """
-Module that includes functions for extracting and packing RARC files.
+Module that includes functions for extracting and packing RARC files, and for reading and writing
+them in memory.
 
 Details of the RARC format:
 - https://kuribo64.net/wiki/?page=RARC
@@ -13,8 +14,14 @@ directory, and one for the output directory or output file.
 
 If the input path is a file, an extraction operation will be assumed. If the input path is a
 directory, a packing operation will be assumed.
+
+Yaz0 compression is implemented in pure Python, and is slow; it is only available on request (the
+`--compress` flag, or `compress=True` in `pack()`). MKDD Extender does not compress the archives
+that it packs, so the size of the generated ISO file is not affected; it only benefits from the
+faster decompression when reading compressed archives.
 """
 import argparse
+import io
 import os
 import platform
 import struct
@@ -68,72 +75,190 @@ def _is_compressed(data: memoryview) -> bool:
     return data[:len(__MAGIC_COMPRESSED)] == __MAGIC_COMPRESSED
 
 
+def __build_literal_run_lengths() -> 'tuple[int]':
+    # For each possible value of a group head, the number of consecutive set bits from the most
+    # significant bit (i.e. the number of literal bytes that come next in the group).
+    run_lengths = []
+    for group_head in range(256):
+        run_length = 0
+        while run_length < 8 and group_head & (0x80 >> run_length):
+            run_length += 1
+        run_lengths.append(run_length)
+    return tuple(run_lengths)
+
+
+__LITERAL_RUN_LENGTHS = __build_literal_run_lengths()
+
+__YAZ0_HEADER_SIZE = 16
+__YAZ0_MAX_DISTANCE = 0x1000
+__YAZ0_MIN_LENGTH = 3
+__YAZ0_MAX_LENGTH = 0x111
+__YAZ0_MAX_CANDIDATES = 16
+
+
 def _decompress(data: memoryview) -> memoryview:
     uncompressed_data_size = struct.unpack('>L', data[4:8])[0]
-    uncompressed_data = bytearray(b'\x00') * uncompressed_data_size
-    uncompressed_data_view = memoryview(uncompressed_data)
+    uncompressed_data = bytearray()
 
-    data = data[16:]  # Skip magic number, size, and reserved data.
+    data = bytes(data[__YAZ0_HEADER_SIZE:])  # Skip magic number, size, and reserved data.
     data_size = len(data)
+    literal_run_lengths = __LITERAL_RUN_LENGTHS
 
     read_data = 0
     written_data = 0
 
-    group_head = 0
-    group_head_len = 0
-
     while read_data < data_size and written_data < uncompressed_data_size:
-        if not group_head_len:
-            group_head = data[read_data]
-            read_data += 1
-            group_head_len = 8
-
-        group_head_len -= 1
-        if group_head & 0x80:
-            uncompressed_data[written_data] = data[read_data]
-            read_data += 1
-            written_data += 1
-        else:
-            b1, b2 = data[read_data:read_data + 2]
-            read_data += 2
-
-            temp_index = written_data - ((b1 & 0x0f) << 8 | b2) - 1
+        group_head = data[read_data]
+        read_data += 1
+        group_head_len = 8
+
+        while group_head_len and written_data < uncompressed_data_size:
+            # Consecutive literal bytes are copied in a single slice.
+            run_length = literal_run_lengths[group_head]
+            if run_length:
+                run_length = min(run_length, group_head_len, uncompressed_data_size - written_data)
+                uncompressed_data += data[read_data:read_data + run_length]
+                read_data += run_length
+                written_data += run_length
+                group_head = (group_head << run_length) & 0xFF
+                group_head_len -= run_length
+                continue
 
+            b1 = data[read_data]
+            distance = ((b1 & 0x0f) << 8 | data[read_data + 1]) + 1
             n = b1 >> 4
-            if not n:
-                n = data[read_data] + 0x12
-                read_data += 1
-            else:
+            if n:
                 n += 2
+                read_data += 2
+            else:
+                n = data[read_data + 2] + 0x12
+                read_data += 3
+
+            start = written_data - distance
+            if start < 0:
+                raise ValueError('Invalid back-reference in Yaz0 data.')
+            if distance >= n:
+                uncompressed_data += uncompressed_data[start:start + n]
+            else:
+                # When the ranges overlap, the last `distance` bytes repeat as a pattern.
+                pattern = uncompressed_data[start:]
+                uncompressed_data += (pattern * (n // distance + 1))[:n]
+            written_data += n
+
+            group_head = (group_head << 1) & 0xFF
+            group_head_len -= 1
 
-            assert 3 <= n <= 0x111
-            assert written_data + n < uncompressed_data_size
+    assert written_data == uncompressed_data_size
 
-            overlap = ((written_data <= temp_index < written_data + n)
-                       or (temp_index <= written_data < temp_index + n))
+    return memoryview(uncompressed_data)
 
-            if overlap:
-                # When the ranges overlap (~1.5% of the times in test subject), bytes will be copied
-                # one by one.
-                while n > 0:
-                    n -= 1
-                    uncompressed_data[written_data] = uncompressed_data[temp_index]
-                    temp_index += 1
-                    written_data += 1
+
+def __find_longest_match(data: bytes, position: int) -> 'tuple[int, int]':
+    data_size = len(data)
+    max_length = min(__YAZ0_MAX_LENGTH, data_size - position)
+    if max_length < __YAZ0_MIN_LENGTH:
+        return 0, 0
+
+    window_start = max(0, position - __YAZ0_MAX_DISTANCE)
+    prefix = data[position:position + __YAZ0_MIN_LENGTH]
+
+    best_length = 0
+    best_distance = 0
+
+    # Candidates are visited from the nearest to the farthest. The search end is extended so that
+    # matches that overlap the current position are also found.
+    search_end = position + __YAZ0_MIN_LENGTH - 1
+    for _ in range(__YAZ0_MAX_CANDIDATES):
+        candidate = data.rfind(prefix, window_start, search_end)
+        if candidate < 0:
+            break
+        search_end = candidate + __YAZ0_MIN_LENGTH - 1
+
+        # Extend the match in chunks, halving the chunk size on mismatch.
+        length = __YAZ0_MIN_LENGTH
+        step = max_length - length
+        while step:
+            if (length + step <= max_length and data[candidate + length:candidate + length + step]
+                    == data[position + length:position + length + step]):
+                length += step
             else:
-                chunk = uncompressed_data_view[temp_index:temp_index + n]
-                uncompressed_data[written_data:written_data + n] = chunk
-                written_data += n
+                step //= 2
 
-        group_head = group_head << 1
+        if length > best_length:
+            best_length = length
+            best_distance = position - candidate
+            if length == max_length:
+                break
 
-    return uncompressed_data_view
+    return best_length, best_distance
 
 
-def extract(src_filepath: str, dst_dirpath: str):
-    # Read all file into nearby memory.
+def _compress(data: bytes) -> bytes:
+    # Greedy encoder. In pure Python, it is more than an order of magnitude slower than
+    # decompression (well under 1 MB/s), which is why it is not used in MKDD Extender.
+    data = bytes(data)
+    data_size = len(data)
+
+    compressed_data = bytearray(__MAGIC_COMPRESSED)
+    compressed_data += struct.pack('>L', data_size)
+    compressed_data += b'\x00' * (__YAZ0_HEADER_SIZE - len(compressed_data))
+
+    position = 0
+    while position < data_size:
+        group_head_offset = len(compressed_data)
+        compressed_data.append(0)
+        group_head = 0
+
+        for i in range(8):
+            if position >= data_size:
+                break
+
+            length, distance = __find_longest_match(data, position)
+            if length < __YAZ0_MIN_LENGTH:
+                group_head |= 0x80 >> i
+                compressed_data.append(data[position])
+                position += 1
+                continue
+
+            distance -= 1
+            if length < 0x12:
+                compressed_data.append((length - 2) << 4 | distance >> 8)
+                compressed_data.append(distance & 0xFF)
+            else:
+                compressed_data.append(distance >> 8)
+                compressed_data.append(distance & 0xFF)
+                compressed_data.append(length - 0x12)
+            position += length
+
+        compressed_data[group_head_offset] = group_head
+
+    return bytes(compressed_data)
+
+
+class Directory:
+    """
+    In-memory representation of a directory in a RARC archive.
+
+    Files are mapped by name to bytes-like objects, which can be modified in place or replaced.
+    Subdirectories are mapped by name to other `Directory` instances.
+    """
+
+    def __init__(self, name: str):
+        self.name = name
+        self.files = {}
+        self.dirs = {}
+
+
+def read(src_filepath: str) -> Directory:
+    """
+    Reads a RARC archive into memory, and returns its root directory.
+
+    File data is exposed as writable memoryview slices of the (decompressed) archive.
+    """
+    # Read all file into nearby memory. A mutable buffer is used so that the file entries can be
+    # modified in place.
     with open(src_filepath, 'rb') as f:
-        data = memoryview(f.read())
+        data = memoryview(bytearray(f.read()))
 
     if _is_compressed(data):
         data = _decompress(data)
@@ -323,46 +448,73 @@ def extract(src_filepath: str, dst_dirpath: str):
 
             entries.append((entry_type, name, node_index))
 
-    # Iteratively create directories and their files (breadth-first search).
-    pending_nodes = [(nodes[0], dst_dirpath)]
-    visited_nodes = set()
-    while pending_nodes:
-        node, parent_dirpath = pending_nodes.pop(0)
-        visited_nodes.add(node)
+    # Build the directory tree (breadth-first search).
+    directories = [Directory(name.decode('ascii')) for name, _child_count, _first in nodes]
+    pending_node_indices = [0]
+    visited_node_indices = {0}
+    while pending_node_indices:
+        node_index = pending_node_indices.pop(0)
+        directory = directories[node_index]
 
-        dirname, child_count, first_child_index = node
-
-        current_dirpath = os.path.join(parent_dirpath, dirname.decode('ascii'))
-        os.makedirs(current_dirpath, exist_ok=True)
+        _dirname, child_count, first_child_index = nodes[node_index]
 
         for entry in entries[first_child_index:first_child_index + child_count]:
             entry_type, *args = entry
 
             if entry_type in (__FILE_TYPE, __YAZ0_COMPRESSED_FILE_TYPE):
                 filename, entry_data = args
-
-                with open(os.path.join(current_dirpath, filename.decode('ascii')), 'wb') as f:
-                    f.write(entry_data)
+                directory.files[filename.decode('ascii')] = entry_data
             else:
                 dirname, node_index = args
 
                 if node_index != 0xFFFFFFFF:
-                    node = nodes[node_index]
                     if __debug__:
                         if dirname not in (b'.', b'..'):
-                            assert dirname == node[0]
-                    if node not in visited_nodes:
-                        pending_nodes.append((node, current_dirpath))
+                            assert dirname == nodes[node_index][0]
+                    if node_index not in visited_node_indices:
+                        visited_node_indices.add(node_index)
+                        pending_node_indices.append(node_index)
+                        subdirectory = directories[node_index]
+                        directory.dirs[subdirectory.name] = subdirectory
 
+    return directories[0]
 
-def pack(src_dirpath: str, dst_filepath: str):
-    if not os.path.isdir(src_dirpath):
-        raise ValueError(f'"{src_dirpath}" is not a valid directory.')
 
-    src_dirpath = os.path.normpath(src_dirpath)  # Trailing slashes not wanted.
+def extract(src_filepath: str, dst_dirpath: str):
+    root = read(src_filepath)
+
+    pending_directories = [(root, dst_dirpath)]
+    while pending_directories:
+        directory, parent_dirpath = pending_directories.pop(0)
+
+        current_dirpath = os.path.join(parent_dirpath, directory.name)
+        os.makedirs(current_dirpath, exist_ok=True)
+
+        for filename, entry_data in directory.files.items():
+            with open(os.path.join(current_dirpath, filename), 'wb') as f:
+                f.write(entry_data)
+
+        for subdirectory in directory.dirs.values():
+            pending_directories.append((subdirectory, current_dirpath))
+
+
+def write(root: Directory, dst_filepath: str, compress: bool = False):
+    """
+    Serializes the given directory tree into a RARC archive.
+    """
+    # Directories are visited in a depth-first search (pre-order), in the same order `os.walk()`
+    # would visit them on disk.
+    directories = []
+    pending_directories = [(root, None)]
+    while pending_directories:
+        directory, parent_directory = pending_directories.pop()
+        directories.append((directory, parent_directory))
+        for dirname in sorted(directory.dirs, reverse=True):
+            pending_directories.append((directory.dirs[dirname], directory))
+
+    node_indices = {id(directory): i for i, (directory, _parent) in enumerate(directories)}
 
     nodes = []
-    nodes_indices = {}
     entries = []
 
     string_table_size = 0
@@ -370,7 +522,6 @@ def pack(src_dirpath: str, dst_filepath: str):
     string_list = []
 
     entry_data_section_size = 0
-    entry_data_sizes = []
 
     def register_string(text: str) -> int:
         nonlocal string_table_size
@@ -391,41 +542,41 @@ def pack(src_dirpath: str, dst_filepath: str):
     def aligned(value: int) -> int:
         return (value | __ALIGNMENT - 1) + 1 if value % __ALIGNMENT else value
 
-    for parentpath, dirnames, filenames in os.walk(src_dirpath):
+    for directory, parent_directory in directories:
         # In the known RARC files, files come before directories. However, the order in the known
         # samples is arbitrary. A sorted list is better than a *different* arbitrary order.
         # Besides the arbitrary order, it seems known RARC files process files in directories in
         # a depth-first search, while we are doing breadth-first search.
-        dirnames.sort()
-        filenames = sorted(filenames)
-        dirnames = dirnames + ['.', '..']
+        dirnames = sorted(directory.dirs) + ['.', '..']
+        filenames = sorted(directory.files)
 
-        parentname = os.path.basename(parentpath)
-        string_offset = register_string(parentname)
-        string_hash = __hash_string(parentname.encode('ascii'))
+        string_offset = register_string(directory.name)
+        string_hash = __hash_string(directory.name.encode('ascii'))
         child_count = len(filenames) + len(dirnames)
         first_child_index = len(entries)
 
-        node_index = len(nodes)
-        nodes.append((parentpath, string_offset, string_hash, child_count, first_child_index))
-        nodes_indices[parentpath] = node_index
+        nodes.append((directory.name, string_offset, string_hash, child_count, first_child_index))
 
         for filename in filenames:
-            filepath = os.path.join(parentpath, filename)
+            entry_data = directory.files[filename]
             string_offset = register_string(filename)
             string_hash = __hash_string(filename.encode('ascii'))
-            entry_data_size = os.path.getsize(filepath)
+            entry_data_size = len(entry_data)
             entry_data_offset = entry_data_section_size
             entry_data_section_size = aligned(entry_data_section_size + entry_data_size)
-            entry_data_sizes.append(entry_data_size)
-            entries.append((__FILE_TYPE, filepath, string_offset, string_hash, entry_data_size,
+            entries.append((__FILE_TYPE, entry_data, string_offset, string_hash, entry_data_size,
                             entry_data_offset))
 
         for dirname in dirnames:
-            dirpath = os.path.join(parentpath, dirname)
+            if dirname == '.':
+                node_index = node_indices[id(directory)]
+            elif dirname == '..':
+                node_index = node_indices.get(id(parent_directory), 0xFFFFFFFF)
+            else:
+                node_index = node_indices[id(directory.dirs[dirname])]
             string_offset = register_string(dirname)
             string_hash = __hash_string(dirname.encode('ascii'))
-            entries.append((__DIR_TYPE, dirpath, string_offset, string_hash))
+            entries.append((__DIR_TYPE, node_index, string_offset, string_hash))
 
     string_table_size = aligned(string_table_size)
 
@@ -451,7 +602,7 @@ def pack(src_dirpath: str, dst_filepath: str):
     if os.path.splitdrive(os.path.dirname(dst_filepath))[1]:
         os.makedirs(os.path.dirname(dst_filepath), exist_ok=True)
 
-    with open(dst_filepath, 'wb') as f:
+    with io.BytesIO() as f:
         f.write(__MAGIC)
 
         f.write(
@@ -479,14 +630,12 @@ def pack(src_dirpath: str, dst_filepath: str):
                 0x00000000,
             ))
 
-        dirpath_indices = {}
-
-        for i, (dirpath, string_offset, string_hash, child_count,
+        for i, (dirname, string_offset, string_hash, child_count,
                 first_child_index) in enumerate(nodes):
             if i == 0:
                 identifier = b'ROOT'
             else:
-                dirname = os.path.basename(dirpath).encode('ascii')
+                dirname = dirname.encode('ascii')
                 identifier = dirname[:__ID_SIZE].upper().ljust(__ID_SIZE)
 
             f.write(identifier)
@@ -499,14 +648,12 @@ def pack(src_dirpath: str, dst_filepath: str):
                     first_child_index,
                 ))
 
-            dirpath_indices[dirpath] = i
-
         f.write(b'\x00' * (entry_section_offset - f.tell()))
 
         for i, (entry_type, *args) in enumerate(entries):
             if entry_type == __FILE_TYPE:
                 entry_index = i
-                _filepath, string_offset, string_hash, entry_data_size, entry_data_offset = args
+                _entry_data, string_offset, string_hash, entry_data_size, entry_data_offset = args
 
                 f.write(
                     struct.pack(
@@ -520,10 +667,7 @@ def pack(src_dirpath: str, dst_filepath: str):
                         0x00000000,
                     ))
             else:
-                dirpath, string_offset, string_hash = args
-
-                # Resolve relative paths (`.` and `..``), and check if the directory has been keyed.
-                node_index = dirpath_indices.get(os.path.normpath(dirpath), 0xFFFFFFFF)
+                node_index, string_offset, string_hash = args
 
                 f.write(
                     struct.pack(
@@ -547,13 +691,44 @@ def pack(src_dirpath: str, dst_filepath: str):
         for i, (entry_type, *args) in enumerate(entries):
             if entry_type not in (__FILE_TYPE, __YAZ0_COMPRESSED_FILE_TYPE):
                 continue
-            filepath, _string_offset, _string_hash, entry_data_size, entry_data_offset = args
+            entry_data, _string_offset, _string_hash, entry_data_size, entry_data_offset = args
 
-            with open(filepath, 'rb') as g:
-                f.write(g.read())
+            f.write(entry_data)
 
             f.write(b'\x00' * (aligned(entry_data_size) - entry_data_size))
 
+        data = f.getvalue()
+
+    if compress:
+        data = _compress(data)
+
+    with open(dst_filepath, 'wb') as f:
+        f.write(data)
+
+
+def pack(src_dirpath: str, dst_filepath: str, compress: bool = False):
+    if not os.path.isdir(src_dirpath):
+        raise ValueError(f'"{src_dirpath}" is not a valid directory.')
+
+    src_dirpath = os.path.normpath(src_dirpath)  # Trailing slashes not wanted.
+
+    root = Directory(os.path.basename(src_dirpath))
+    directories = {src_dirpath: root}
+
+    for parentpath, dirnames, filenames in os.walk(src_dirpath):
+        directory = directories[parentpath]
+
+        for dirname in dirnames:
+            subdirectory = Directory(dirname)
+            directory.dirs[dirname] = subdirectory
+            directories[os.path.join(parentpath, dirname)] = subdirectory
+
+        for filename in filenames:
+            with open(os.path.join(parentpath, filename), 'rb') as f:
+                directory.files[filename] = f.read()
+
+    write(root, dst_filepath, compress)
+
 
 def main():
     logging.basicConfig(format='%(asctime)s %(levelname)-8s %(message)s',
@@ -567,13 +742,17 @@ def main():
     parser.add_argument('output',
                         type=str,
                         help='Path to the file or directory that is to be written.')
+    parser.add_argument('--compress',
+                        action='store_true',
+                        help='If specified, packed archives will be Yaz0-compressed. Note that '
+                        'compression is slow (well under 1 MB/s).')
     args = parser.parse_args()
 
     if os.path.isfile(args.input):
         extract(args.input, args.output)
 
     elif os.path.isdir(args.input):
-        pack(args.input, args.output)
+        pack(args.input, args.output, args.compress)
 
     else:
         raise ValueError(f'Input path ("{args.input}") cannot be extracted or packed because it is '
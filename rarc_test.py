@@ -64,21 +64,89 @@ def test_synthetic_data_set():
                     with open(path, 'wb') as f:
                         f.write(os.urandom(size))
 
-            # Pack directory.
-            arc_filepath = f'{test_dir}.arc'
-            rarc.pack(test_dir, arc_filepath)
+            for compress in (False, True):
+                # Pack directory.
+                arc_filepath = f'{test_dir}.arc'
+                rarc.pack(test_dir, arc_filepath, compress)
 
-            # Re-extract previously packed ARC file.
-            with tempfile.TemporaryDirectory() as second_tmp_dir:
-                rarc.extract(arc_filepath, second_tmp_dir)
+                # Re-extract previously packed ARC file.
+                with tempfile.TemporaryDirectory() as second_tmp_dir:
+                    rarc.extract(arc_filepath, second_tmp_dir)
+
+                    extracted_dirnames = os.listdir(second_tmp_dir)
+                    assert len(extracted_dirnames) == 1
+                    extracted_dirname = extracted_dirnames[0]
+                    assert extracted_dirname == test_name
+                    extracted_test_dir = os.path.join(second_tmp_dir, extracted_dirname)
+
+                    assert __cmpdir(test_dir, extracted_test_dir)
 
-                extracted_dirnames = os.listdir(second_tmp_dir)
-                assert len(extracted_dirnames) == 1
-                extracted_dirname = extracted_dirnames[0]
-                assert extracted_dirname == test_name
-                extracted_test_dir = os.path.join(second_tmp_dir, extracted_dirname)
 
-                assert __cmpdir(test_dir, extracted_test_dir)
+def test_yaz0_round_trip():
+    """
+    Compresses and decompresses data that exercises literals, back-references (short, long, and
+    overlapping), and trailing padding after the compressed stream.
+    """
+    data_set = (
+        b'',
+        b'a',
+        b'abc',
+        b'a' * 1000,
+        b'ab' * 1000,
+        os.urandom(3000),
+        b''.join(os.urandom(1) * (i % 300) + os.urandom(i % 7) for i in range(500)),
+        os.urandom(5000) * 3,
+    )
+
+    for data in data_set:
+        compressed_data = rarc._compress(data)  # pylint: disable=protected-access
+        assert compressed_data[:4] == b'Yaz0'
+        for padding in (b'', b'\x00' * 32):
+            decompressed_data = rarc._decompress(  # pylint: disable=protected-access
+                memoryview(compressed_data + padding))
+            assert bytes(decompressed_data) == data
+
+
+def test_in_memory_archive():
+    """
+    Reads an archive into memory, modifies it in place, and verifies that writing it produces the
+    same archive that packing the equivalent directory would.
+    """
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        test_dir = os.path.join(tmp_dir, 'test')
+        os.makedirs(os.path.join(test_dir, 'b', 'c'))
+        for relpath, size in (('a.ext', 100), ('b/d.ext', 200), ('b/c/e.ext', 300)):
+            with open(os.path.join(test_dir, relpath), 'wb') as f:
+                f.write(os.urandom(size))
+
+        for compress in (False, True):
+            arc_filepath = os.path.join(tmp_dir, 'test.arc')
+            rarc.pack(test_dir, arc_filepath, compress)
+
+            root = rarc.read(arc_filepath)
+            assert root.name == 'test'
+            assert sorted(root.files) == ['a.ext']
+            assert sorted(root.dirs) == ['b']
+            assert sorted(root.dirs['b'].dirs['c'].files) == ['e.ext']
+
+            # Modify the archive in memory, and apply the same changes on disk.
+            root.name = 'renamed'
+            root.files['a.ext'][0] ^= 0xFF
+            root.dirs['b'].files['f.ext'] = b'new'
+            with open(os.path.join(test_dir, 'a.ext'), 'r+b') as f:
+                f.write(bytes([bytes(root.files['a.ext'])[0]]))
+            with open(os.path.join(test_dir, 'b', 'f.ext'), 'wb') as f:
+                f.write(b'new')
+            renamed_test_dir = os.path.join(tmp_dir, 'renamed')
+            os.rename(test_dir, renamed_test_dir)
+
+            written_arc_filepath = os.path.join(tmp_dir, 'written.arc')
+            rarc.write(root, written_arc_filepath)
+            packed_arc_filepath = os.path.join(tmp_dir, 'packed.arc')
+            rarc.pack(renamed_test_dir, packed_arc_filepath)
+            assert filecmp.cmp(written_arc_filepath, packed_arc_filepath, shallow=False)
+
+            os.rename(renamed_test_dir, test_dir)
 
 
 def test_stock_data_set():
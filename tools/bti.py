@@ -33,6 +33,12 @@ from enum import Enum
 from io import BytesIO
 from PIL import Image
 
+try:
+  import numpy
+  _NUMPY_AVAILABLE = True
+except ImportError:
+  _NUMPY_AVAILABLE = False
+
 PADDING_BYTES = b"This is padding data to alignme"
 
 class InvalidOffsetError(Exception):
@@ -815,6 +821,9 @@ def encode_palette(encoded_colors, palette_format, image_format):
 
 
 def decode_image(image_data, palette_data, image_format, palette_format, num_colors, image_width, image_height):
+  if is_fast_decoding_supported(image_format):
+    return decode_image_numpy(image_data, image_format, image_width, image_height)
+  
   colors = decode_palettes(palette_data, palette_format, num_colors, image_format)
   
   block_width = BLOCK_WIDTHS[image_format]
@@ -1031,6 +1040,308 @@ def decode_cmpr_block(image_format, image_data, offset, block_data_size, colors)
 
 
 
+# Vectorized implementations of the codecs of the image formats that are used the most. Instead of
+# visiting each pixel, these operate on all the blocks of the image at once through numpy arrays,
+# and produce the same output as the per-block implementations above, except for the CMPR encoder:
+# the decoders and the lossless encoders (I4, IA4, RGB5A3) match exactly, whereas
+# encode_cmpr_numpy() picks its key colors along the principal axis of each block, and only matches
+# them in quality.
+
+NUMPY_IMAGE_FORMATS = [
+  ImageFormat.I4,
+  ImageFormat.IA4,
+  ImageFormat.RGB5A3,
+  ImageFormat.CMPR,
+]
+
+def is_fast_decoding_supported(image_format):
+  return _NUMPY_AVAILABLE and image_format in NUMPY_IMAGE_FORMATS
+
+def is_fast_encoding_supported(image_format):
+  return _NUMPY_AVAILABLE and image_format in NUMPY_IMAGE_FORMATS
+
+def split_into_blocks_numpy(values, block_width, block_height, bleed_value):
+  # Takes an array of shape (height, width, ...) and returns an array of shape
+  # (block_count, block_height*block_width, ...) with the blocks and the pixels in them in the same
+  # order as they are stored in the image data. Blocks that bleed past the edge of the image are
+  # filled with the given value.
+  image_height, image_width = values.shape[:2]
+  blocks_wide = (image_width + (block_width-1)) // block_width
+  blocks_tall = (image_height + (block_height-1)) // block_height
+  trailing_shape = values.shape[2:]
+  
+  padded_values = numpy.full(
+    (blocks_tall*block_height, blocks_wide*block_width) + trailing_shape,
+    bleed_value, dtype=values.dtype
+  )
+  padded_values[:image_height, :image_width] = values
+  
+  blocks = padded_values.reshape((blocks_tall, block_height, blocks_wide, block_width) + trailing_shape)
+  blocks = blocks.swapaxes(1, 2)
+  return blocks.reshape((blocks_tall*blocks_wide, block_height*block_width) + trailing_shape)
+
+def merge_blocks_numpy(blocks, block_width, block_height, image_width, image_height):
+  # Inverse of `split_into_blocks_numpy()`.
+  blocks_wide = (image_width + (block_width-1)) // block_width
+  blocks_tall = (image_height + (block_height-1)) // block_height
+  trailing_shape = blocks.shape[2:]
+  
+  values = blocks.reshape((blocks_tall, blocks_wide, block_height, block_width) + trailing_shape)
+  values = values.swapaxes(1, 2)
+  values = values.reshape((blocks_tall*block_height, blocks_wide*block_width) + trailing_shape)
+  return values[:image_height, :image_width]
+
+def convert_rgb_to_greyscale_numpy(r, g, b):
+  # Same as `convert_rgb_to_greyscale()`, including the round-half-to-even behavior of `round()`.
+  weighted_sum = r.astype(numpy.int32)*30 + g.astype(numpy.int32)*59 + b.astype(numpy.int32)*11
+  l, remainder = numpy.divmod(weighted_sum, 100)
+  l += (remainder > 50) | ((remainder == 50) & (l % 2 == 1))
+  return l
+
+def convert_rgb565_to_color_numpy(rgb565):
+  r = (rgb565 >> 11) & 0x1F
+  g = (rgb565 >> 5) & 0x3F
+  b = rgb565 & 0x1F
+  r = (r << 3) | (r >> 2)
+  g = (g << 2) | (g >> 4)
+  b = (b << 3) | (b >> 2)
+  return numpy.stack((r, g, b), axis=-1).astype(numpy.int32)
+
+def decode_image_numpy(image_data, image_format, image_width, image_height):
+  block_width = BLOCK_WIDTHS[image_format]
+  block_height = BLOCK_HEIGHTS[image_format]
+  block_data_size = BLOCK_DATA_SIZES[image_format]
+  blocks_wide = (image_width + (block_width-1)) // block_width
+  blocks_tall = (image_height + (block_height-1)) // block_height
+  
+  raw_data = read_bytes(image_data, 0, blocks_wide*blocks_tall*block_data_size)
+  data = numpy.frombuffer(raw_data, dtype=numpy.uint8)
+  
+  if image_format == ImageFormat.I4:
+    # The first pixel is stored in the high nibble.
+    i = numpy.stack((data >> 4, data & 0xF), axis=-1).reshape(-1)*17
+    colors = numpy.stack((i, i, i, i), axis=-1)
+  elif image_format == ImageFormat.IA4:
+    i = (data & 0xF)*17
+    a = (data >> 4)*17
+    colors = numpy.stack((i, i, i, a), axis=-1)
+  elif image_format == ImageFormat.RGB5A3:
+    rgb5a3 = data.view(">u2").astype(numpy.uint16)
+    
+    # 1RRRRRGGGGGBBBBB
+    r5 = (rgb5a3 >> 10) & 0x1F
+    g5 = (rgb5a3 >> 5) & 0x1F
+    b5 = rgb5a3 & 0x1F
+    
+    # 0AAARRRRGGGGBBBB
+    a3 = (rgb5a3 >> 12) & 0x7
+    r4 = (rgb5a3 >> 8) & 0xF
+    g4 = (rgb5a3 >> 4) & 0xF
+    b4 = rgb5a3 & 0xF
+    
+    opaque = (rgb5a3 & 0x8000) != 0
+    r = numpy.where(opaque, (r5 << 3) | (r5 >> 2), r4*17)
+    g = numpy.where(opaque, (g5 << 3) | (g5 >> 2), g4*17)
+    b = numpy.where(opaque, (b5 << 3) | (b5 >> 2), b4*17)
+    a = numpy.where(opaque, 0xFF, (a3 << 5) | (a3 << 2) | (a3 >> 1))
+    colors = numpy.stack((r, g, b, a), axis=-1)
+  elif image_format == ImageFormat.CMPR:
+    colors = decode_cmpr_numpy(data)
+  else:
+    raise Exception("Unsupported image format: %s" % ImageFormat(image_format).name)
+  
+  blocks = colors.reshape((-1, block_width*block_height, 4)).astype(numpy.uint8)
+  pixels = merge_blocks_numpy(blocks, block_width, block_height, image_width, image_height)
+  return Image.fromarray(numpy.ascontiguousarray(pixels), "RGBA")
+
+def get_interpolated_cmpr_colors_numpy(color_0_rgb565, color_1_rgb565):
+  # Same as `get_interpolated_cmpr_colors()`, for an array of subblocks. Returns an array of shape
+  # (subblock_count, 4, 4) with the RGBA palette of each subblock.
+  color_0 = convert_rgb565_to_color_numpy(color_0_rgb565)
+  color_1 = convert_rgb565_to_color_numpy(color_1_rgb565)
+  
+  four_colors = (color_0_rgb565 > color_1_rgb565)[:, None]
+  color_2 = numpy.where(four_colors, (2*color_0 + color_1)//3, color_0//2 + color_1//2)
+  color_3 = numpy.where(four_colors, (color_0 + 2*color_1)//3, 0)
+  alpha = numpy.full((color_0.shape[0], 1), 0xFF, dtype=numpy.int32)
+  alpha_3 = numpy.where(four_colors, 0xFF, 0).astype(numpy.int32)
+  
+  return numpy.stack((
+    numpy.concatenate((color_0, alpha), axis=-1),
+    numpy.concatenate((color_1, alpha), axis=-1),
+    numpy.concatenate((color_2, alpha), axis=-1),
+    numpy.concatenate((color_3, alpha_3), axis=-1),
+  ), axis=1)
+
+def decode_cmpr_numpy(data):
+  # Each 8x8 block consists of four 4x4 subblocks of 8 bytes each: two RGB565 key colors followed
+  # by sixteen 2-bit color indexes.
+  subblocks = data.reshape((-1, 8))
+  subblock_count = subblocks.shape[0]
+  
+  color_0_rgb565 = (subblocks[:, 0].astype(numpy.uint16) << 8) | subblocks[:, 1]
+  color_1_rgb565 = (subblocks[:, 2].astype(numpy.uint16) << 8) | subblocks[:, 3]
+  palettes = get_interpolated_cmpr_colors_numpy(color_0_rgb565, color_1_rgb565)
+  
+  shifts = numpy.array([6, 4, 2, 0], dtype=numpy.uint8)
+  color_indexes = ((subblocks[:, 4:8, None] >> shifts) & 0x3).reshape((subblock_count, 16))
+  colors = palettes[numpy.arange(subblock_count)[:, None], color_indexes]
+  
+  # Arrange the 2x2 subblocks of 4x4 pixels into blocks of 8x8 pixels.
+  colors = colors.reshape((-1, 2, 2, 4, 4, 4)).transpose((0, 1, 3, 2, 4, 5))
+  return colors.reshape((-1, 64, 4))
+
+def encode_mipmap_image_numpy(image, image_format):
+  block_width = BLOCK_WIDTHS[image_format]
+  block_height = BLOCK_HEIGHTS[image_format]
+  
+  pixels = numpy.asarray(image)
+  r = pixels[:, :, 0]
+  g = pixels[:, :, 1]
+  b = pixels[:, :, 2]
+  a = pixels[:, :, 3]
+  
+  if image_format == ImageFormat.I4:
+    i4 = ((convert_rgb_to_greyscale_numpy(r, g, b) >> 4) & 0xF).astype(numpy.uint8)
+    blocks = split_into_blocks_numpy(i4, block_width, block_height, 0xF)
+    pairs = blocks.reshape((-1, 2))
+    data = (pairs[:, 0] << 4) | pairs[:, 1]
+  elif image_format == ImageFormat.IA4:
+    ia4 = ((convert_rgb_to_greyscale_numpy(r, g, b) >> 4) & 0xF) | (a & 0xF0)
+    data = split_into_blocks_numpy(ia4.astype(numpy.uint8), block_width, block_height, 0xFF)
+  elif image_format == ImageFormat.RGB5A3:
+    r = r.astype(numpy.uint16)
+    g = g.astype(numpy.uint16)
+    b = b.astype(numpy.uint16)
+    a = a.astype(numpy.uint16)
+    # 1RRRRRGGGGGBBBBB
+    opaque_rgb5a3 = 0x8000 | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)
+    # 0AAARRRRGGGGBBBB
+    translucent_rgb5a3 = ((a >> 5) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4)
+    rgb5a3 = numpy.where(a == 0xFF, opaque_rgb5a3, translucent_rgb5a3).astype(">u2")
+    data = split_into_blocks_numpy(rgb5a3, block_width, block_height, 0xFFFF)
+  elif image_format == ImageFormat.CMPR:
+    data = encode_cmpr_numpy(pixels)
+  else:
+    raise Exception("Unsupported image format: %s" % ImageFormat(image_format).name)
+  
+  return BytesIO(data.tobytes())
+
+def encode_cmpr_numpy(pixels):
+  # Unlike `encode_image_to_cmpr_block()`, which tries every pair of colors in a subblock to find
+  # the two that are the furthest apart, the key colors are taken from the ends of the principal
+  # axis of the opaque colors in the subblock (the line that best fits them), which can be computed
+  # for all subblocks at once. The rules for transparency and for choosing the color indexes are
+  # otherwise the same, except that pixels are matched against the key colors as they will be
+  # decoded (i.e. after being reduced to RGB565).
+  image_height, image_width = pixels.shape[:2]
+  
+  # Split the image into 8x8 blocks, and then each block into its 2x2 subblocks of 4x4 pixels.
+  def split_into_subblocks(values, bleed_value):
+    blocks = split_into_blocks_numpy(values, 8, 8, bleed_value)
+    blocks = blocks.reshape((-1, 2, 4, 2, 4) + values.shape[2:]).swapaxes(2, 3)
+    return blocks.reshape((-1, 16) + values.shape[2:])
+  
+  colors = split_into_subblocks(pixels, 0).astype(numpy.int32)
+  in_image = split_into_subblocks(numpy.ones((image_height, image_width), dtype=bool), False)
+  subblock_count = colors.shape[0]
+  
+  transparent = in_image & (colors[:, :, 3] < 16)
+  opaque = in_image & ~transparent
+  needs_transparent_color = transparent.any(axis=1)
+  
+  # Principal axis of the opaque colors, found by power iteration on their covariance matrix. The
+  # iteration starts with the column of the channel with the largest variance.
+  rgb = colors[:, :, :3].astype(numpy.float64)
+  weights = opaque[:, :, None].astype(numpy.float64)
+  opaque_count = opaque.sum(axis=1)
+  safe_opaque_count = numpy.maximum(opaque_count, 1)[:, None]
+  mean = (rgb*weights).sum(axis=1) / safe_opaque_count
+  deviations = (rgb - mean[:, None, :])*weights
+  covariance = numpy.einsum("sni,snj->sij", deviations, deviations) / safe_opaque_count[:, :, None]
+  
+  largest_channel = numpy.argmax(numpy.diagonal(covariance, axis1=1, axis2=2), axis=1)
+  axis = covariance[numpy.arange(subblock_count), largest_channel]
+  for _ in range(8):
+    norm = numpy.linalg.norm(axis, axis=1, keepdims=True)
+    axis = numpy.divide(axis, norm, out=numpy.zeros_like(axis), where=norm > 0)
+    axis = numpy.einsum("sij,sj->si", covariance, axis)
+  norm = numpy.linalg.norm(axis, axis=1, keepdims=True)
+  axis = numpy.divide(axis, norm, out=numpy.zeros_like(axis), where=norm > 0)
+  
+  projections = numpy.einsum("sni,si->sn", rgb - mean[:, None, :], axis)
+  min_projection = numpy.where(opaque, projections, numpy.inf).min(axis=1, initial=numpy.inf)
+  max_projection = numpy.where(opaque, projections, -numpy.inf).max(axis=1, initial=-numpy.inf)
+  min_projection[opaque_count == 0] = 0
+  max_projection[opaque_count == 0] = 0
+  
+  key_color_0 = numpy.clip(numpy.rint(mean + axis*max_projection[:, None]), 0, 255).astype(numpy.int32)
+  key_color_1 = numpy.clip(numpy.rint(mean + axis*min_projection[:, None]), 0, 255).astype(numpy.int32)
+  
+  def convert_color_to_rgb565_numpy(color):
+    return ((color[:, 0] >> 3) << 11) | ((color[:, 1] >> 2) << 5) | (color[:, 2] >> 3)
+  
+  color_0_rgb565 = convert_color_to_rgb565_numpy(key_color_0)
+  color_1_rgb565 = convert_color_to_rgb565_numpy(key_color_1)
+  
+  # Same fallbacks as in `get_best_cmpr_key_colors()`: black and white when there are no opaque
+  # colors, and black (or white) when both key colors would be the same.
+  color_0_rgb565[opaque_count == 0] = 0x0000
+  color_1_rgb565[opaque_count == 0] = 0xFFFF
+  same_key_colors = color_0_rgb565 == color_1_rgb565
+  color_1_rgb565[same_key_colors] = numpy.where(color_0_rgb565[same_key_colors] == 0, 0xFFFF, 0x0000)
+  
+  # The 3-color mode (with a transparent color) is selected when the first key color is not
+  # greater than the second one.
+  swap = numpy.where(
+    needs_transparent_color,
+    color_0_rgb565 > color_1_rgb565,
+    color_0_rgb565 < color_1_rgb565,
+  )
+  color_0_rgb565, color_1_rgb565 = (
+    numpy.where(swap, color_1_rgb565, color_0_rgb565),
+    numpy.where(swap, color_0_rgb565, color_1_rgb565),
+  )
+  
+  # Pick the nearest color in the palette for each pixel, using the same distance as
+  # `get_color_distance_fast()`. Transparent pixels take the transparent color when available.
+  palettes = get_interpolated_cmpr_colors_numpy(color_0_rgb565, color_1_rgb565)
+  distances = numpy.abs(colors[:, :, None, :] - palettes[:, None, :, :]).sum(axis=-1)
+  color_indexes = numpy.argmin(distances, axis=-1)
+  has_transparent_color = color_0_rgb565 <= color_1_rgb565
+  color_indexes[transparent & has_transparent_color[:, None]] = 3
+  color_indexes[~in_image] = 0
+  
+  color_indexes = color_indexes.astype(numpy.uint8).reshape((subblock_count, 4, 4))
+  index_bytes = (
+    (color_indexes[:, :, 0] << 6) | (color_indexes[:, :, 1] << 4) |
+    (color_indexes[:, :, 2] << 2) | color_indexes[:, :, 3]
+  )
+  
+  data = numpy.empty((subblock_count, 8), dtype=numpy.uint8)
+  data[:, 0:2] = color_0_rgb565.astype(">u2").view(numpy.uint8).reshape((subblock_count, 2))
+  data[:, 2:4] = color_1_rgb565.astype(">u2").view(numpy.uint8).reshape((subblock_count, 2))
+  data[:, 4:8] = index_bytes
+  return data
+
+def create_bti_data_from_image(image, image_format):
+  # Encodes the image into a complete BTI file (header followed by the image data) with the same
+  # header values that wimgt writes: a single image, no palette, no wrapping, linear filtering.
+  image_data, _palette_data, _encoded_colors = encode_image(image, image_format, PaletteFormat.RGB5A3)
+  
+  header = struct.pack(
+    ">BBHHBBBBHII" "BBBBBBHI",
+    image_format.value, 0x02, image.width, image.height,
+    WrapMode.ClampToEdge.value, WrapMode.ClampToEdge.value,
+    0, 0, 0, 0, 0,
+    FilterMode.Linear.value, FilterMode.Linear.value,
+    0, 0, 1, 0, 0, 0x20,
+  )
+  assert len(header) == 0x20
+  
+  return header + read_all_bytes(image_data)
+
+
 def encode_image_from_path(new_image_file_path, image_format, palette_format, mipmap_count=1):
   image = Image.open(new_image_file_path)
   image_width, image_height = image.size
@@ -1078,6 +1389,9 @@ def encode_image(image, image_format, palette_format, mipmap_count=1):
   return (new_image_data, new_palette_data, encoded_colors)
 
 def encode_mipmap_image(image, image_format, colors_to_color_indexes, image_width, image_height):
+  if is_fast_encoding_supported(image_format):
+    return encode_mipmap_image_numpy(image, image_format)
+  
   pixels = image.load()
   offset_in_image_data = 0
   block_x = 0
@@ -1,6 +1,10 @@
+import hashlib
 import subprocess
 import os
 import platform
+import re
+import shutil
+import tempfile
 from itertools import chain
 
 from .dolreader import DolFile, SectionCountFull
@@ -24,16 +28,67 @@ def run(args):
         subprocess.check_call(args)
 
 
-def compile_(inpath, outpath, mode, optimize="-O1", warnings=('-W', '-Wall', '-Wextra')):
+def check_output(args):
+    # Same as run(), but the output (both stdout and stderr) is returned instead of printed.
+    kwargs = {}
+    if platform.system() == "Windows":
+        kwargs["creationflags"] = subprocess.CREATE_NO_WINDOW
+    return subprocess.check_output(args, stderr=subprocess.STDOUT, text=True, **kwargs)
+
+
+_toolchain_identities = {}
+
+
+def get_toolchain_identity():
+    # Returns a value that changes whenever the toolchain is replaced (e.g. on a devkitPPC upgrade).
+    # It covers the programs that are run directly, and also `cc1` and `as`, which are run by the
+    # compiler driver: their version output (the driver's `-v` output includes its configuration),
+    # and the size of their binaries. Modification times are left out, as they change on every
+    # checkout of a bundled toolchain. Computed once per toolchain.
+    toolpaths = (GCCPATH, LDPATH, OBJCOPYPATH)
+    identity = _toolchain_identities.get(toolpaths)
+    if identity is not None:
+        return identity
+
+    identity = [check_output([GCCPATH, "-v"])]
+    programs = list(toolpaths)
+    for prog_name in ("cc1", "as"):
+        prog_path = check_output([GCCPATH, "-print-prog-name=" + prog_name]).strip()
+        if not os.path.isabs(prog_path):
+            # Not bundled with the driver; looked up in the `PATH` instead.
+            prog_path = shutil.which(prog_path) or prog_path
+        programs.append(prog_path)
+    for prog_path in programs:
+        identity.append(prog_path)
+        try:
+            identity.append(os.path.getsize(prog_path))
+        except OSError:
+            identity.append(None)
+    for prog_path in (programs[1], programs[2], programs[4]):  # ld, objcopy, as
+        identity.append(check_output([prog_path, "--version"]))
+
+    identity = tuple(identity)
+    _toolchain_identities[toolpaths] = identity
+    return identity
+
+
+def compile_(inpath,
+             outpath,
+             mode,
+             optimize="-O1",
+             warnings=('-W', '-Wall', '-Wextra'),
+             flags=tuple()):
     assert mode in ("-S", "-c")
     args = [GCCPATH, inpath, mode, "-o", outpath, optimize]
     args += warnings
+    args += flags
     run(args)
 
 
-def link(infiles, outfile, outmap, linker_files):
+def link(infiles, outfile, outmap, linker_files, flags=tuple()):
     arg = [LDPATH]
     arg.append("-Os")
+    arg.extend(flags)
     for file in linker_files:
         arg.append("-T")
         arg.append(file)
@@ -70,7 +125,7 @@ def read_map(mappath):
 
         next1 = f.readline()
         next2 = f.readline()
-        assert next1.startswith(" *(.text)")
+        assert next1.startswith(" *(.text")
         assert next2.startswith(" .text")
         next1 = f.readline()
 
@@ -98,7 +153,7 @@ def read_data(mappath):
 
         next1 = f.readline()
         next2 = f.readline()
-        assert next1.startswith(" *(.data)")
+        assert next1.startswith(" *(.data")
         assert next2.startswith(" .data")
         next1 = f.readline()
 
@@ -117,6 +172,52 @@ def read_data(mappath):
     return result
 
 
+def read_symbols(mappath):
+    # Every symbol defined in the project (functions and variables, in any section). Symbols that
+    # are assigned in linker files (i.e. the game symbols) are not included.
+    result = {}
+    pattern = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_][A-Za-z0-9_]*)\s*$")
+    with open(mappath, "r", encoding='ascii') as f:
+        for line in f:
+            match = pattern.match(line)
+            if match is not None:
+                result[match.group(2)] = int(match.group(1), 16)
+
+    return result
+
+
+def read_input_section_sizes(mappath):
+    # The size of every input section that has been linked. When each function and variable is
+    # placed in its own section, this is the size of each symbol (e.g. `.text.change_course_page`).
+    result = {}
+    pattern = re.compile(r"^ (\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+\S+)?\s*$")
+    size_pattern = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+\S+\s*$")
+    with open(mappath, "r", encoding='ascii') as f:
+        for line in f:
+            if line.startswith("Linker script and memory map"):
+                break
+
+        name = None
+        for line in f:
+            if name is not None:
+                match = size_pattern.match(line)
+                if match is not None:
+                    result[name] = result.get(name, 0) + int(match.group(2), 16)
+                name = None
+                continue
+
+            match = pattern.match(line)
+            if match is None:
+                continue
+            if match.group(3) is None:
+                # Long section names are followed by the address and the size in the next line.
+                name = match.group(1)
+            else:
+                result[match.group(1)] = result.get(match.group(1), 0) + int(match.group(3), 16)
+
+    return {name: size for name, size in result.items() if size > 0}
+
+
 class Project:
 
     def __init__(self, dolpath, address=None, offset=None):
@@ -148,8 +249,16 @@ class Project:
         self.branches = []
 
         self.osarena_patcher = None
+        self.post_link_patcher = None
         self.functions = None
 
+        self.optimize = compile_.__defaults__[0]
+        self.gc_sections = False
+        self.kept_symbols = []
+
+        self.build_cache_dir = None
+        self.build_cache_hit = False
+
     def add_file(self, filepath):
         self.c_files.append(filepath)
 
@@ -168,6 +277,40 @@ class Project:
     def set_osarena_patcher(self, function):
         self.osarena_patcher = function
 
+    def set_post_link_patcher(self, function):
+        self.post_link_patcher = function
+
+    def set_build_cache_dir(self, dirpath):
+        # One entry is added for every distinct build. Entries are never evicted, so the directory
+        # grows without limit; it is up to the caller to delete it (or old entries in it).
+        self.build_cache_dir = dirpath
+
+    def set_optimize(self, optimize):
+        self.optimize = optimize
+
+    def set_gc_sections(self, enabled):
+        # When enabled, every function and variable is placed in its own section, and the sections
+        # that are not reachable from the branch targets or the kept symbols are discarded.
+        self.gc_sections = enabled
+
+    def keep_symbol(self, name):
+        # Symbols that are not referenced from the code (e.g. looked up by a post-link patcher)
+        # need to be kept explicitly when unused sections are discarded.
+        self.kept_symbols.append(name)
+
+    def _compile_flags(self):
+        flags = []
+        if self.gc_sections:
+            flags.extend(("-ffunction-sections", "-fdata-sections"))
+        return tuple(flags)
+
+    def _link_flags(self):
+        if not self.gc_sections:
+            return ()
+        roots = [func for _addr, func in chain(self.branches, self.branchlinks)]
+        roots += self.kept_symbols
+        return ["--gc-sections"] + ["--undefined={0}".format(name) for name in roots]
+
     def append_to_symbol_map(self, symbols, map_, newmap):
         addresses = []
         for k, v in symbols.items():
@@ -185,23 +328,87 @@ class Project:
                     size = addresses[i + 1][1] - v[1]
                     f.write("{0:x} {1:08x} {0:x} 0 {2}".format(v[1], size, v[0]))
 
-    def build(self, newdolpath):
-        os.makedirs("tmp", exist_ok=True)
-
+    def _compile_and_link(self):
+        flags = self._compile_flags()
         for fpath in self.c_files:
-            compile_(fpath, fpath + ".s", mode="-S")
-            compile_(fpath, fpath + ".o", mode="-c")
+            compile_(fpath, fpath + ".s", mode="-S", optimize=self.optimize, flags=flags)
+            compile_(fpath, fpath + ".o", mode="-c", optimize=self.optimize, flags=flags)
 
         for fpath in self.asm_files:
-            compile_(fpath, fpath + ".o", mode="-c")
+            compile_(fpath, fpath + ".o", mode="-c", optimize=self.optimize, flags=flags)
 
-        with open("tmplink", "w", encoding='ascii') as f:
-            f.write("""SECTIONS
+        linker_files = ["tmplink"]
+        for fpath in self.linker_files:
+            linker_files.append(fpath)
+        link([fpath + ".o" for fpath in chain(self.c_files, self.asm_files)], "project.o",
+             "project.map", linker_files, self._link_flags())
+
+        objcopy("project.o",
+                "project.bin",
+                "-O",
+                "binary",
+                "-g",
+                "-S",
+                attrs=[".eh_frame", ".comment", ".gnu.attributes"])
+
+    def _build_cache_key(self, linker_script):
+        # The key covers everything that determines the output of the compiler and the linker:
+        # the toolchain (see get_toolchain_identity()), the flags, the input files (in order), and
+        # the linker script.
+        hasher = hashlib.sha256()
+
+        def update(value):
+            value = value if isinstance(value, bytes) else str(value).encode('utf-8')
+            hasher.update(len(value).to_bytes(8, 'big'))
+            hasher.update(value)
+
+        update(get_toolchain_identity())
+        update(compile_.__defaults__)
+        update(self.optimize)
+        update(self._compile_flags())
+        update(self._link_flags())
+        update(linker_script)
+        for fpaths in (self.c_files, self.asm_files, self.linker_files):
+            update(len(fpaths))
+            for fpath in fpaths:
+                with open(fpath, "rb") as f:
+                    update(f.read())
+
+        return hasher.hexdigest()
+
+    def _build_cache_files(self):
+        # Pairs of build output paths and their filenames in a cache entry. The binary and the map
+        # are enough to resume the build; the object file and the assembly listings are kept for
+        # diagnosis purposes.
+        files = [("project.bin", "project.bin"), ("project.map", "project.map"),
+                 ("project.o", "project.o")]
+        for i, fpath in enumerate(self.c_files):
+            files.append((fpath + ".s", "{0}_{1}.s".format(i, os.path.basename(fpath))))
+        return files
+
+    def _store_in_build_cache(self, cache_key_dir):
+        os.makedirs(self.build_cache_dir, exist_ok=True)
+
+        # The entry is populated in a temporary directory first, so that concurrent builds never
+        # see a partial entry.
+        tmp_dir = tempfile.mkdtemp(dir=self.build_cache_dir)
+        try:
+            for src, dst in self._build_cache_files():
+                shutil.copyfile(src, os.path.join(tmp_dir, dst))
+            os.rename(tmp_dir, cache_key_dir)
+        except OSError:
+            # Another build may have stored the same entry in the meantime.
+            shutil.rmtree(tmp_dir, ignore_errors=True)
+
+    def build(self, newdolpath):
+        os.makedirs("tmp", exist_ok=True)
+
+        linker_script = """SECTIONS
 {{
     . = 0x{0:x};
     .text :
     {{
-        *(.text)
+        *(.text .text.*)
     }}
 	.rodata :
 	{{
@@ -209,32 +416,42 @@ class Project:
 	}}
 	.data :
 	{{
-		*(.data)
+		*(.data .data.*)
 	}}
 	. += 0x08;
 	.sdata :
 	{{
-		*(.sdata)
+		*(.sdata .sdata.*)
 	}}
-}}""".format(self._address))
-        linker_files = ["tmplink"]
-        for fpath in self.linker_files:
-            linker_files.append(fpath)
-        link([fpath + ".o" for fpath in chain(self.c_files, self.asm_files)], "project.o",
-             "project.map", linker_files)
+	/DISCARD/ :
+	{{
+		*(.eh_frame)
+	}}
+}}""".format(self._address)
 
-        objcopy("project.o",
-                "project.bin",
-                "-O",
-                "binary",
-                "-g",
-                "-S",
-                attrs=[".eh_frame", ".comment", ".gnu.attributes"])
+        with open("tmplink", "w", encoding='ascii') as f:
+            f.write(linker_script)
+
+        cache_key_dir = None
+        if self.build_cache_dir is not None:
+            cache_key_dir = os.path.join(self.build_cache_dir, self._build_cache_key(linker_script))
+        self.build_cache_hit = cache_key_dir is not None and os.path.isdir(cache_key_dir)
+
+        if self.build_cache_hit:
+            for dst, src in self._build_cache_files():
+                shutil.copyfile(os.path.join(cache_key_dir, src), dst)
+        else:
+            self._compile_and_link()
+
+            if cache_key_dir is not None:
+                self._store_in_build_cache(cache_key_dir)
 
         with open("project.bin", "rb") as f:
             data = f.read()
 
-        functions = read_map("project.map")
+        # The symbols are read from the entire map, as the functions are not listed under a single
+        # `.text` input section when each function is placed in its own section.
+        functions = read_symbols("project.map")
 
         _offset, sectionaddr, size = self.dol.allocate_text_section(len(data), addr=self._address)
 
@@ -256,5 +473,8 @@ class Project:
         if self.osarena_patcher is not None:
             self.osarena_patcher(self.dol, sectionaddr + size)
 
+        if self.post_link_patcher is not None:
+            self.post_link_patcher(self.dol, read_symbols("project.map"))
+
         with open(newdolpath, "wb") as f:
             self.dol.save(f)
@@ -25,14 +25,33 @@ Module for reading and writing GCM files.
 Borrowed from https://github.com/LagoLunatic/wwrando/tree/5fa6da83f10cca85ccc2dcf4cd40badd7c1b8ac0/wwlib.
 """
 
+import argparse
+import bisect
+import hashlib
+import io
+import mmap
 import os
 import struct
 from io import BytesIO
 
 MAX_DATA_SIZE_TO_READ_AT_ONCE = 64*1024*1024 # 64MB
 
+EXPORTED_FILE_TIMESTAMP = 315532800 # 1980-01-01
+
 PADDING_BYTES = b"This is padding data to alignme"
 
+# Delta patches (see DeltaWriter) start with a fixed-size header: magic, version, source ISO size,
+# output ISO size, offset and number of entries of the extent table, and the source fingerprint.
+DELTA_PATCH_MAGIC = b"GCMDELTA"
+DELTA_PATCH_VERSION = 1
+DELTA_PATCH_HEADER_FORMAT = ">8sIQQQI16s"
+DELTA_PATCH_HEADER_SIZE = 0x40
+# Each extent in the table of a delta patch holds: kind, output offset, size, and data offset (in
+# the source ISO for source extents, or in the patch file for literal extents).
+DELTA_PATCH_EXTENT_FORMAT = ">IQQQ"
+DELTA_PATCH_EXTENT_SOURCE = 0
+DELTA_PATCH_EXTENT_LITERAL = 1
+
 class InvalidOffsetError(Exception):
   pass
 
@@ -92,10 +111,20 @@ def try_read_str(data, offset, length):
     return None
 
 def read_str_until_null_character(data, offset):
-  data_length = data.seek(0, 2)
+  if isinstance(data, mmap.mmap):
+    data_length = len(data)
+  else:
+    data_length = data.seek(0, 2)
   if offset > data_length:
     raise InvalidOffsetError("Offset 0x%X is past the end of the data (length 0x%X)." % (offset, data_length))
   
+  if isinstance(data, mmap.mmap):
+    # Memory-mapped data can be searched directly.
+    end_offset = data.find(b"\0", offset)
+    if end_offset == -1:
+      end_offset = data_length
+    return data[offset:end_offset].decode("shift_jis")
+  
   temp_offset = offset
   str_length = 0
   while temp_offset < data_length:
@@ -231,27 +260,99 @@ def pad_offset_to_nearest(offset, size):
   next_offset = offset + (size - offset % size) % size
   return next_offset
 
+def copy_data(src_file, src_offset, dst_file, size):
+  # Copies a range of bytes from one file to the current position in another file. Where supported,
+  # the copy is delegated to the kernel, which avoids moving the data through user space (and can
+  # even share the data blocks on file systems with reflink support).
+  dst_file.flush()
+  dst_offset = dst_file.tell()
+  
+  if hasattr(os, "copy_file_range"):
+    try:
+      while size > 0:
+        size_copied = os.copy_file_range(
+          src_file.fileno(), dst_file.fileno(),
+          min(size, MAX_DATA_SIZE_TO_READ_AT_ONCE), src_offset, dst_offset
+        )
+        if size_copied <= 0:
+          break
+        src_offset += size_copied
+        dst_offset += size_copied
+        size -= size_copied
+    except OSError:
+      # Not supported between these two files (e.g. different file systems in old kernels). The
+      # remaining data is copied below.
+      pass
+  
+  dst_file.seek(dst_offset)
+  
+  # Need to avoid reading enormous files all at once
+  while size > 0:
+    size_to_read = min(size, MAX_DATA_SIZE_TO_READ_AT_ONCE)
+    data = read_bytes(src_file, src_offset, size_to_read)
+    if not data:
+      raise InvalidOffsetError("Offset 0x%X is past the end of the data." % src_offset)
+    dst_file.write(data)
+    
+    src_offset += len(data)
+    size -= len(data)
+
 
 
 class GCM:
-  def __init__(self, iso_path):
+  def __init__(self, iso_path, use_mmap=True):
     self.iso_path = iso_path
+    # When enabled, the input ISO is memory-mapped until close() is called (or the GCM object is
+    # used as a context manager). Parsing the FST and reading file data become slicing over the
+    # mapping, and file data is returned as memoryview objects instead of copies.
+    self.use_mmap = use_mmap
+    self.iso_mmap = None
     self.files_by_path = {}
     self.files_by_path_lowercase = {}
     self.dirs_by_path = {}
     self.dirs_by_path_lowercase = {}
     self.changed_files = {}
+    self.exported_files = {}
+    self.unexported_files = []
+  
+  def __enter__(self):
+    return self
+  
+  def __exit__(self, exc_type, exc_value, traceback):
+    self.close()
+  
+  def close(self):
+    # Releases the memory mapping of the input ISO, if any. File data can still be read afterwards,
+    # as in the non-mmap mode.
+    if self.iso_mmap is not None:
+      try:
+        self.iso_mmap.close()
+      except BufferError:
+        # Some memoryview objects returned by read_file_entry_data() are still alive; the mapping is
+        # released along with the last of them.
+        pass
+      self.iso_mmap = None
   
   def read_entire_disc(self):
-    self.iso_file = open(self.iso_path, "rb")
+    iso_file = open(self.iso_path, "rb")
     
     try:
+      self.iso_file = iso_file
+      if self.use_mmap:
+        try:
+          self.iso_mmap = mmap.mmap(iso_file.fileno(), 0, access=mmap.ACCESS_READ)
+          self.iso_file = self.iso_mmap
+        except (OSError, ValueError, OverflowError):
+          # E.g. empty files, or images too large for the address space. Fall back to regular reads.
+          self.iso_mmap = None
+      
       self.fst_offset = read_u32(self.iso_file, 0x424)
       self.fst_size = read_u32(self.iso_file, 0x428)
       self.read_filesystem()
       self.read_system_data()
     finally:
-      self.iso_file.close()
+      # The mapping, if any, remains valid after the file is closed.
+      iso_file.close()
       self.iso_file = None
     
     for file_path, file_entry in self.files_by_path.items():
@@ -341,8 +442,7 @@ class GCM:
     file_entry = self.files_by_path_lowercase[file_path]
     if file_entry.file_size > MAX_DATA_SIZE_TO_READ_AT_ONCE:
       raise Exception("Tried to read a very large file all at once")
-    with open(self.iso_path, "rb") as iso_file:
-      data = read_bytes(iso_file, file_entry.file_data_offset, file_entry.file_size)
+    data = self.read_file_entry_data(file_entry)
     data = BytesIO(data)
     
     return data
@@ -353,11 +453,18 @@ class GCM:
       raise Exception("Could not find file: " + file_path)
     
     file_entry = self.files_by_path_lowercase[file_path]
-    with open(self.iso_path, "rb") as iso_file:
-      data = read_bytes(iso_file, file_entry.file_data_offset, file_entry.file_size)
+    data = self.read_file_entry_data(file_entry)
     
     return data
   
+  def read_file_entry_data(self, file_entry):
+    if self.iso_mmap is not None:
+      offset = file_entry.file_data_offset
+      return memoryview(self.iso_mmap)[offset:offset+file_entry.file_size]
+    
+    with open(self.iso_path, "rb") as iso_file:
+      return read_bytes(iso_file, file_entry.file_data_offset, file_entry.file_size)
+  
   def get_or_create_dir_file_entry(self, dir_path):
     if dir_path.lower() in self.dirs_by_path_lowercase:
       return self.dirs_by_path_lowercase[dir_path.lower()]
@@ -376,7 +483,37 @@ class GCM:
     
     return num_files_overwritten
   
-  def export_disc_to_folder_with_changed_files(self, output_folder_path, only_changed_files=False):
+  def overlay_all_files_from_disk(self, input_directory):
+    # Same as import_all_files_from_disk(), but without reading the files into memory.
+    # Files that are still the ones written by export_disc_to_folder_with_changed_files() (even if
+    # they have been renamed or hard linked since) are mapped back to their data in the input ISO,
+    # and the rest are streamed from disk when the ISO is written.
+    num_files_overwritten = 0
+    
+    for file_path, file_entry in self.files_by_path.items():
+      full_file_path = os.path.join(input_directory, file_path)
+      if not os.path.isfile(full_file_path):
+        continue
+      
+      stat = os.stat(full_file_path)
+      exported_file = self.exported_files.get((stat.st_dev, stat.st_ino))
+      if exported_file is not None:
+        file_data_offset, file_size, exported_size, exported_mtime_ns = exported_file
+        if (stat.st_size, stat.st_mtime_ns) == (exported_size, exported_mtime_ns):
+          file_entry.file_data_offset = file_data_offset
+          file_entry.file_size = file_size
+          self.changed_files.pop(file_path, None)
+          continue
+      
+      self.changed_files[file_path] = full_file_path
+      num_files_overwritten += 1
+    
+    return num_files_overwritten
+  
+  def export_disc_to_folder_with_changed_files(self, output_folder_path, only_changed_files=False, path_filter=None):
+    # If given, path_filter is called with the path of each unchanged file, and only the files for
+    # which it returns true are exported. The rest are listed in unexported_files; as they will not
+    # be found on disk, overlay_all_files_from_disk() leaves them referencing the input ISO.
     files_done = 0
     
     for file_path, file_entry in self.files_by_path.items():
@@ -394,33 +531,41 @@ class GCM:
       else:
         if only_changed_files:
           continue
+        if path_filter is not None and not path_filter(file_path):
+          self.unexported_files.append(file_path)
+          continue
         if not os.path.isdir(dir_name):
           os.makedirs(dir_name)
         
-        # Need to avoid reading enormous files all at once
-        size_remaining = file_entry.file_size
-        offset_in_file = 0
-        with open(full_file_path, "wb") as f:
-          while size_remaining > 0:
-            size_to_read = min(size_remaining, MAX_DATA_SIZE_TO_READ_AT_ONCE)
-            
-            with open(self.iso_path, "rb") as iso_file:
-              data = read_bytes(iso_file, file_entry.file_data_offset + offset_in_file, size_to_read)
-            f.write(data)
-            
-            size_remaining -= size_to_read
-            offset_in_file += size_to_read
+        with open(self.iso_path, "rb") as iso_file, open(full_file_path, "wb") as f:
+          copy_data(iso_file, file_entry.file_data_offset, f, file_entry.file_size)
+        
+        # Remember the identity of the file, so that overlay_all_files_from_disk() can tell whether
+        # it still holds the original data. The modification time is set to a fixed date in the
+        # past, so that any later write is noticed even in file systems with coarse timestamps.
+        os.utime(full_file_path, (EXPORTED_FILE_TIMESTAMP, EXPORTED_FILE_TIMESTAMP))
+        stat = os.stat(full_file_path)
+        if stat.st_ino:
+          self.exported_files[(stat.st_dev, stat.st_ino)] = (
+            file_entry.file_data_offset, file_entry.file_size, stat.st_size, stat.st_mtime_ns
+          )
       
       files_done += 1
       yield(file_path, files_done)
     
     yield("Done", -1)
   
-  def export_disc_to_iso_with_changed_files(self, output_file_path):
+  def export_disc_to_iso_with_changed_files(self, output_file_path, delta=False):
+    # If delta is true, a delta patch against the input ISO is written instead of the full ISO; see
+    # DeltaWriter and apply_delta_patch().
     if os.path.realpath(self.iso_path) == os.path.realpath(output_file_path):
       raise Exception("Input ISO path and output ISO path are the same. Aborting.")
     
-    self.output_iso = open(output_file_path, "wb")
+    self.input_iso = open(self.iso_path, "rb")
+    if delta:
+      self.output_iso = DeltaWriter(output_file_path, self.input_iso)
+    else:
+      self.output_iso = open(output_file_path, "wb")
     try:
       self.export_system_data_to_iso()
       yield(os.path.join("sys", "main.dol"), 5) # 5 system files
@@ -434,6 +579,7 @@ class GCM:
         yield(next_progress_text, 5+files_done)
       
       self.align_output_iso_to_nearest(2048)
+      self.exported_iso_size = self.output_iso.tell()
       self.output_iso.close()
       self.output_iso = None
       yield("Done", -1)
@@ -443,10 +589,18 @@ class GCM:
       self.output_iso = None
       os.remove(output_file_path)
       raise
+    finally:
+      self.input_iso.close()
+      self.input_iso = None
   
   def get_changed_file_data(self, file_path):
     if file_path in self.changed_files:
-      return self.changed_files[file_path]
+      file_data = self.changed_files[file_path]
+      if isinstance(file_data, str):
+        # Overlaid file; see overlay_all_files_from_disk().
+        with open(file_data, "rb") as f:
+          file_data = BytesIO(f.read())
+      return file_data
     else:
       return self.read_file_data(file_path)
   
@@ -644,30 +798,26 @@ class GCM:
       
       if file_entry.file_path in self.changed_files:
         file_data = self.changed_files[file_entry.file_path]
-        file_data.seek(0)
-        self.output_iso.write(file_data.read())
+        if isinstance(file_data, str):
+          # Overlaid file; see overlay_all_files_from_disk().
+          with open(file_data, "rb") as f:
+            copy_data(f, 0, self.output_iso, os.fstat(f.fileno()).st_size)
+        else:
+          file_data.seek(0)
+          self.output_iso.write(file_data.read())
+      elif isinstance(self.output_iso, DeltaWriter):
+        # Unchanged file. Only a reference to its data in the input ISO is stored in the patch.
+        self.output_iso.write_source_data(file_entry.file_data_offset, file_entry.file_size)
       else:
         # Unchanged file.
-        # Most of the game's data falls into this category, so we read the data directly instead of calling read_file_data which would create a BytesIO object, which would add unnecessary performance overhead.
-        # Also, we need to read very large files in chunks to avoid running out of memory.
-        size_remaining = file_entry.file_size
-        offset_in_file = 0
-        while size_remaining > 0:
-          size_to_read = min(size_remaining, MAX_DATA_SIZE_TO_READ_AT_ONCE)
-          
-          with open(self.iso_path, "rb") as iso_file:
-            data = read_bytes(iso_file, file_entry.file_data_offset + offset_in_file, size_to_read)
-          self.output_iso.write(data)
-          
-          size_remaining -= size_to_read
-          offset_in_file += size_to_read
+        # Most of the game's data falls into this category, so we copy the data directly instead of calling read_file_data which would create a BytesIO object, which would add unnecessary performance overhead.
+        # Also, copy_data() copies very large files in chunks to avoid running out of memory.
+        copy_data(self.input_iso, file_entry.file_data_offset, self.output_iso, file_entry.file_size)
+      
+      file_size = self.output_iso.tell() - current_file_start_offset
       
       file_entry_offset = self.fst_offset + file_entry.file_index*0xC
       write_u32(self.output_iso, file_entry_offset+4, current_file_start_offset)
-      if file_entry.file_path in self.changed_files:
-        file_size = data_len(self.changed_files[file_entry.file_path])
-      else:
-        file_size = file_entry.file_size
       write_u32(self.output_iso, file_entry_offset+8, file_size)
       
       # Note: The file_data_offset and file_size fields of the FileEntry must not be updated, they refer only to the offset and size of the file data in the input ISO, not this output ISO.
@@ -681,6 +831,170 @@ class GCM:
     
     yield("Done", -1)
 
+def fingerprint_source_iso(iso_file, iso_size):
+  # Identifies the ISO that a delta patch is made against, without reading the entire disc: the disc
+  # header and the BI2 data are hashed, along with samples that are spread across the disc.
+  md5 = hashlib.md5()
+  md5.update(struct.pack(">Q", iso_size))
+  md5.update(read_bytes(iso_file, 0, min(iso_size, 0x2440)))
+  sample_count = 64
+  sample_size = 0x1000
+  for i in range(sample_count):
+    offset = (iso_size - sample_size) * i // (sample_count - 1) if iso_size > sample_size else 0
+    md5.update(read_bytes(iso_file, offset, min(iso_size, sample_size)))
+  return md5.digest()
+
+class DeltaWriter:
+  # File-like object that is written in place of the output ISO to produce a delta patch against the
+  # source ISO. Data that is referenced from the source ISO with write_source_data() is not stored;
+  # anything else that is written is stored in the patch file as literal data. The output is
+  # expected to be written sequentially, but literal data that has already been written can be
+  # overwritten (e.g. the FST entries, which are filled in as file data is written).
+  
+  def __init__(self, patch_file_path, source_iso_file):
+    source_iso_file.seek(0, os.SEEK_END)
+    self.source_size = source_iso_file.tell()
+    self.source_fingerprint = fingerprint_source_iso(source_iso_file, self.source_size)
+    
+    self.patch_file = open(patch_file_path, "wb")
+    self.patch_file.write(b"\0"*DELTA_PATCH_HEADER_SIZE)
+    self.patch_size = DELTA_PATCH_HEADER_SIZE
+    
+    self.extents = [] # Lists of [kind, output offset, size, data offset], sorted by output offset.
+    self.extent_output_offsets = []
+    self.size = 0
+    self.position = 0
+  
+  def tell(self):
+    return self.position
+  
+  def seek(self, offset, whence=os.SEEK_SET):
+    if whence == os.SEEK_CUR:
+      offset += self.position
+    elif whence == os.SEEK_END:
+      offset += self.size
+    self.position = offset
+    return self.position
+  
+  def flush(self):
+    pass
+  
+  def fileno(self):
+    # Data cannot be copied straight into the patch; see copy_data().
+    raise io.UnsupportedOperation("fileno")
+  
+  def write(self, data):
+    data = memoryview(data).cast("B")
+    data_size = len(data)
+    self.fill_gap()
+    
+    # Overwrite previously written data first.
+    while data and self.position < self.size:
+      extent_index = bisect.bisect_right(self.extent_output_offsets, self.position) - 1
+      kind, output_offset, size, data_offset = self.extents[extent_index]
+      if kind != DELTA_PATCH_EXTENT_LITERAL:
+        raise Exception("Data referenced from the source ISO cannot be overwritten.")
+      size_to_write = min(len(data), output_offset + size - self.position)
+      self.patch_file.seek(data_offset + self.position - output_offset)
+      self.patch_file.write(data[:size_to_write])
+      data = data[size_to_write:]
+      self.position += size_to_write
+    
+    if data:
+      self.patch_file.seek(self.patch_size)
+      self.patch_file.write(data)
+      self.add_extent(DELTA_PATCH_EXTENT_LITERAL, len(data), self.patch_size)
+      self.patch_size += len(data)
+    
+    return data_size
+  
+  def write_source_data(self, source_offset, size):
+    if self.position < self.size:
+      raise Exception("Data referenced from the source ISO can only be appended to a delta patch.")
+    if source_offset + size > self.source_size:
+      raise InvalidOffsetError("Offset 0x%X is past the end of the data." % source_offset)
+    self.fill_gap()
+    self.add_extent(DELTA_PATCH_EXTENT_SOURCE, size, source_offset)
+  
+  def fill_gap(self):
+    # As in regular files, seeking past the end and writing leaves a gap that reads as zeros.
+    if self.position > self.size:
+      gap_size = self.position - self.size
+      self.position = self.size
+      self.write(b"\0"*gap_size)
+  
+  def add_extent(self, kind, size, data_offset):
+    if size == 0:
+      return
+    assert self.position == self.size
+    if self.extents:
+      last_extent = self.extents[-1]
+      if last_extent[0] == kind and last_extent[3] + last_extent[2] == data_offset:
+        # Contiguous in both the output and the data; the last extent is extended.
+        last_extent[2] += size
+        self.position = self.size = self.position + size
+        return
+    self.extents.append([kind, self.position, size, data_offset])
+    self.extent_output_offsets.append(self.position)
+    self.position = self.size = self.position + size
+  
+  def close(self):
+    if self.patch_file is None:
+      return
+    
+    self.patch_file.seek(self.patch_size)
+    for extent in self.extents:
+      self.patch_file.write(struct.pack(DELTA_PATCH_EXTENT_FORMAT, *extent))
+    
+    self.patch_file.seek(0)
+    self.patch_file.write(struct.pack(
+      DELTA_PATCH_HEADER_FORMAT, DELTA_PATCH_MAGIC, DELTA_PATCH_VERSION, self.source_size,
+      self.size, self.patch_size, len(self.extents), self.source_fingerprint
+    ))
+    self.patch_file.close()
+    self.patch_file = None
+
+def apply_delta_patch(source_iso_path, patch_file_path, output_file_path):
+  # Writes the ISO that a delta patch was made from (see DeltaWriter), streaming the data from the
+  # source ISO and from the patch file into the output ISO.
+  if os.path.realpath(source_iso_path) == os.path.realpath(output_file_path):
+    raise Exception("Input ISO path and output ISO path are the same. Aborting.")
+  
+  with open(patch_file_path, "rb") as patch_file, open(source_iso_path, "rb") as source_iso:
+    header_size = struct.calcsize(DELTA_PATCH_HEADER_FORMAT)
+    header = read_bytes(patch_file, 0, header_size)
+    if len(header) != header_size or header[:len(DELTA_PATCH_MAGIC)] != DELTA_PATCH_MAGIC:
+      raise Exception("Not a delta patch: " + patch_file_path)
+    (
+      _magic, version, source_size, output_size, extent_table_offset, extent_count,
+      source_fingerprint,
+    ) = struct.unpack(DELTA_PATCH_HEADER_FORMAT, header)
+    if version != DELTA_PATCH_VERSION:
+      raise Exception("Unsupported delta patch version: %d" % version)
+    
+    source_iso.seek(0, os.SEEK_END)
+    if (source_iso.tell() != source_size or
+        fingerprint_source_iso(source_iso, source_size) != source_fingerprint):
+      raise Exception("The delta patch was not made against this ISO: " + source_iso_path)
+    
+    extent_size = struct.calcsize(DELTA_PATCH_EXTENT_FORMAT)
+    extent_table = read_bytes(patch_file, extent_table_offset, extent_count * extent_size)
+    
+    output_iso = open(output_file_path, "wb")
+    try:
+      for kind, output_offset, size, data_offset in struct.iter_unpack(
+        DELTA_PATCH_EXTENT_FORMAT, extent_table
+      ):
+        assert output_iso.tell() == output_offset
+        src_file = source_iso if kind == DELTA_PATCH_EXTENT_SOURCE else patch_file
+        copy_data(src_file, data_offset, output_iso, size)
+      assert output_iso.tell() == output_size
+      output_iso.close()
+    except Exception:
+      output_iso.close()
+      os.remove(output_file_path)
+      raise
+
 class FileEntry:
   def __init__(self):
     self.file_index = None
@@ -691,9 +1005,9 @@ class FileEntry:
   def read(self, file_index, iso_file, file_entry_offset, fnt_offset):
     self.file_index = file_index
     
-    is_dir_and_name_offset = read_u32(iso_file, file_entry_offset)
-    file_data_offset_or_parent_fst_index = read_u32(iso_file, file_entry_offset+4)
-    file_size_or_next_fst_index = read_u32(iso_file, file_entry_offset+8)
+    is_dir_and_name_offset, file_data_offset_or_parent_fst_index, file_size_or_next_fst_index = (
+      read_and_unpack_bytes(iso_file, file_entry_offset, 0xC, ">III")
+    )
     
     self.is_dir = ((is_dir_and_name_offset & 0xFF000000) != 0)
     self.name_offset = (is_dir_and_name_offset & 0x00FFFFFF)
@@ -722,3 +1036,17 @@ class SystemFile:
     
     self.is_dir = False
     self.is_system_file = True
+
+def main():
+  parser = argparse.ArgumentParser(
+    description="Applies a delta patch to the ISO that it was made against."
+  )
+  parser.add_argument("input", type=str, help="Path to the original ISO file.")
+  parser.add_argument("patch", type=str, help="Path to the delta patch file.")
+  parser.add_argument("output", type=str, help="Path where the patched ISO file will be written.")
+  args = parser.parse_args()
+  
+  apply_delta_patch(args.input, args.patch, args.output)
+
+if __name__ == "__main__":
+  main()